@@ -1,9 +1,10 @@
 #include "AppPlatform.h"
 
 CAppPlatform::CAppPlatform()
-	: mDisplay{ std::make_unique<CDisplay>() },
+	: mTelemetry{ std::make_unique<CTelemetry>() },
+	  mDisplay{ std::make_unique<CDisplay>() },
 	  mKeyboard{ std::make_unique<CKeyboard>() },
-	  mSound{ std::make_unique<CSound>() }
+	  mSound{ std::make_unique<CSound>(*mTelemetry) }
 {
 }
 
@@ -16,6 +17,7 @@ void CAppPlatform::UpdateDisplay(const c8::SDisplay& display)
 {
 	mDisplay->SetExtendedMode(display.ExtendedMode);
 	mDisplay->UpdatePixelBuffer(display.PixelBuffer);
+	mTelemetry->RecordDisplayUpdate();
 }
 
 void CAppPlatform::Beep(double frequency, std::chrono::milliseconds duration)
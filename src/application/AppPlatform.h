@@ -2,11 +2,13 @@
 #include "Display.h"
 #include "Keyboard.h"
 #include "Sound.h"
+#include "Telemetry.h"
 #include <core/Platform.h>
 
 class CAppPlatform : public c8::IPlatform
 {
 private:
+	std::unique_ptr<CTelemetry> mTelemetry;
 	std::unique_ptr<CDisplay> mDisplay;
 	std::unique_ptr<CKeyboard> mKeyboard;
 	std::unique_ptr<CSound> mSound;
@@ -23,6 +25,7 @@ public:
 	inline CDisplay& Display() { return *mDisplay; }
 	inline CKeyboard& Keyboard() { return *mKeyboard; }
 	inline CSound& Sound() { return *mSound; }
+	inline CTelemetry& Telemetry() { return *mTelemetry; }
 
 	void GetKeyboardState(c8::SKeyboardState& dest) override;
 	void UpdateDisplay(const c8::SDisplay& display) override;
@@ -1,5 +1,6 @@
 #include "Display.h"
 #include <algorithm>
+#include <core/Trace.h>
 #include <gsl/gsl_util>
 #include <stdexcept>
 
@@ -12,7 +13,7 @@ CDisplay::CDisplay()
 	  mLogicalWidth{ DisplayResolutionWidth },
 	  mLogicalHeight{ DisplayResolutionHeight }
 {
-	mWindow = SDL_CreateWindow("chip8-interpreter",
+	mWindow = SDL_CreateWindow(WindowTitle,
 							   SDL_WINDOWPOS_UNDEFINED,
 							   SDL_WINDOWPOS_UNDEFINED,
 							   DefaultWindowWidth,
@@ -51,6 +52,7 @@ CDisplay::~CDisplay()
 
 void CDisplay::Render()
 {
+	c8::CTraceScope trace{ "CDisplay::Render" };
 	SDL_SetRenderDrawColor(mRenderer,
 						   std::get<0>(BackColor),
 						   std::get<1>(BackColor),
@@ -88,6 +90,8 @@ void CDisplay::Render()
 	SDL_RenderPresent(mRenderer);
 }
 
+void CDisplay::SetTitle(const std::string& title) { SDL_SetWindowTitle(mWindow, title.c_str()); }
+
 void CDisplay::SetExtendedMode(bool extendedMode)
 {
 	if (mExtendedMode != extendedMode)
@@ -110,7 +114,7 @@ void CDisplay::SetExtendedMode(bool extendedMode)
 	}
 }
 
-void CDisplay::UpdatePixelBuffer(const c8::SDisplayPixelBuffer& src)
+void CDisplay::UpdatePixelBuffer(const c8::CPackedPixelBuffer& src)
 {
 	std::copy(src.begin(), src.end(), mPixelBuffers[mNextPixelBuffer].begin());
 
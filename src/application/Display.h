@@ -4,11 +4,13 @@
 #include <core/Constants.h>
 #include <core/Context.h>
 #include <cstdint>
+#include <string>
 #include <tuple>
 
 class CDisplay
 {
 public:
+	static constexpr const char* WindowTitle{ "chip8-interpreter" };
 	static constexpr std::size_t DefaultWindowWidth{ c8::constants::DisplayResolutionWidth * 15 };
 	static constexpr std::size_t DefaultWindowHeight{ c8::constants::DisplayResolutionHeight * 15 };
 
@@ -45,6 +47,7 @@ public:
 	CDisplay& operator=(CDisplay&&) = default;
 
 	void Render();
+	void SetTitle(const std::string& title);
 	void SetExtendedMode(bool extendedMode);
-	void UpdatePixelBuffer(const c8::SDisplayPixelBuffer& src);
+	void UpdatePixelBuffer(const c8::CPackedPixelBuffer& src);
 };
@@ -4,6 +4,7 @@
 #include <GL/gl3w.h>
 #include <SDL2/SDL_syswm.h>
 #include <array>
+#include <core/Trace.h>
 #include <functional>
 #include <gsl/gsl_util>
 #include <imgui.h>
@@ -855,6 +856,7 @@ bool CImGuiWindow::ProcessEvent(const SDL_Event& event)
 
 void CImGuiWindow::Render()
 {
+	c8::CTraceScope trace{ "CImGuiWindow::Render" };
 	mImpl->BeginRender();
 	Draw();
 	mImpl->EndRender();
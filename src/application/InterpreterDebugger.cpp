@@ -1,28 +1,63 @@
 #include "InterpreterDebugger.h"
 #include "Icons.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
 #include <gsl/gsl_util>
 #include <imgui.h>
 #include <mutex>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <vector>
 
 static const ImVec4 SubtitleColor{ 0.1f, 0.8f, 0.05f, 1.0f };
+static const ImVec4 ErrorColor{ 1.0f, 0.3f, 0.3f, 1.0f };
+
+template<std::size_t N>
+static void CopyText(const std::string& text, std::array<char, N>& buffer)
+{
+	const std::size_t length = std::min(text.size(), N - 1);
+	std::copy_n(text.begin(), length, buffer.begin());
+	buffer[length] = '\0';
+}
 
 // TODO: debugger GUI should resize to fit window
 
 using namespace c8;
 using namespace c8::constants;
 
-CInterpreterDebugger::CInterpreterDebugger(CInterpreter& interpreter)
+CInterpreterDebugger::CInterpreterDebugger(CInterpreter& interpreter, const CTelemetry& telemetry)
 	: CImGuiWindow("chip8-interpreter: Debugger"),
 	  mInterpreter(interpreter),
+	  mTelemetry(telemetry),
 	  mFirstDraw{ true },
-	  mBreakpoints{},
-	  mDisassemblyGoToAddress{ InvalidDisassemblyGoToAddress }
+	  mDisassemblyGoToAddress{ InvalidDisassemblyGoToAddress },
+	  mBreakpointHitAddress{ InvalidDisassemblyGoToAddress },
+	  mWatchSize{ 1 },
+	  mConditionText{},
+	  mTraceText{},
+	  mConditionError{},
+	  mDisassembly{},
+	  mControlFlow{},
+	  mDisassemblyRows{}
 {
+	// required for 'Step Back' and 'Reverse Continue'
+	mInterpreter.EnableHistory(true);
+	// the interpreter pauses itself, the disassembly only has to show where
+	mInterpreter.SetBreakpointHitCallback(
+		[this](std::uint16_t pc) { mBreakpointHitAddress = pc; });
 }
 
+CInterpreterDebugger::~CInterpreterDebugger() { mInterpreter.SetBreakpointHitCallback(nullptr); }
+
 void CInterpreterDebugger::Draw()
 {
-	CheckBreakpoints();
+	const std::size_t hitAddress = mBreakpointHitAddress.exchange(InvalidDisassemblyGoToAddress);
+	if (hitAddress != InvalidDisassemblyGoToAddress)
+	{
+		mDisassemblyGoToAddress = hitAddress;
+	}
 
 	ImGuiIO& io = ImGui::GetIO();
 
@@ -43,6 +78,15 @@ void CInterpreterDebugger::Draw()
 		DrawStack();
 		ImGui::SameLine();
 		DrawDisassembly();
+		DrawProfiler();
+		ImGui::SameLine();
+		DrawHotSpots();
+		ImGui::SameLine();
+		DrawTracepoints();
+		ImGui::SameLine();
+		DrawExecutionTrace();
+		ImGui::SameLine();
+		DrawPerformance();
 	}
 	ImGui::End();
 
@@ -85,6 +129,56 @@ void CInterpreterDebugger::DrawMenuBar()
 			ImGui::SetTooltip("Step");
 		}
 
+		const bool canStepBack = mInterpreter.IsPaused() && mInterpreter.CanStepBack();
+		if (ImGui::MenuItem(ICON_FA_ARROW_LEFT, nullptr, false, canStepBack))
+		{
+			mInterpreter.StepBack();
+		}
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::SetTooltip("Step Back");
+		}
+
+		if (ImGui::MenuItem(ICON_FA_BACKWARD, nullptr, false, canStepBack))
+		{
+			mInterpreter.ReverseContinue();
+		}
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::SetTooltip("Reverse Continue (to breakpoint)");
+		}
+
+		const bool heatmapEnabled = mInterpreter.Heatmap() != nullptr;
+		if (ImGui::MenuItem(ICON_FA_FIRE, nullptr, heatmapEnabled, mInterpreter.IsPaused()))
+		{
+			mInterpreter.EnableHeatmap(!heatmapEnabled);
+		}
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::SetTooltip("Heatmap");
+		}
+
+		const bool executionTraceEnabled = mInterpreter.ExecutionTrace() != nullptr;
+		if (ImGui::MenuItem(
+				ICON_FA_LIST, nullptr, executionTraceEnabled, mInterpreter.IsPaused()))
+		{
+			mInterpreter.EnableExecutionTrace(!executionTraceEnabled);
+		}
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::SetTooltip("Execution trace");
+		}
+
+		const bool regionMapEnabled = mInterpreter.RegionMap() != nullptr;
+		if (ImGui::MenuItem(ICON_FA_MAP, nullptr, regionMapEnabled, mInterpreter.IsPaused()))
+		{
+			mInterpreter.EnableRegionMap(!regionMapEnabled);
+		}
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::SetTooltip("Memory regions");
+		}
+
 		ImGui::EndMenuBar();
 	}
 }
@@ -126,10 +220,10 @@ void CInterpreterDebugger::DrawRegisters()
 		ImGui::NextColumn();
 		ImGui::Text("IR: %04X", c.IR);
 		ImGui::NextColumn();
-		ImGui::Text("DT:   %02X", c.DT);
+		ImGui::Text("DT:   %02X", c.DT());
 		ImGui::NextColumn();
 		ImGui::NextColumn();
-		ImGui::Text("ST:   %02X", c.ST);
+		ImGui::Text("ST:   %02X", c.ST());
 		ImGui::NextColumn();
 		ImGui::NextColumn();
 		ImGui::Columns(1);
@@ -175,6 +269,16 @@ void CInterpreterDebugger::DrawMemory()
 	if (ImGui::BeginChild("Memory", ImVec2(458.0f, 320.0f), true, ImGuiWindowFlags_NoScrollbar))
 	{
 		ImGui::TextColored(SubtitleColor, "Memory");
+		if (const auto& hit = mInterpreter.LastWatchpointHit(); hit.has_value())
+		{
+			ImGui::SameLine();
+			ImGui::Text("| %s %04X = %02X by %04X",
+						hit->Access == EWatchAccess::Write ? "Write" : "Read",
+						hit->Address,
+						hit->Value,
+						hit->PC);
+		}
+		DrawRegionMap();
 
 		ImGui::Separator();
 		if (ImGui::BeginChild("MemoryBytes", ImVec2(0.0f, 0.0f), false))
@@ -208,6 +312,20 @@ void CInterpreterDebugger::DrawMemory()
 					{
 						if (offset != 0)
 							ImGui::SameLine();
+						const std::uint16_t byteAddr = gsl::narrow<std::uint16_t>(addr + offset);
+						const ImVec2 byteSize = ImGui::CalcTextSize("00");
+						DrawHeat(byteAddr, byteSize.x, byteSize.y);
+
+						// highlight background if the byte is watched
+						if (mInterpreter.Watchpoints().IsWatched(byteAddr))
+						{
+							const ImVec2 pos = ImGui::GetCursorScreenPos();
+							ImGui::GetWindowDrawList()->AddRectFilled(
+								pos,
+								ImVec2(pos.x + byteSize.x, pos.y + byteSize.y),
+								IM_COL32(200, 0, 0, 100));
+						}
+
 						std::uint8_t byte = c.Memory[addr + offset];
 						if (byte == 0)
 						{
@@ -217,6 +335,7 @@ void CInterpreterDebugger::DrawMemory()
 						{
 							ImGui::Text("%02X", byte);
 						}
+						DrawWatchpointMenu(byteAddr);
 
 						if (offset == (BytesPerLine / 2) - 1)
 						{
@@ -250,11 +369,108 @@ void CInterpreterDebugger::DrawMemory()
 	ImGui::EndChild();
 }
 
+void CInterpreterDebugger::DrawWatchpointMenu(std::uint16_t address)
+{
+	ImGui::PushID(address);
+	if (ImGui::BeginPopupContextItem("##watchpointMenu"))
+	{
+		// the interpreter reads the watchpoints on every memory access, only change them when
+		// it is not running
+		const bool paused = mInterpreter.IsPaused();
+
+		ImGui::Text("Watch %04X", address);
+		ImGui::SetNextItemWidth(100.0f);
+		ImGui::InputInt("Bytes", &mWatchSize);
+		mWatchSize = std::clamp(mWatchSize, 1, static_cast<int>(MemorySize - address));
+
+		const std::uint16_t size = gsl::narrow<std::uint16_t>(mWatchSize);
+		if (ImGui::MenuItem("Writes", nullptr, false, paused))
+		{
+			mInterpreter.AddWatchpoint(address, size, EWatchAccess::Write);
+		}
+		if (ImGui::MenuItem("Reads", nullptr, false, paused))
+		{
+			mInterpreter.AddWatchpoint(address, size, EWatchAccess::Read);
+		}
+		if (ImGui::MenuItem("Reads and writes", nullptr, false, paused))
+		{
+			mInterpreter.AddWatchpoint(address, size, EWatchAccess::ReadWrite);
+		}
+
+		if (mInterpreter.Watchpoints().IsWatched(address))
+		{
+			ImGui::Separator();
+			if (ImGui::MenuItem("Remove", nullptr, false, paused))
+			{
+				mInterpreter.RemoveWatchpoints(address);
+			}
+		}
+		ImGui::EndPopup();
+	}
+	ImGui::PopID();
+}
+
+void CInterpreterDebugger::DrawRegionMap()
+{
+	const CRegionMap* regions = mInterpreter.RegionMap();
+	if (!regions)
+	{
+		return;
+	}
+
+	constexpr float CellWidth{ 8.0f };
+	constexpr float CellSpacing{ 1.0f };
+
+	ImGui::SameLine(ImGui::GetWindowWidth() -
+					CPagedMemory::PageCount * (CellWidth + CellSpacing) - 8.0f);
+	const ImVec2 start = ImGui::GetCursorScreenPos();
+	const float height = ImGui::GetTextLineHeight();
+	for (std::size_t page = 0; page < CPagedMemory::PageCount; page++)
+	{
+		const ERegionKind kind = regions->Kind(page);
+		ImU32 color = IM_COL32(70, 70, 70, 255);
+		const char* name = "Unused";
+		switch (kind)
+		{
+		case ERegionKind::Code:
+			color = IM_COL32(40, 120, 240, 255);
+			name = "Code";
+			break;
+		case ERegionKind::Data:
+			color = IM_COL32(60, 180, 60, 255);
+			name = "Data";
+			break;
+		case ERegionKind::SelfModifying:
+			color = IM_COL32(240, 130, 0, 255);
+			name = "Self-modifying";
+			break;
+		case ERegionKind::Unused: break;
+		}
+
+		const ImVec2 min{ start.x + page * (CellWidth + CellSpacing), start.y };
+		const ImVec2 max{ min.x + CellWidth, min.y + height };
+		ImGui::GetWindowDrawList()->AddRectFilled(min, max, color);
+		if (ImGui::IsMouseHoveringRect(min, max))
+		{
+			const std::size_t pageStart = page * CPagedMemory::PageSize;
+			ImGui::SetTooltip("%04X-%04X: %s",
+							  gsl::narrow<std::uint32_t>(pageStart),
+							  gsl::narrow<std::uint32_t>(pageStart + CPagedMemory::PageSize - 1),
+							  name);
+		}
+	}
+	ImGui::Dummy(ImVec2(CPagedMemory::PageCount * (CellWidth + CellSpacing), height));
+}
+
 void CInterpreterDebugger::DrawDisassembly()
 {
-	SContext contextCopy =
-		mInterpreter.Context(); // required for instructions ToString, TODO: optimize
 	const SContext& c = mInterpreter.Context();
+	// only the lines of the memory written since the last frame are formatted again, and the
+	// program is only analyzed again when some byte changed
+	if (mDisassembly.Update(c.Memory) != 0 || !mControlFlow)
+	{
+		UpdateControlFlow();
+	}
 
 	if (ImGui::BeginChild("Disassembly",
 						  ImVec2(458.0f, 424.0f),
@@ -299,45 +515,68 @@ void CInterpreterDebugger::DrawDisassembly()
 					IM_COL32(50, 50, 50, 180));
 			}
 
-			constexpr std::size_t BytesPerLine{ InstructionByteSize };
-			constexpr std::size_t LineTotalCount{ MemorySize / BytesPerLine };
-
-			// handle 'go to address' request
+			// handle 'go to address' request, to the line that contains it
 			if (mDisassemblyGoToAddress != InvalidDisassemblyGoToAddress)
 			{
-				const std::size_t lineIndex = mDisassemblyGoToAddress / BytesPerLine;
+				const auto row = std::upper_bound(mDisassemblyRows.begin(),
+												  mDisassemblyRows.end(),
+												  mDisassemblyGoToAddress);
+				const std::size_t lineIndex = std::distance(mDisassemblyRows.begin(), row) - 1;
 				const float offsetY = lineIndex * ImGui::GetTextLineHeightWithSpacing();
 				ImGui::SetScrollY(offsetY);
 				mDisassemblyGoToAddress = InvalidDisassemblyGoToAddress;
 			}
 
-			ImGuiListClipper clipper(gsl::narrow<int>(LineTotalCount));
+			ImGuiListClipper clipper(gsl::narrow<int>(mDisassemblyRows.size() - 1));
 			while (clipper.Step())
 			{
 				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 				{
 					ImGui::PushID(static_cast<int>(i));
 
-					const std::size_t addr = i * BytesPerLine;
+					const std::size_t addr = mDisassemblyRows[i];
 
-					// highlight background if the breakpoint is set
-					if (mBreakpoints[i])
+					// heat background, behind the breakpoint highlight
 					{
+						const ImVec2 pos = ImGui::GetCursorScreenPos();
+						ImGui::SetCursorScreenPos(ImVec2(pos.x + LeftGapWidth, pos.y));
+						DrawHeat(gsl::narrow<std::uint16_t>(addr),
+								 ImGui::GetWindowWidth(),
+								 ImGui::GetTextLineHeight());
+						ImGui::SetCursorScreenPos(pos);
+					}
+
+					// highlight background if the breakpoint is set, in orange if it has a
+					// condition and in blue if it is a tracepoint
+					const CBreakpoints& breakpoints = mInterpreter.Breakpoints();
+					if (breakpoints.Has(gsl::narrow<std::uint16_t>(addr)))
+					{
+						const SBreakpointCondition* condition =
+							breakpoints.Condition(gsl::narrow<std::uint16_t>(addr));
+						ImU32 color = IM_COL32(240, 0, 0, 255);
+						if (condition && condition->Trace.has_value())
+						{
+							color = IM_COL32(40, 120, 240, 255);
+						}
+						else if (condition)
+						{
+							color = IM_COL32(240, 130, 0, 255);
+						}
+
 						// text background
 						ImVec2 pos = ImGui::GetCursorScreenPos();
 						ImGui::GetWindowDrawList()->AddRectFilled(
 							ImVec2(pos.x + LeftGapWidth, pos.y),
 							ImVec2(std::numeric_limits<float>::max(),
 								   pos.y + ImGui::GetTextLineHeight()),
-							IM_COL32(200, 0, 0, 100));
+							(color & ~IM_COL32_A_MASK) | IM_COL32(0, 0, 0, 100));
 
 						// circle icon
 						const ImVec2 circleCenter{ pos.x + (LeftGapWidth * 0.5f),
 												   pos.y + ImGui::GetTextLineHeight() * 0.5f };
 						const float circleRadius = ImGui::GetTextLineHeight() * 0.5f;
-						ImGui::GetWindowDrawList()->AddCircleFilled(circleCenter,
-																	circleRadius,
-																	IM_COL32(240, 0, 0, 255));
+						ImGui::GetWindowDrawList()->AddCircleFilled(
+							circleCenter, circleRadius, color);
 						ImGui::GetWindowDrawList()->AddCircle(circleCenter,
 															  circleRadius,
 															  IM_COL32(255, 255, 255, 255));
@@ -353,12 +592,16 @@ void CInterpreterDebugger::DrawDisassembly()
 						ImGui::SetCursorPos(prevCursor);
 					}
 
-					// breakpoint button
+					// breakpoint button, the conditions are only removed while paused because
+					// the interpreter looks them up when it reaches the address
 					if (ImGui::InvisibleButton("##breakpointButton",
-											   ImVec2(LeftGapWidth, ImGui::GetTextLineHeight())))
+											   ImVec2(LeftGapWidth, ImGui::GetTextLineHeight())) &&
+						(mInterpreter.IsPaused() ||
+						 !breakpoints.Condition(gsl::narrow<std::uint16_t>(addr))))
 					{
-						mBreakpoints[i] = !mBreakpoints[i];
+						mInterpreter.Breakpoints().Toggle(gsl::narrow<std::uint16_t>(addr));
 					}
+					DrawBreakpointMenu(gsl::narrow<std::uint16_t>(addr));
 					ImGui::SameLine();
 
 					if (addr >= ProgramStartAddress)
@@ -369,22 +612,87 @@ void CInterpreterDebugger::DrawDisassembly()
 					{
 						ImGui::TextDisabled("%04X: ", gsl::narrow<std::uint32_t>(addr));
 					}
-					ImGui::SameLine();
 
-					std::uint16_t opcode = c.Memory[addr] << 8 | c.Memory[addr + 1];
-					contextCopy.PC = gsl::narrow<std::uint16_t>(addr);
-					contextCopy.IR = opcode;
-
-					auto instOpt = mInterpreter.TryFindInstruction(opcode);
-					if (instOpt.has_value())
+					// label, with the instructions that reference it
+					if (const std::string* label =
+							mControlFlow->Label(gsl::narrow<std::uint16_t>(addr)))
 					{
-						const SInstruction& inst = instOpt.value().get();
-						std::string instStr = inst.ToString(inst, contextCopy);
-						ImGui::Text("%s", instStr.c_str());
+						ImGui::SameLine();
+						ImGui::TextColored(SubtitleColor, "%s:", label->c_str());
+						if (ImGui::IsItemHovered())
+						{
+							std::string references{};
+							for (const SReference& reference :
+								 mControlFlow->References(gsl::narrow<std::uint16_t>(addr)))
+							{
+								char text[32];
+								std::snprintf(text,
+											  sizeof(text),
+											  "%s%s from %04X",
+											  references.empty() ? "" : "\n",
+											  reference.Kind == EReferenceKind::Call   ? "CALL" :
+											  reference.Kind == EReferenceKind::Jump ? "JP" :
+																					   "LD I",
+											  reference.From);
+								references += text;
+							}
+							ImGui::SetTooltip("%s", references.c_str());
+						}
 					}
-					else
+					ImGui::SameLine(LeftGapWidth + 130.0f);
+
+					const SDisassemblyLine& line =
+						mDisassembly.Line(gsl::narrow<std::uint16_t>(addr));
+					switch (mControlFlow->Kind(addr))
 					{
-						ImGui::TextDisabled("???");
+					case EByteKind::Code:
+						if (line.Instruction)
+						{
+							ImGui::Text("%s", line.Text.data());
+						}
+						else
+						{
+							ImGui::TextDisabled("???");
+						}
+
+						// JP V0, nnn
+						if ((line.Opcode & 0xF000) == 0xB000)
+						{
+							ImGui::SameLine();
+							ImGui::TextColored(ImVec4(0.94f, 0.51f, 0.0f, 1.0f), "?");
+							if (ImGui::IsItemHovered())
+							{
+								ImGui::SetTooltip("The target depends on V0, the code there is "
+												  "not analyzed");
+							}
+						}
+						break;
+					case EByteKind::Data:
+					{
+						// as the pixels of a sprite
+						const std::uint8_t value = c.Memory[addr];
+						char pixels[9]{};
+						for (std::size_t bit = 0; bit < 8; bit++)
+						{
+							pixels[bit] = (value & (0x80 >> bit)) ? '#' : '.';
+						}
+						ImGui::Text("DB %02X", value);
+						ImGui::SameLine();
+						ImGui::TextDisabled("%s", pixels);
+						break;
+					}
+					default:
+						// not reached from the entry point, but still shown as instructions
+						// when aligned, as it may be the target of a JP V0, nnn
+						if (mDisassemblyRows[i + 1] - addr == InstructionByteSize)
+						{
+							ImGui::TextDisabled("%s", line.Instruction ? line.Text.data() : "???");
+						}
+						else
+						{
+							ImGui::TextDisabled("DB %02X", c.Memory[addr]);
+						}
+						break;
 					}
 
 					ImGui::PopID();
@@ -396,16 +704,456 @@ void CInterpreterDebugger::DrawDisassembly()
 	ImGui::EndChild();
 }
 
-void CInterpreterDebugger::CheckBreakpoints()
+void CInterpreterDebugger::UpdateControlFlow()
 {
-	if (mInterpreter.IsPaused())
+	const CPagedMemory& memory = mInterpreter.Context().Memory;
+	mControlFlow = CControlFlow::Analyze(memory);
+
+	mDisassemblyRows.clear();
+	std::size_t address = 0;
+	while (address < MemorySize)
 	{
-		return;
+		mDisassemblyRows.push_back(gsl::narrow<std::uint16_t>(address));
+
+		const EByteKind kind = mControlFlow->Kind(address);
+		const bool nextUnknown = address + 1 < MemorySize &&
+								 mControlFlow->Kind(address + 1) == EByteKind::Unknown;
+		if (kind == EByteKind::Code ||
+			(kind == EByteKind::Unknown && address % InstructionByteSize == 0 && nextUnknown))
+		{
+			address += InstructionByteSize;
+		}
+		else
+		{
+			address++;
+		}
+	}
+	// end marker, so the size of the last line is known
+	mDisassemblyRows.push_back(gsl::narrow<std::uint16_t>(MemorySize));
+}
+
+void CInterpreterDebugger::DrawBreakpointMenu(std::uint16_t address)
+{
+	if (ImGui::BeginPopupContextItem("##breakpointMenu"))
+	{
+		CBreakpoints& breakpoints = mInterpreter.Breakpoints();
+		if (ImGui::IsWindowAppearing())
+		{
+			const SBreakpointCondition* condition = breakpoints.Condition(address);
+			CopyText(condition && condition->Condition ? condition->Condition->Source() : "",
+					 mConditionText);
+			CopyText(condition && condition->Trace ? condition->Trace->Source() : "", mTraceText);
+			mConditionError.clear();
+		}
+
+		ImGui::Text("Breakpoint %04X", address);
+		ImGui::SetNextItemWidth(250.0f);
+		ImGui::InputText("Condition", mConditionText.data(), mConditionText.size());
+		ImGui::SetNextItemWidth(250.0f);
+		ImGui::InputText("Trace", mTraceText.data(), mTraceText.size());
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::SetTooltip("Logged instead of stopping, e.g. 'V3' or '[I] + HITS'");
+		}
+
+		// same as the watchpoints, only change them when the interpreter is not running
+		if (!mInterpreter.IsPaused())
+		{
+			ImGui::TextDisabled("Pause to edit");
+		}
+		else
+		{
+			if (ImGui::Button("Set"))
+			{
+				auto compile = [](const char* source) -> std::optional<CExpression> {
+					if (source[0] == '\0')
+					{
+						return std::nullopt;
+					}
+					return CExpression::Compile(source);
+				};
+
+				try
+				{
+					breakpoints.SetCondition(address,
+											 compile(mConditionText.data()),
+											 compile(mTraceText.data()));
+					ImGui::CloseCurrentPopup();
+				}
+				catch (const std::invalid_argument& e)
+				{
+					mConditionError = e.what();
+				}
+			}
+			if (breakpoints.Has(address))
+			{
+				ImGui::SameLine();
+				if (ImGui::Button("Remove"))
+				{
+					breakpoints.Set(address, false);
+					ImGui::CloseCurrentPopup();
+				}
+			}
+		}
+
+		if (!mConditionError.empty())
+		{
+			ImGui::PushStyleColor(ImGuiCol_Text, ErrorColor);
+			ImGui::TextWrapped("%s", mConditionError.c_str());
+			ImGui::PopStyleColor();
+		}
+		ImGui::EndPopup();
+	}
+}
+
+void CInterpreterDebugger::DrawProfiler()
+{
+	const CProfiler& profiler = mInterpreter.Profiler();
+
+	if (ImGui::BeginChild("Profiler", ImVec2(616.0f, 0.0f), true, ImGuiWindowFlags_NoScrollbar))
+	{
+		ImGui::TextColored(SubtitleColor, "Profiler");
+
+		if (!CProfiler::Enabled)
+		{
+			ImGui::Separator();
+			ImGui::TextWrapped("Build with C8_PROFILER to count the executed instructions.");
+			ImGui::EndChild();
+			return;
+		}
+
+		ImGui::SameLine(ImGui::GetWindowWidth() - 50.0f);
+		if (ImGui::SmallButton("Reset"))
+		{
+			mInterpreter.ResetProfiler();
+		}
+
+		ImGui::Separator();
+		ImGui::Text("Cycles: %llu", static_cast<unsigned long long>(profiler.CycleCount()));
+		ImGui::Text("Display updates: %llu  Beeps: %llu",
+					static_cast<unsigned long long>(profiler.DisplayUpdateCount()),
+					static_cast<unsigned long long>(profiler.BeepCount()));
+
+		// sampled handler times, in powers of two ticks
+		std::array<float, CProfiler::HistogramBucketCount> histogram{};
+		std::copy(profiler.Histogram().begin(), profiler.Histogram().end(), histogram.begin());
+		ImGui::PlotHistogram("##Histogram",
+							 histogram.data(),
+							 gsl::narrow<int>(histogram.size()),
+							 0,
+							 "Handler ticks (log2)",
+							 0.0f,
+							 FLT_MAX,
+							 ImVec2(0.0f, 60.0f));
+
+		ImGui::Separator();
+		if (ImGui::BeginChild("ProfilerInstructions", ImVec2(0.0f, 0.0f), false))
+		{
+			const auto& instructions = profiler.Instructions();
+			std::vector<std::size_t> order(instructions.size());
+			std::iota(order.begin(), order.end(), std::size_t{ 0 });
+			std::sort(order.begin(), order.end(), [&instructions](std::size_t a, std::size_t b) {
+				return instructions[a].ExecutionCount > instructions[b].ExecutionCount;
+			});
+
+			ImGui::Columns(3);
+			ImGui::Text("Instruction");
+			ImGui::NextColumn();
+			ImGui::Text("Cycles");
+			ImGui::NextColumn();
+			ImGui::Text("Avg. ticks");
+			ImGui::NextColumn();
+			ImGui::Separator();
+
+			const double cycleCount = std::max(profiler.CycleCount(), std::uint64_t{ 1 });
+			for (std::size_t i : order)
+			{
+				const CProfiler::SInstructionProfile& profile = instructions[i];
+				if (profile.ExecutionCount == 0)
+				{
+					break;
+				}
+
+				ImGui::Text("%s", SInstruction::InstructionSet[i].Name.c_str());
+				ImGui::NextColumn();
+				ImGui::Text("%.1f%%", 100.0 * profile.ExecutionCount / cycleCount);
+				ImGui::NextColumn();
+				ImGui::Text("%.0f", profile.AverageTicks());
+				ImGui::NextColumn();
+			}
+			ImGui::Columns(1);
+		}
+		ImGui::EndChild();
+	}
+	ImGui::EndChild();
+}
+
+void CInterpreterDebugger::DrawHotSpots()
+{
+	const CHeatmap* heatmap = mInterpreter.Heatmap();
+
+	if (ImGui::BeginChild("HotSpots", ImVec2(458.0f, 0.0f), true, ImGuiWindowFlags_NoScrollbar))
+	{
+		ImGui::TextColored(SubtitleColor, "Hot Spots");
+
+		// the heatmap is recorded from the interpreter thread, like the execution trace it can
+		// only be enabled, reset or listed while paused
+		const bool paused = mInterpreter.IsPaused();
+		if (!heatmap)
+		{
+			ImGui::Separator();
+			if (!paused)
+			{
+				ImGui::TextDisabled("Pause to enable");
+			}
+			else if (ImGui::Button(ICON_FA_FIRE " Enable heatmap"))
+			{
+				mInterpreter.EnableHeatmap(true);
+			}
+			ImGui::EndChild();
+			return;
+		}
+
+		if (paused)
+		{
+			ImGui::SameLine(ImGui::GetWindowWidth() - 50.0f);
+			if (ImGui::SmallButton("Reset"))
+			{
+				mInterpreter.ResetHeatmap();
+			}
+		}
+
+		ImGui::Separator();
+		if (!paused)
+		{
+			ImGui::TextDisabled("Pause to see them");
+			ImGui::EndChild();
+			return;
+		}
+
+		if (ImGui::BeginChild("HotSpotsLists", ImVec2(0.0f, 0.0f), false))
+		{
+			constexpr std::size_t MaxRows{ 32 };
+
+			ImGui::Columns(2);
+			ImGui::Text("Address");
+			ImGui::NextColumn();
+			ImGui::Text("Loop (iterations, cycles)");
+			ImGui::NextColumn();
+			ImGui::Separator();
+
+			// selecting a row scrolls the disassembly to it
+			for (const SHeatmapEntry& entry : heatmap->Hottest(MaxRows))
+			{
+				char label[32];
+				std::snprintf(label,
+							  std::size(label),
+							  "%04X: %llu##address",
+							  entry.Address,
+							  static_cast<unsigned long long>(entry.Count));
+				if (ImGui::Selectable(label))
+				{
+					mDisassemblyGoToAddress = entry.Address;
+				}
+			}
+			ImGui::NextColumn();
+
+			const std::vector<SHeatmapLoop> loops = heatmap->Loops();
+			for (std::size_t i = 0; i < std::min(loops.size(), MaxRows); i++)
+			{
+				const SHeatmapLoop& loop = loops[i];
+				char label[64];
+				std::snprintf(label,
+							  std::size(label),
+							  "%04X-%04X: %llu, %llu##loop",
+							  loop.Start,
+							  loop.End,
+							  static_cast<unsigned long long>(loop.Iterations),
+							  static_cast<unsigned long long>(loop.Cycles));
+				if (ImGui::Selectable(label))
+				{
+					mDisassemblyGoToAddress = loop.Start;
+				}
+			}
+			ImGui::Columns(1);
+		}
+		ImGui::EndChild();
 	}
+	ImGui::EndChild();
+}
+
+void CInterpreterDebugger::DrawTracepoints()
+{
+	const CBreakpoints& breakpoints = mInterpreter.Breakpoints();
+
+	if (ImGui::BeginChild("Tracepoints", ImVec2(300.0f, 0.0f), true, ImGuiWindowFlags_NoScrollbar))
+	{
+		ImGui::TextColored(SubtitleColor, "Tracepoints");
+		ImGui::SameLine();
+		ImGui::Text("| %llu", static_cast<unsigned long long>(breakpoints.TraceCount()));
+
+		// the entries are logged from the interpreter thread, they can only be listed or cleared
+		// while paused
+		const bool paused = mInterpreter.IsPaused();
+		if (paused)
+		{
+			ImGui::SameLine(ImGui::GetWindowWidth() - 50.0f);
+			if (ImGui::SmallButton("Clear"))
+			{
+				mInterpreter.Breakpoints().ClearTraces();
+			}
+		}
+
+		ImGui::Separator();
+		if (!paused)
+		{
+			ImGui::TextDisabled("Pause to see them");
+			ImGui::EndChild();
+			return;
+		}
+
+		if (ImGui::BeginChild("TracepointsEntries", ImVec2(0.0f, 0.0f), false))
+		{
+			ImGui::Columns(3);
+			ImGui::Text("Address");
+			ImGui::NextColumn();
+			ImGui::Text("Hit");
+			ImGui::NextColumn();
+			ImGui::Text("Value");
+			ImGui::NextColumn();
+			ImGui::Separator();
+
+			// newest first, selecting a row scrolls the disassembly to it
+			const std::vector<STracepointEntry> traces = breakpoints.Traces();
+			for (auto it = traces.rbegin(); it != traces.rend(); ++it)
+			{
+				char label[32];
+				std::snprintf(label,
+							  std::size(label),
+							  "%04X##%zu",
+							  it->PC,
+							  static_cast<std::size_t>(it - traces.rbegin()));
+				if (ImGui::Selectable(label, false, ImGuiSelectableFlags_SpanAllColumns))
+				{
+					mDisassemblyGoToAddress = it->PC;
+				}
+				ImGui::NextColumn();
+				ImGui::Text("%llu", static_cast<unsigned long long>(it->Hit));
+				ImGui::NextColumn();
+				ImGui::Text("%lld (%llX)",
+							static_cast<long long>(it->Value),
+							static_cast<unsigned long long>(it->Value));
+				ImGui::NextColumn();
+			}
+			ImGui::Columns(1);
+		}
+		ImGui::EndChild();
+	}
+	ImGui::EndChild();
+}
+
+void CInterpreterDebugger::DrawExecutionTrace()
+{
+	const CExecutionTrace* trace = mInterpreter.ExecutionTrace();
+
+	if (ImGui::BeginChild("ExecutionTrace", ImVec2(300.0f, 0.0f), true))
+	{
+		ImGui::TextColored(SubtitleColor, "Last Instructions");
+
+		// the trace is recorded from the interpreter thread, it can only be enabled or read
+		// while paused
+		const bool paused = mInterpreter.IsPaused();
+		if (!trace)
+		{
+			ImGui::Separator();
+			if (!paused)
+			{
+				ImGui::TextDisabled("Pause to enable");
+			}
+			else if (ImGui::Button(ICON_FA_LIST " Enable execution trace"))
+			{
+				mInterpreter.EnableExecutionTrace(true);
+			}
+			ImGui::EndChild();
+			return;
+		}
+
+		ImGui::SameLine();
+		ImGui::Text("| %llu", static_cast<unsigned long long>(trace->Count()));
+
+		ImGui::Separator();
+		if (!paused)
+		{
+			ImGui::TextDisabled("Pause to see them");
+			ImGui::EndChild();
+			return;
+		}
+
+		// newest first, selecting a row scrolls the disassembly to it
+		constexpr std::size_t MaxRows{ 64 };
+		const std::vector<SExecutionTraceEntry> entries = trace->Last(MaxRows);
+		for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+		{
+			std::array<char, SInstruction::MaxFormattedSize> instStr{ "???" };
+			if (auto instOpt = mInterpreter.TryFindInstruction(it->Opcode))
+			{
+				instOpt->get().Format(*instOpt, it->Opcode, it->PC, instStr);
+			}
+
+			char label[48];
+			std::snprintf(label,
+						  std::size(label),
+						  "%04X: %s##%zu",
+						  it->PC,
+						  instStr.data(),
+						  static_cast<std::size_t>(it - entries.rbegin()));
+			if (ImGui::Selectable(label))
+			{
+				mDisassemblyGoToAddress = it->PC;
+			}
+		}
+	}
+	ImGui::EndChild();
+}
+
+void CInterpreterDebugger::DrawPerformance()
+{
+	const CTelemetry::SSnapshot& snapshot = mTelemetry.Snapshot();
 
-	const std::size_t breakpointIndex = mInterpreter.Context().PC / 2;
-	if (mBreakpoints[breakpointIndex])
+	if (ImGui::BeginChild("Performance", ImVec2(0.0f, 0.0f), true))
+	{
+		ImGui::TextColored(SubtitleColor, "Performance");
+		ImGui::Separator();
+
+		ImGui::Text("IPS: %.0f / %zu", snapshot.CyclesPerSecond, CyclesHz);
+		ImGui::Text("Timers: %.1f / %zu Hz", snapshot.TimerTicksPerSecond, TimersHz);
+		ImGui::Text("Max tick: %.1f ms", snapshot.MaxTimerTickInterval);
+		ImGui::Separator();
+		ImGui::Text("Frame p50: %.2f ms", snapshot.FrameTimeP50);
+		ImGui::Text("Frame p95: %.2f ms", snapshot.FrameTimeP95);
+		ImGui::Text("Frame p99: %.2f ms", snapshot.FrameTimeP99);
+		ImGui::Text("Frame max: %.2f ms", snapshot.FrameTimeMax);
+		ImGui::Text("Late: %llu", static_cast<unsigned long long>(snapshot.LateFrames));
+		ImGui::Text("Coalesced: %llu", static_cast<unsigned long long>(snapshot.CoalescedFrames));
+		ImGui::Separator();
+		ImGui::Text("Audio callbacks: %llu",
+					static_cast<unsigned long long>(snapshot.AudioCallbacks));
+		ImGui::Text("Underruns: %llu", static_cast<unsigned long long>(snapshot.AudioUnderruns));
+	}
+	ImGui::EndChild();
+}
+
+void CInterpreterDebugger::DrawHeat(std::uint16_t address, float width, float height)
+{
+	const CHeatmap* heatmap = mInterpreter.Heatmap();
+	const float heat = heatmap ? heatmap->Heat(address) : 0.0f;
+	if (heat > 0.0f)
 	{
-		mInterpreter.Pause(true);
+		// from a faint yellow for cold code to a strong red for the hottest
+		const int green = static_cast<int>(200 * (1.0f - heat));
+		const int alpha = static_cast<int>(40 + 120 * heat);
+		const ImVec2 pos = ImGui::GetCursorScreenPos();
+		ImGui::GetWindowDrawList()->AddRectFilled(
+			pos, ImVec2(pos.x + width, pos.y + height), IM_COL32(255, green, 0, alpha));
 	}
 }
@@ -1,7 +1,14 @@
 #pragma once
 #include "ImGuiWindow.h"
+#include "Telemetry.h"
 #include <array>
+#include <atomic>
+#include <core/ControlFlow.h>
+#include <core/Disassembly.h>
 #include <core/Interpreter.h>
+#include <optional>
+#include <string>
+#include <vector>
 
 class CInterpreterDebugger : public CImGuiWindow
 {
@@ -9,12 +16,21 @@ private:
 	static constexpr std::size_t InvalidDisassemblyGoToAddress = ~0u;
 
 	c8::CInterpreter& mInterpreter;
+	const CTelemetry& mTelemetry;
 	bool mFirstDraw;
-	std::array<bool, (c8::constants::MemorySize / c8::constants::InstructionByteSize)> mBreakpoints;
 	std::size_t mDisassemblyGoToAddress;
+	std::atomic<std::size_t> mBreakpointHitAddress; // Set from the interpreter thread
+	int mWatchSize;                                 // Bytes watched from the selected address
+	std::array<char, 128> mConditionText;           // Breakpoint condition being edited
+	std::array<char, 128> mTraceText;               // Tracepoint expression being edited
+	std::string mConditionError;                    // Why the edited expressions did not compile
+	c8::CDisassembly mDisassembly;                  // Updated before drawing it
+	std::optional<c8::CControlFlow> mControlFlow;   // Analyzed again when the memory changes
+	std::vector<std::uint16_t> mDisassemblyRows;    // Address of each line, from the analysis
 
 public:
-	CInterpreterDebugger(c8::CInterpreter& interpreter);
+	CInterpreterDebugger(c8::CInterpreter& interpreter, const CTelemetry& telemetry);
+	~CInterpreterDebugger();
 
 	void Draw() override;
 
@@ -23,6 +39,22 @@ private:
 	void DrawRegisters();
 	void DrawStack();
 	void DrawMemory();
+	/// Context menu of a memory byte, to watch it and the following bytes.
+	void DrawWatchpointMenu(std::uint16_t address);
+	/// The kind of each memory page, in the title of the memory, if the region map is enabled.
+	void DrawRegionMap();
 	void DrawDisassembly();
-	void CheckBreakpoints();
+	/// Analyzes the program again and splits the memory in the lines of the disassembly: the
+	/// instructions found and, in between, the data and the bytes not reached.
+	void UpdateControlFlow();
+	/// Context menu of a disassembly line, to set the condition or trace of its breakpoint.
+	void DrawBreakpointMenu(std::uint16_t address);
+	void DrawProfiler();
+	void DrawHotSpots();
+	void DrawTracepoints();
+	/// The last instructions of the execution trace, while paused.
+	void DrawExecutionTrace();
+	void DrawPerformance();
+	/// Fills the area at the cursor with the color of the heat of the address.
+	void DrawHeat(std::uint16_t address, float width, float height);
 };
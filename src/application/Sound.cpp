@@ -1,10 +1,11 @@
 #include "Sound.h"
 #include <cmath>
+#include <core/Trace.h>
 #include <stdexcept>
 
 // based on https://stackoverflow.com/a/10111570
 
-CSound::CSound() : mV{}
+CSound::CSound(CTelemetry& telemetry) : mTelemetry{ telemetry }, mV{}
 {
 	SDL_AudioSpec desiredSpec;
 	desiredSpec.freq = Frequency;
@@ -43,6 +44,7 @@ void CSound::Beep(double frequency, std::chrono::milliseconds duration)
 
 void CSound::GenerateSamples(gsl::span<std::int16_t> stream)
 {
+	c8::CTraceScope trace{ "CSound::GenerateSamples" };
 	std::ptrdiff_t i = 0;
 	while (i < stream.size())
 	{
@@ -76,5 +78,15 @@ void CSound::GenerateSamples(gsl::span<std::int16_t> stream)
 
 void CSound::SdlCallback(CSound* self, std::uint8_t* stream, std::int32_t len)
 {
-	self->GenerateSamples({ reinterpret_cast<std::int16_t*>(stream), len / 2 });
+	// SDL owns the audio thread, name it here
+	if (c8::CTracer::Instance().IsEnabled())
+	{
+		c8::CTracer::Instance().SetThreadName("Audio");
+	}
+
+	const std::int32_t sampleCount = len / 2;
+	self->mTelemetry.RecordAudioCallback(std::chrono::duration_cast<CTelemetry::Clock::duration>(
+		std::chrono::duration<double>(static_cast<double>(sampleCount) / Frequency)));
+
+	self->GenerateSamples({ reinterpret_cast<std::int16_t*>(stream), sampleCount });
 }
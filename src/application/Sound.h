@@ -1,5 +1,6 @@
 #pragma once
 #include <SDL2/SDL.h>
+#include "Telemetry.h"
 #include <SDL2/SDL_audio.h>
 #include <chrono>
 #include <cstdint>
@@ -17,12 +18,13 @@ private:
 		std::uint32_t SamplesLeft;
 	};
 
+	CTelemetry& mTelemetry;
 	SDL_AudioDeviceID mDeviceID;
 	std::queue<SBeep> mBeeps;
 	double mV;
 
 public:
-	CSound();
+	CSound(CTelemetry& telemetry);
 	~CSound();
 
 	void Beep(double frequency, std::chrono::milliseconds duration);
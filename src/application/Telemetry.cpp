@@ -0,0 +1,151 @@
+#include "Telemetry.h"
+#include <algorithm>
+#include <core/Constants.h>
+#include <cstdio>
+
+using namespace c8::constants;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+CTelemetry::CTelemetry()
+	: mInterpreter{ { 0 }, { 0 }, { 0 }, { 0 }, {} },
+	  mAudio{ { 0 }, { 0 }, {} },
+	  mRender{},
+	  mSnapshot{}
+{
+}
+
+void CTelemetry::RecordCycles(std::uint64_t count)
+{
+	mInterpreter.Cycles.fetch_add(count, std::memory_order_relaxed);
+}
+
+void CTelemetry::RecordTimerTick()
+{
+	const Clock::time_point now = Clock::now();
+	if (mInterpreter.LastTimerTick != Clock::time_point{})
+	{
+		const std::int64_t interval =
+			std::chrono::nanoseconds(now - mInterpreter.LastTimerTick).count();
+		std::int64_t max = mInterpreter.MaxTimerTickInterval.load(std::memory_order_relaxed);
+		while (interval > max && !mInterpreter.MaxTimerTickInterval.compare_exchange_weak(
+									 max, interval, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	mInterpreter.LastTimerTick = now;
+	mInterpreter.TimerTicks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CTelemetry::RecordDisplayUpdate()
+{
+	mInterpreter.DisplayUpdates.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CTelemetry::RecordAudioCallback(Clock::duration bufferDuration)
+{
+	const Clock::time_point now = Clock::now();
+
+	// the device plays a buffer while the next one is requested, so a callback that comes later
+	// than the buffer lasts, with some margin for the scheduler, means it ran out of samples
+	if (mAudio.LastCallback != Clock::time_point{} &&
+		(now - mAudio.LastCallback) > bufferDuration * 3 / 2)
+	{
+		mAudio.Underruns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	mAudio.LastCallback = now;
+	mAudio.Callbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool CTelemetry::RecordFrame()
+{
+	const Clock::time_point now = Clock::now();
+	if (mRender.LastFrame != Clock::time_point{})
+	{
+		const Clock::duration frameTime = now - mRender.LastFrame;
+		mRender.FrameTimes[mRender.FrameTimeIndex] = Milliseconds(frameTime).count();
+		mRender.FrameTimeIndex = (mRender.FrameTimeIndex + 1) % FrameTimeCount;
+		mRender.FrameCount++;
+
+		if (frameTime > 2 * TimersRate)
+		{
+			mRender.LateFrames++;
+		}
+	}
+	mRender.LastFrame = now;
+
+	// the display only shows the last of the updates done since the previous frame
+	const std::uint64_t displayUpdates =
+		mInterpreter.DisplayUpdates.load(std::memory_order_relaxed);
+	if (displayUpdates - mRender.LastDisplayUpdates > 1)
+	{
+		mRender.CoalescedFrames += displayUpdates - mRender.LastDisplayUpdates - 1;
+	}
+	mRender.LastDisplayUpdates = displayUpdates;
+
+	if (mRender.SnapshotTime == Clock::time_point{})
+	{
+		mRender.SnapshotTime = now;
+	}
+	else if ((now - mRender.SnapshotTime) >= SnapshotPeriod)
+	{
+		TakeSnapshot(now);
+		return true;
+	}
+
+	return false;
+}
+
+std::string CTelemetry::Summary() const
+{
+	std::array<char, 256> summary{};
+	std::snprintf(summary.data(),
+				  summary.size(),
+				  "%.0f/%zu IPS | %.1f/%zu Hz, max %.1f ms | frame p50 %.1f p95 %.1f p99 %.1f ms | "
+				  "%llu late, %llu coalesced | %llu audio underruns",
+				  mSnapshot.CyclesPerSecond,
+				  CyclesHz,
+				  mSnapshot.TimerTicksPerSecond,
+				  TimersHz,
+				  mSnapshot.MaxTimerTickInterval,
+				  mSnapshot.FrameTimeP50,
+				  mSnapshot.FrameTimeP95,
+				  mSnapshot.FrameTimeP99,
+				  static_cast<unsigned long long>(mSnapshot.LateFrames),
+				  static_cast<unsigned long long>(mSnapshot.CoalescedFrames),
+				  static_cast<unsigned long long>(mSnapshot.AudioUnderruns));
+	return summary.data();
+}
+
+void CTelemetry::TakeSnapshot(Clock::time_point now)
+{
+	const double seconds = std::chrono::duration<double>(now - mRender.SnapshotTime).count();
+	const std::uint64_t cycles = mInterpreter.Cycles.load(std::memory_order_relaxed);
+	const std::uint64_t timerTicks = mInterpreter.TimerTicks.load(std::memory_order_relaxed);
+	mSnapshot.CyclesPerSecond = (cycles - mRender.SnapshotCycles) / seconds;
+	mSnapshot.TimerTicksPerSecond = (timerTicks - mRender.SnapshotTimerTicks) / seconds;
+	mSnapshot.MaxTimerTickInterval =
+		mInterpreter.MaxTimerTickInterval.exchange(0, std::memory_order_relaxed) / 1'000'000.0;
+	mRender.SnapshotTime = now;
+	mRender.SnapshotCycles = cycles;
+	mRender.SnapshotTimerTicks = timerTicks;
+
+	const std::size_t count = static_cast<std::size_t>(
+		std::min(mRender.FrameCount, static_cast<std::uint64_t>(FrameTimeCount)));
+	std::array<double, FrameTimeCount> frameTimes = mRender.FrameTimes;
+	std::sort(frameTimes.begin(), frameTimes.begin() + count);
+	auto percentile = [&frameTimes, count](double p) {
+		return count != 0 ? frameTimes[std::min(count - 1, static_cast<std::size_t>(p * count))]
+						  : 0.0;
+	};
+	mSnapshot.FrameTimeP50 = percentile(0.50);
+	mSnapshot.FrameTimeP95 = percentile(0.95);
+	mSnapshot.FrameTimeP99 = percentile(0.99);
+	mSnapshot.FrameTimeMax = percentile(1.0);
+
+	mSnapshot.LateFrames = mRender.LateFrames;
+	mSnapshot.CoalescedFrames = mRender.CoalescedFrames;
+	mSnapshot.AudioCallbacks = mAudio.Callbacks.load(std::memory_order_relaxed);
+	mSnapshot.AudioUnderruns = mAudio.Underruns.load(std::memory_order_relaxed);
+}
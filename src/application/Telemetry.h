@@ -0,0 +1,95 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/// Performance counters of the interpreter, render and audio threads. Each thread has its own
+/// counters, written without locks, and the render thread reads them to summarize the last second.
+class CTelemetry
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr std::size_t FrameTimeCount{ 256 }; // Render frame times kept for percentiles
+	static constexpr Clock::duration SnapshotPeriod{ std::chrono::seconds(1) };
+
+	/// Rates over the last snapshot period, percentiles of the last FrameTimeCount frame times and
+	/// totals since the start. Times in milliseconds.
+	struct SSnapshot
+	{
+		double CyclesPerSecond;
+		double TimerTicksPerSecond;
+		double MaxTimerTickInterval;
+		double FrameTimeP50;
+		double FrameTimeP95;
+		double FrameTimeP99;
+		double FrameTimeMax;
+		std::uint64_t LateFrames;      // Renders that took longer than two timer ticks
+		std::uint64_t CoalescedFrames; // Display updates replaced by another before being rendered
+		std::uint64_t AudioCallbacks;
+		std::uint64_t AudioUnderruns; // Audio callbacks that came later than the buffer lasts
+	};
+
+private:
+	// each group is on its own cache line so the threads do not invalidate each other's
+	struct alignas(64) SInterpreterCounters
+	{
+		std::atomic<std::uint64_t> Cycles;
+		std::atomic<std::uint64_t> TimerTicks;
+		std::atomic<std::uint64_t> DisplayUpdates;
+		std::atomic<std::int64_t> MaxTimerTickInterval; // Nanoseconds, reset on every snapshot
+		Clock::time_point LastTimerTick;
+	};
+
+	struct alignas(64) SAudioCounters
+	{
+		std::atomic<std::uint64_t> Callbacks;
+		std::atomic<std::uint64_t> Underruns;
+		Clock::time_point LastCallback;
+	};
+
+	// only used by the render thread
+	struct SRenderState
+	{
+		Clock::time_point LastFrame;
+		std::array<double, FrameTimeCount> FrameTimes;
+		std::size_t FrameTimeIndex;
+		std::uint64_t FrameCount;
+		std::uint64_t LateFrames;
+		std::uint64_t CoalescedFrames;
+		std::uint64_t LastDisplayUpdates;
+		Clock::time_point SnapshotTime;
+		std::uint64_t SnapshotCycles;
+		std::uint64_t SnapshotTimerTicks;
+	};
+
+	SInterpreterCounters mInterpreter;
+	SAudioCounters mAudio;
+	SRenderState mRender;
+	SSnapshot mSnapshot;
+
+public:
+	CTelemetry();
+
+	CTelemetry(const CTelemetry&) = delete;
+	CTelemetry& operator=(const CTelemetry&) = delete;
+
+	/// Called from the interpreter thread.
+	void RecordCycles(std::uint64_t count);
+	void RecordTimerTick();
+	void RecordDisplayUpdate();
+
+	/// Called from the audio thread, with the time the audio requested lasts.
+	void RecordAudioCallback(Clock::duration bufferDuration);
+
+	/// Called from the render thread once per frame. Returns whether a new snapshot was taken.
+	bool RecordFrame();
+	inline const SSnapshot& Snapshot() const { return mSnapshot; }
+	/// The snapshot in a single line.
+	std::string Summary() const;
+
+private:
+	void TakeSnapshot(Clock::time_point now);
+};
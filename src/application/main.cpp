@@ -1,9 +1,13 @@
 #include "AppPlatform.h"
 #include "InterpreterDebugger.h"
 #include <core/Interpreter.h>
+#include <core/Movie.h>
+#include <core/Trace.h>
+#include <fstream>
 #include <gsl/gsl_util>
 #include <iostream>
 #include <optional>
+#include <random>
 #include <tclap/CmdLine.h>
 #include <thread>
 #include <vector>
@@ -21,38 +25,177 @@ int main(int argc, char* argv[])
 								 "Specifies whether to open the debugger GUI.",
 								 false);
 
+	TCLAP::ValueArg<std::string> playArg("p",
+										 "play",
+										 "Specifies the movie to play back.",
+										 false,
+										 "",
+										 "movie_file");
+	TCLAP::ValueArg<std::string> recordArg("r",
+										   "record",
+										   "Specifies the file where to record a movie.",
+										   false,
+										   "",
+										   "movie_file");
+	TCLAP::ValueArg<std::uint32_t> seedArg(
+		"s",
+		"seed",
+		"Specifies the seed of the random number generator. Ignored when playing a movie.",
+		false,
+		0,
+		"seed");
+	TCLAP::ValueArg<std::string> traceArg(
+		"t",
+		"trace",
+		"Specifies the file where to write a Chrome trace of the last seconds of the interpreter, "
+		"render and audio threads when exiting. Tracing can also be started with F12 and written "
+		"by pressing it again.",
+		false,
+		"trace.json",
+		"trace_file");
+
 	cmd.add(inputArg);
 	cmd.add(debuggerArg);
+	cmd.add(playArg);
+	cmd.add(recordArg);
+	cmd.add(seedArg);
+	cmd.add(traceArg);
 
 	cmd.parse(argc, argv);
 
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
 	auto sdlQuit = gsl::finally(&SDL_Quit);
 
+	c8::CTracer& tracer = c8::CTracer::Instance();
+	tracer.SetThreadName("Main");
+	tracer.Enable(traceArg.isSet());
+	auto writeTrace = [&tracer, &traceArg]() {
+		std::ofstream traceFile(traceArg.getValue());
+		tracer.WriteChromeJson(traceFile);
+	};
+
 	try
 	{
 		std::shared_ptr<CAppPlatform> platform = std::make_shared<CAppPlatform>();
 		c8::CInterpreter interpreter(platform);
 		interpreter.LoadProgram(inputArg.getValue());
 
+		std::uint32_t seed = seedArg.isSet() ? seedArg.getValue() : std::random_device{}();
+
+		std::optional<c8::CMovie> playback{ std::nullopt };
+		if (playArg.isSet())
+		{
+			playback.emplace(c8::CMovie::Load(playArg.getValue()));
+			if (playback->ProgramHash() != interpreter.ProgramHash())
+			{
+				throw std::runtime_error("Movie '" + playArg.getValue() +
+										 "' was recorded with a different program");
+			}
+
+			seed = playback->RandomSeed();
+		}
+
+		interpreter.SetRandomSeed(seed);
+		interpreter.EnableIdleSkip(true);
+
+		std::optional<c8::CMovie> recording{ std::nullopt };
+		if (recordArg.isSet())
+		{
+			recording.emplace(interpreter.ProgramHash(), seed);
+		}
+
+		// movies are recorded and played back one frame at a time, in virtual time
+		const bool frameLocked = playback.has_value() || recording.has_value();
+		if (frameLocked && debuggerArg.getValue())
+		{
+			throw std::invalid_argument("The debugger cannot be used while recording or playing "
+										"a movie");
+		}
+
 		std::optional<CInterpreterDebugger> debugger{ std::nullopt };
 		if (debuggerArg.getValue())
 		{
-			debugger.emplace(interpreter);
+			debugger.emplace(interpreter, platform->Telemetry());
 
 			// if the debugger GUI is shown, pause the program execution until the user starts it
 			interpreter.Pause(true);
 		}
 
+		CTelemetry& telemetry = platform->Telemetry();
+		bool showTelemetry = false;
 		bool quit = false;
 
 		// TODO: CInterpreter is not fully thread-safe
-		std::thread interpreterThread([&interpreter, &quit]() {
+		std::thread interpreterThread([&]() {
+			tracer.SetThreadName("Interpreter");
+
+			if (!frameLocked)
+			{
+				std::uint64_t idleSkippedCycles = 0;
+				while (!quit)
+				{
+					std::this_thread::yield();
+
+					const c8::SUpdateResult result = interpreter.Update();
+					const std::uint64_t skipped =
+						interpreter.IdleSkippedCycles() - idleSkippedCycles;
+					idleSkippedCycles += skipped;
+					if (result.Cycle || skipped != 0)
+					{
+						// the skipped cycles count as run, the program is where it would be
+						telemetry.RecordCycles((result.Cycle ? 1 : 0) + skipped);
+					}
+					if (result.TimerTick)
+					{
+						telemetry.RecordTimerTick();
+					}
+					if (result.Idle)
+					{
+						// nothing changes until then, other than the keyboard
+						std::this_thread::sleep_until(interpreter.NextTimerTickTime());
+					}
+				}
+				return;
+			}
+
+			c8::SKeyboardState keyboard{};
+			std::uint32_t frame = 0;
+			auto nextFrameTime = std::chrono::steady_clock::now();
 			while (!quit)
 			{
-				std::this_thread::yield();
+				std::this_thread::sleep_until(nextFrameTime);
+				nextFrameTime += c8::constants::TimersRate;
+
+				if (playback.has_value())
+				{
+					if (frame >= playback->FrameCount())
+					{
+						// end of the movie
+						interpreter.Pause(true);
+						continue;
+					}
+
+					playback->GetFrame(frame, keyboard);
+				}
+				else
+				{
+					platform->GetKeyboardState(keyboard);
+				}
+
+				if (recording.has_value())
+				{
+					recording->RecordFrame(keyboard);
+				}
+
+				const bool running = !interpreter.Context().Exited;
+				interpreter.RunFrame(keyboard);
+				frame++;
 
-				interpreter.Update();
+				if (running)
+				{
+					telemetry.RecordCycles(c8::constants::CyclesPerFrame);
+					telemetry.RecordTimerTick();
+				}
 			}
 		});
 
@@ -60,6 +203,14 @@ int main(int argc, char* argv[])
 		{
 			std::this_thread::yield();
 
+			if (telemetry.RecordFrame() && showTelemetry)
+			{
+				platform->Display().SetTitle(std::string{ CDisplay::WindowTitle } + " | " +
+											 telemetry.Summary());
+			}
+
+			c8::CTraceScope frameTrace{ "Main loop" };
+			c8::CTraceScope eventsTrace{ "SDL events" };
 			SDL_Event e;
 			while (SDL_PollEvent(&e))
 			{
@@ -68,7 +219,8 @@ int main(int argc, char* argv[])
 				{
 					quit = true;
 				}
-				else if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F5)
+				else if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F5 &&
+						 !frameLocked) // the frame-locked loop does not stop while paused
 				{
 					// Pause because CInterpreter is not thread-safe so it could try modify the
 					// state while saving it. Not the ideal solution, could still cause issues.
@@ -76,7 +228,8 @@ int main(int argc, char* argv[])
 					interpreter.SaveState("save.ch8save");
 					interpreter.Pause(false);
 				}
-				else if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F8)
+				else if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F8 &&
+						 !frameLocked) // loading a state would make the movie out of sync
 				{
 					// Pause because CInterpreter is not thread-safe so it could try to execute
 					// the program while loading the state. Not the ideal solution, could still
@@ -85,12 +238,35 @@ int main(int argc, char* argv[])
 					interpreter.LoadState("save.ch8save");
 					interpreter.Pause(false);
 				}
+				else if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F3)
+				{
+					// the telemetry is shown in the title, updated once per snapshot
+					showTelemetry = !showTelemetry;
+					if (!showTelemetry)
+					{
+						platform->Display().SetTitle(CDisplay::WindowTitle);
+					}
+				}
+				else if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F12)
+				{
+					// the first press starts tracing, the next ones write what was traced so far
+					if (tracer.IsEnabled())
+					{
+						writeTrace();
+					}
+					else
+					{
+						tracer.Clear();
+						tracer.Enable(true);
+					}
+				}
 
 				if (debugger.has_value())
 				{
 					debugger->ProcessEvent(e);
 				}
 			}
+			eventsTrace.End();
 
 			if (debugger.has_value())
 			{
@@ -103,6 +279,16 @@ int main(int argc, char* argv[])
 		{
 			interpreterThread.join();
 		}
+
+		if (recording.has_value())
+		{
+			recording->Save(recordArg.getValue());
+		}
+
+		if (traceArg.isSet())
+		{
+			writeTrace();
+		}
 	}
 	catch (const std::exception& e)
 	{
@@ -0,0 +1,146 @@
+#include <core/Batch.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <tclap/CmdLine.h>
+
+namespace fs = std::filesystem;
+
+static std::shared_ptr<const std::vector<std::uint8_t>> ReadProgram(const fs::path& filePath)
+{
+	if (!fs::is_regular_file(filePath))
+	{
+		throw std::invalid_argument("Path '" + filePath.string() + "' is an invalid file");
+	}
+
+	std::ifstream file(filePath, std::ios::in | std::ios::binary);
+	return std::make_shared<const std::vector<std::uint8_t>>(std::istreambuf_iterator<char>{ file },
+															   std::istreambuf_iterator<char>{});
+}
+
+int main(int argc, char* argv[])
+{
+	TCLAP::CmdLine cmd("Chip-8 batch runner", ' ', "WIP");
+	TCLAP::UnlabeledMultiArg<std::string> inputArg("input_files",
+												   "Specifies the filenames of the program ROMs.",
+												   true,
+												   "input_files");
+	TCLAP::MultiArg<std::string> playArg(
+		"p",
+		"play",
+		"Specifies a movie to play back, against every program it was recorded with.",
+		false,
+		"movie_file");
+	TCLAP::ValueArg<std::uint32_t> framesArg(
+		"f",
+		"frames",
+		"Specifies the number of frames to run each job. Movies stop earlier if they are shorter.",
+		true,
+		0,
+		"frames");
+	TCLAP::ValueArg<std::uint32_t> seedArg(
+		"s",
+		"seed",
+		"Specifies the seed of the first run of each program. Ignored when playing movies.",
+		false,
+		0,
+		"seed");
+	TCLAP::ValueArg<std::uint32_t> runsArg(
+		"n",
+		"runs",
+		"Specifies the number of runs of each program, with consecutive seeds. Defaults to 1.",
+		false,
+		1,
+		"runs");
+	TCLAP::ValueArg<std::size_t> threadsArg(
+		"t",
+		"threads",
+		"Specifies the number of worker threads. Defaults to the number of hardware threads.",
+		false,
+		std::thread::hardware_concurrency(),
+		"threads");
+
+	cmd.add(inputArg);
+	cmd.add(playArg);
+	cmd.add(framesArg);
+	cmd.add(seedArg);
+	cmd.add(runsArg);
+	cmd.add(threadsArg);
+
+	cmd.parse(argc, argv);
+
+	try
+	{
+		c8::CBatchRunner runner{ threadsArg.getValue() };
+
+		// programs are loaded once and shared by every job
+		std::vector<std::shared_ptr<const std::vector<std::uint8_t>>> programs{};
+		std::vector<std::uint64_t> programHashes{};
+		for (const std::string& input : inputArg.getValue())
+		{
+			programs.push_back(ReadProgram(input));
+			programHashes.push_back(c8::CInterpreter::HashProgram(*programs.back()));
+		}
+
+		std::vector<c8::SBatchJob> jobs{};
+		std::vector<std::string> jobNames{};
+		if (playArg.isSet())
+		{
+			for (const std::string& moviePath : playArg.getValue())
+			{
+				const auto movie = std::make_shared<const c8::CMovie>(c8::CMovie::Load(moviePath));
+				for (std::size_t i = 0; i < programs.size(); i++)
+				{
+					if (programHashes[i] == movie->ProgramHash())
+					{
+						jobs.push_back({ programs[i], movie, framesArg.getValue(), 0 });
+						jobNames.push_back(inputArg.getValue()[i] + " (" + moviePath + ")");
+					}
+				}
+			}
+		}
+		else
+		{
+			for (std::size_t i = 0; i < programs.size(); i++)
+			{
+				for (std::uint32_t run = 0; run < runsArg.getValue(); run++)
+				{
+					const std::uint32_t seed = seedArg.getValue() + run;
+					jobs.push_back({ programs[i], nullptr, framesArg.getValue(), seed });
+					jobNames.push_back(inputArg.getValue()[i] + " (seed " +
+									   std::to_string(seed) + ")");
+				}
+			}
+		}
+
+		if (jobs.empty())
+		{
+			throw std::invalid_argument("No movie was recorded with any of the programs");
+		}
+
+		std::vector<c8::SBatchResult> results{};
+		const c8::SBatchStats stats = runner.Run(jobs, results);
+
+		for (std::size_t i = 0; i < results.size(); i++)
+		{
+			if (!results[i].Error.empty())
+			{
+				std::cerr << jobNames[i] << ": " << results[i].Error << std::endl;
+			}
+		}
+
+		std::cout << "Ran " << stats.JobCount << " jobs (" << stats.FailedJobCount << " failed) on "
+				  << runner.ThreadCount() << " threads" << std::endl;
+		std::cout << "Ran " << stats.FrameCount << " frames, " << stats.CycleCount()
+				  << " cycles in " << stats.Duration.count() << " s ("
+				  << static_cast<std::uint64_t>(stats.CyclesPerSecond()) << " cycles/s)"
+				  << std::endl;
+
+		return stats.FailedJobCount == 0 ? 0 : 1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,368 @@
+#include "c8.h"
+#include <algorithm>
+#include <core/Interpreter.h>
+#include <filesystem>
+#include <gsl/gsl_assert>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+struct c8_interpreter
+{
+	c8::CInterpreter Interpreter;
+};
+
+namespace
+{
+	thread_local std::string LastError{};
+
+	class CCallbackPlatform : public c8::IPlatform
+	{
+	private:
+		c8_platform mCallbacks;
+
+	public:
+		CCallbackPlatform(const c8_platform& callbacks) : mCallbacks{ callbacks } {}
+
+		void GetKeyboardState(c8::SKeyboardState& dest) override
+		{
+			if (mCallbacks.get_keyboard_state)
+			{
+				const std::uint16_t keys = mCallbacks.get_keyboard_state(mCallbacks.user_data);
+				c8::UnpackKeyboardState(keys, dest);
+			}
+		}
+
+		void UpdateDisplay(const c8::SDisplay& display) override
+		{
+			if (mCallbacks.update_display)
+			{
+				const auto words = display.PixelBuffer.Words();
+				mCallbacks.update_display(mCallbacks.user_data,
+										  words.data(),
+										  static_cast<std::size_t>(words.size()),
+										  display.ExtendedMode);
+			}
+		}
+
+		void Beep(double frequency, std::chrono::milliseconds duration) override
+		{
+			if (mCallbacks.beep)
+			{
+				mCallbacks.beep(mCallbacks.user_data,
+								frequency,
+								static_cast<std::uint32_t>(duration.count()));
+			}
+		}
+	};
+
+	/// Reads from and writes to a caller buffer, without copying it.
+	class CBufferStreamBuf : public std::streambuf
+	{
+	public:
+		CBufferStreamBuf(char* data, std::size_t size)
+		{
+			setg(data, data, data + size);
+			setp(data, data + size);
+		}
+
+		inline std::size_t WrittenSize() const
+		{
+			return static_cast<std::size_t>(pptr() - pbase());
+		}
+	};
+
+	c8_result Fail(c8_result result, const std::string& message)
+	{
+		LastError = message;
+		return result;
+	}
+
+	/// Runs the function, converting any exception to a result so none crosses the ABI.
+	template<class F>
+	c8_result Guard(F&& function)
+	{
+		try
+		{
+			return function();
+		}
+		catch (const gsl::fail_fast& e)
+		{
+			return Fail(C8_ERROR_CONTRACT_VIOLATION, e.what());
+		}
+		catch (const std::invalid_argument& e)
+		{
+			return Fail(C8_ERROR_INVALID_ARGUMENT, e.what());
+		}
+		catch (const std::exception& e)
+		{
+			return Fail(C8_ERROR_RUNTIME, e.what());
+		}
+		catch (...)
+		{
+			return Fail(C8_ERROR_INTERNAL, "Unknown error");
+		}
+	}
+
+	/// As Guard, but a runtime error caused by the opcode in IR not existing is reported as such.
+	template<class F>
+	c8_result GuardExecution(c8_interpreter* interpreter, F&& function)
+	{
+		const c8_result result = Guard(std::forward<F>(function));
+		if (result == C8_ERROR_RUNTIME &&
+			!c8::CInterpreter::TryFindInstruction(interpreter->Interpreter.Context().IR))
+		{
+			return C8_ERROR_UNSUPPORTED_INSTRUCTION;
+		}
+		return result;
+	}
+}
+
+extern "C" {
+
+uint32_t c8_abi_version(void) { return C8_ABI_VERSION; }
+
+const char* c8_last_error(void) { return LastError.c_str(); }
+
+c8_result c8_create(const c8_platform* platform, c8_interpreter** interpreter)
+{
+	if (!interpreter)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter");
+	}
+
+	return Guard([&]() {
+		const c8_platform callbacks = platform ? *platform : c8_platform{};
+		*interpreter = new c8_interpreter{ c8::CInterpreter{
+			std::make_shared<CCallbackPlatform>(callbacks) } };
+		return C8_OK;
+	});
+}
+
+void c8_destroy(c8_interpreter* interpreter) { delete interpreter; }
+
+c8_result c8_fork(const c8_interpreter* interpreter, c8_interpreter** fork)
+{
+	if (!interpreter || !fork)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter");
+	}
+
+	return Guard([&]() {
+		*fork = new c8_interpreter{ interpreter->Interpreter.Fork() };
+		return C8_OK;
+	});
+}
+
+c8_result c8_set_random_seed(c8_interpreter* interpreter, uint32_t seed)
+{
+	if (!interpreter)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter");
+	}
+
+	interpreter->Interpreter.SetRandomSeed(seed);
+	return C8_OK;
+}
+
+c8_result c8_load_program(c8_interpreter* interpreter, const uint8_t* program, size_t size)
+{
+	if (!interpreter || (!program && size > 0))
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter or program");
+	}
+
+	return Guard([&]() {
+		interpreter->Interpreter.LoadProgram(
+			gsl::span<const std::uint8_t>{ program, program + size });
+		return C8_OK;
+	});
+}
+
+c8_result c8_load_program_file(c8_interpreter* interpreter, const char* path)
+{
+	if (!interpreter || !path)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter or path");
+	}
+
+	return Guard([&]() {
+		interpreter->Interpreter.LoadProgram(std::filesystem::u8path(path));
+		return C8_OK;
+	});
+}
+
+c8_result c8_run_cycles(c8_interpreter* interpreter, uint64_t count, uint64_t* executed)
+{
+	if (!interpreter)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter");
+	}
+
+	return GuardExecution(interpreter, [&]() {
+		const std::uint64_t n = interpreter->Interpreter.RunCycles(count);
+		if (executed)
+		{
+			*executed = n;
+		}
+		return C8_OK;
+	});
+}
+
+c8_result c8_run_frames(c8_interpreter* interpreter, uint16_t keys, uint32_t count)
+{
+	if (!interpreter)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter");
+	}
+
+	return GuardExecution(interpreter, [&]() {
+		c8::SKeyboardState keyboard{};
+		c8::UnpackKeyboardState(keys, keyboard);
+		for (std::uint32_t i = 0; i < count; i++)
+		{
+			interpreter->Interpreter.RunFrame(keyboard);
+		}
+		return C8_OK;
+	});
+}
+
+int c8_has_exited(const c8_interpreter* interpreter)
+{
+	return interpreter && interpreter->Interpreter.Context().Exited;
+}
+
+uint16_t c8_program_counter(const c8_interpreter* interpreter)
+{
+	return interpreter ? interpreter->Interpreter.Context().PC : 0;
+}
+
+c8_result c8_copy_registers(const c8_interpreter* interpreter, uint8_t* registers)
+{
+	if (!interpreter || !registers)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter or buffer");
+	}
+
+	const auto& v = interpreter->Interpreter.Context().V;
+	std::copy(v.begin(), v.end(), registers);
+	return C8_OK;
+}
+
+c8_result c8_read_memory(const c8_interpreter* interpreter,
+						 uint16_t address,
+						 uint8_t* buffer,
+						 size_t size)
+{
+	if (!interpreter || (!buffer && size > 0))
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter or buffer");
+	}
+
+	return Guard([&]() {
+		interpreter->Interpreter.Context().Memory.Read(
+			address, gsl::span<std::uint8_t>{ buffer, buffer + size });
+		return C8_OK;
+	});
+}
+
+uint64_t c8_state_hash(const c8_interpreter* interpreter)
+{
+	return interpreter ? interpreter->Interpreter.Context().Hash() : 0;
+}
+
+c8_result c8_copy_framebuffer(const c8_interpreter* interpreter,
+							  uint64_t* words,
+							  size_t* word_count,
+							  int* extended_mode)
+{
+	if (!interpreter || !word_count)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter or word count");
+	}
+
+	const c8::SDisplay& display = interpreter->Interpreter.Context().Display;
+	const auto source = display.PixelBuffer.Words();
+	const std::size_t capacity = *word_count;
+	*word_count = static_cast<std::size_t>(source.size());
+	if (extended_mode)
+	{
+		*extended_mode = display.ExtendedMode;
+	}
+
+	if (!words || capacity < *word_count)
+	{
+		return Fail(C8_ERROR_BUFFER_TOO_SMALL, "Framebuffer buffer too small");
+	}
+
+	std::copy(source.begin(), source.end(), words);
+	return C8_OK;
+}
+
+c8_result c8_save_state(const c8_interpreter* interpreter, uint8_t* buffer, size_t* size)
+{
+	if (!interpreter || !size)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter or size");
+	}
+
+	return Guard([&]() {
+		if (buffer)
+		{
+			CBufferStreamBuf streamBuffer{ reinterpret_cast<char*>(buffer), *size };
+			std::ostream stream{ &streamBuffer };
+			interpreter->Interpreter.SaveState(stream);
+			if (stream)
+			{
+				*size = streamBuffer.WrittenSize();
+				return C8_OK;
+			}
+		}
+
+		// measure the state to report the size required
+		std::ostringstream stream{};
+		interpreter->Interpreter.SaveState(stream);
+		*size = static_cast<std::size_t>(stream.tellp());
+		return Fail(C8_ERROR_BUFFER_TOO_SMALL, "State buffer too small");
+	});
+}
+
+c8_result c8_load_state(c8_interpreter* interpreter, const uint8_t* buffer, size_t size)
+{
+	if (!interpreter || !buffer)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null interpreter or buffer");
+	}
+
+	return Guard([&]() {
+		// the buffer is only read, the stream buffer needs a mutable pointer for both directions
+		CBufferStreamBuf streamBuffer{ reinterpret_cast<char*>(const_cast<uint8_t*>(buffer)),
+									   size };
+		std::istream stream{ &streamBuffer };
+		interpreter->Interpreter.LoadState(stream);
+		return C8_OK;
+	});
+}
+
+c8_result c8_find_instruction(uint16_t opcode, const char** name)
+{
+	if (!name)
+	{
+		return Fail(C8_ERROR_INVALID_ARGUMENT, "Null name");
+	}
+
+	return Guard([&]() {
+		const auto instruction = c8::CInterpreter::TryFindInstruction(opcode);
+		if (!instruction)
+		{
+			*name = nullptr;
+			return Fail(C8_ERROR_UNSUPPORTED_INSTRUCTION, "Unsupported instruction");
+		}
+
+		*name = instruction->get().Name.c_str();
+		return C8_OK;
+	});
+}
+}
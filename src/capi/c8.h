@@ -0,0 +1,101 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/// C interface of the interpreter core, for embedding it in other runtimes. No exception crosses
+/// it, failures are returned as a c8_result and c8_last_error describes the last one.
+
+#if defined(_WIN32)
+#if defined(C8_CAPI_EXPORTS)
+#define C8_API __declspec(dllexport)
+#else
+#define C8_API __declspec(dllimport)
+#endif
+#else
+#define C8_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define C8_ABI_VERSION 1
+
+typedef enum c8_result
+{
+	C8_OK = 0,
+	C8_ERROR_INVALID_ARGUMENT = 1,         // A null handle or buffer, or an invalid program or path
+	C8_ERROR_UNSUPPORTED_INSTRUCTION = 2,  // The program reached an opcode that does not exist
+	C8_ERROR_CONTRACT_VIOLATION = 3,       // The program broke a precondition, e.g. stack overflow
+	C8_ERROR_BUFFER_TOO_SMALL = 4,         // The required size is returned in the size argument
+	C8_ERROR_RUNTIME = 5,                  // Any other failure, such as an unreadable file
+	C8_ERROR_INTERNAL = 6,
+} c8_result;
+
+typedef struct c8_interpreter c8_interpreter;
+
+/// Callbacks used by the interpreter, any of them can be null. The display is updated every time
+/// the program draws, so bulk users may prefer to leave update_display null and poll it with
+/// c8_copy_framebuffer instead.
+typedef struct c8_platform
+{
+	void* user_data;
+	/// Returns the keys that are down, bit N is set if the key N is down.
+	uint16_t (*get_keyboard_state)(void* user_data);
+	/// Pixel N, indexed as x + y * width, is bit N % 64 of words[N / 64]. The width is 128 in
+	/// extended mode and 64 otherwise.
+	void (*update_display)(void* user_data,
+						   const uint64_t* words,
+						   size_t word_count,
+						   int extended_mode);
+	void (*beep)(void* user_data, double frequency, uint32_t duration_ms);
+} c8_platform;
+
+C8_API uint32_t c8_abi_version(void);
+/// Message of the last failure in the calling thread, empty if there is none.
+C8_API const char* c8_last_error(void);
+
+/// The platform is copied, it can be null if no callbacks are needed.
+C8_API c8_result c8_create(const c8_platform* platform, c8_interpreter** interpreter);
+C8_API void c8_destroy(c8_interpreter* interpreter);
+/// Creates an interpreter with the same state, sharing the memory pages until written to.
+C8_API c8_result c8_fork(const c8_interpreter* interpreter, c8_interpreter** fork);
+
+C8_API c8_result c8_set_random_seed(c8_interpreter* interpreter, uint32_t seed);
+C8_API c8_result c8_load_program(c8_interpreter* interpreter, const uint8_t* program, size_t size);
+C8_API c8_result c8_load_program_file(c8_interpreter* interpreter, const char* path);
+
+/// Runs cycles in virtual time, with the timers ticking every frame and the keyboard read from
+/// the platform at the start of each frame. executed can be null.
+C8_API c8_result c8_run_cycles(c8_interpreter* interpreter, uint64_t count, uint64_t* executed);
+/// Runs whole frames with the given keys down, bit N set if the key N is down.
+C8_API c8_result c8_run_frames(c8_interpreter* interpreter, uint16_t keys, uint32_t count);
+C8_API int c8_has_exited(const c8_interpreter* interpreter);
+C8_API uint16_t c8_program_counter(const c8_interpreter* interpreter);
+/// Copies the 16 V registers.
+C8_API c8_result c8_copy_registers(const c8_interpreter* interpreter, uint8_t* registers);
+C8_API c8_result c8_read_memory(const c8_interpreter* interpreter,
+								uint16_t address,
+								uint8_t* buffer,
+								size_t size);
+C8_API uint64_t c8_state_hash(const c8_interpreter* interpreter);
+
+/// Copies the packed display, in the format given to c8_platform.update_display. word_count is
+/// updated with the number of words of the display.
+C8_API c8_result c8_copy_framebuffer(const c8_interpreter* interpreter,
+									 uint64_t* words,
+									 size_t* word_count,
+									 int* extended_mode);
+
+/// Serializes the state in the same format as the save state files. size is updated with the
+/// number of bytes of the state.
+C8_API c8_result c8_save_state(const c8_interpreter* interpreter, uint8_t* buffer, size_t* size);
+/// Fails with C8_ERROR_INVALID_ARGUMENT and keeps the state if the buffer is not a whole state.
+C8_API c8_result c8_load_state(c8_interpreter* interpreter, const uint8_t* buffer, size_t size);
+
+/// Name of the instruction that executes the opcode, owned by the library.
+C8_API c8_result c8_find_instruction(uint16_t opcode, const char** name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,197 @@
+#include "Batch.h"
+#include <algorithm>
+#include <deque>
+#include <doctest/doctest.h>
+#include <mutex>
+#include <optional>
+
+namespace c8
+{
+	struct SWorkerQueue
+	{
+		std::mutex Mutex;
+		std::deque<std::size_t> Jobs;
+	};
+
+	static std::optional<std::size_t> TakeJob(std::vector<SWorkerQueue>& queues, std::size_t worker)
+	{
+		// take the most recently queued job from the own queue
+		{
+			SWorkerQueue& own = queues[worker];
+			std::lock_guard lock{ own.Mutex };
+			if (!own.Jobs.empty())
+			{
+				const std::size_t job = own.Jobs.back();
+				own.Jobs.pop_back();
+				return job;
+			}
+		}
+
+		// steal the oldest job from another queue
+		for (std::size_t i = 1; i < queues.size(); i++)
+		{
+			SWorkerQueue& victim = queues[(worker + i) % queues.size()];
+			std::lock_guard lock{ victim.Mutex };
+			if (!victim.Jobs.empty())
+			{
+				const std::size_t job = victim.Jobs.front();
+				victim.Jobs.pop_front();
+				return job;
+			}
+		}
+
+		// no jobs are added while running, so all the work is done
+		return std::nullopt;
+	}
+
+	CBatchRunner::CBatchRunner(std::size_t threadCount) : mInterpreters{}
+	{
+		const auto platform = std::make_shared<CNullPlatform>();
+		for (std::size_t i = 0; i < std::max(threadCount, std::size_t{ 1 }); i++)
+		{
+			// the results are the same, the programs just get through their idle loops faster
+			mInterpreters.emplace_back(platform).EnableIdleSkip(true);
+		}
+	}
+
+	SBatchStats CBatchRunner::Run(const std::vector<SBatchJob>& jobs,
+								  std::vector<SBatchResult>& results,
+								  const FBatchJobFinished& onJobFinished)
+	{
+		results.assign(jobs.size(), SBatchResult{ 0, false, {} });
+
+		// split the jobs in contiguous chunks, workers only steal once they finish their own
+		std::vector<SWorkerQueue> queues(ThreadCount());
+		for (std::size_t i = 0; i < jobs.size(); i++)
+		{
+			queues[i * queues.size() / jobs.size()].Jobs.push_back(i);
+		}
+
+		auto work = [&](std::size_t worker) {
+			CInterpreter& interpreter = mInterpreters[worker];
+			while (auto job = TakeJob(queues, worker))
+			{
+				RunJob(interpreter, jobs[job.value()], results[job.value()]);
+
+				if (onJobFinished)
+				{
+					onJobFinished(job.value(), interpreter);
+				}
+			}
+		};
+
+		const auto start = std::chrono::steady_clock::now();
+
+		// the calling thread acts as the first worker
+		std::vector<std::thread> threads{};
+		for (std::size_t worker = 1; worker < ThreadCount(); worker++)
+		{
+			threads.emplace_back(work, worker);
+		}
+		work(0);
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		SBatchStats stats{ jobs.size(), 0, 0, std::chrono::steady_clock::now() - start };
+		for (const SBatchResult& result : results)
+		{
+			stats.FrameCount += result.FramesRun;
+			if (!result.Error.empty())
+			{
+				stats.FailedJobCount++;
+			}
+		}
+		return stats;
+	}
+
+	void CBatchRunner::RunJob(CInterpreter& interpreter, const SBatchJob& job, SBatchResult& result)
+	{
+		try
+		{
+			interpreter.SetRandomSeed(job.Movie ? job.Movie->RandomSeed() : job.RandomSeed);
+			interpreter.LoadProgram(*job.Program);
+
+			std::uint32_t frameCount = job.FrameCount;
+			if (job.Movie)
+			{
+				if (job.Movie->ProgramHash() != interpreter.ProgramHash())
+				{
+					throw std::runtime_error("Movie was recorded with a different program");
+				}
+
+				frameCount = std::min(frameCount, job.Movie->FrameCount());
+			}
+
+			SKeyboardState keyboard{};
+			for (std::uint32_t frame = 0; frame < frameCount && !interpreter.Context().Exited;
+				 frame++)
+			{
+				if (job.Movie)
+				{
+					job.Movie->GetFrame(frame, keyboard);
+				}
+
+				interpreter.RunFrame(keyboard);
+				result.FramesRun++;
+			}
+
+			result.Exited = interpreter.Context().Exited;
+		}
+		catch (const std::exception& e)
+		{
+			result.Error = e.what();
+		}
+	}
+}
+
+TEST_CASE("Batch runner")
+{
+	using namespace c8;
+
+	// draws random sprites from the fontset forever
+	using SProgram = std::vector<std::uint8_t>;
+	const auto program = std::make_shared<const SProgram>(SProgram{
+		0xC0, 0x1F, // RND V0, 1F
+		0xC1, 0x0F, // RND V1, 0F
+		0xF1, 0x29, // LD F, V1
+		0xC2, 0x3F, // RND V2, 3F
+		0xD2, 0x05, // DRW V2, V0, 5
+		0x12, 0x00, // JP 200
+	});
+	const auto invalidProgram = std::make_shared<const SProgram>(SProgram{ 0xFF, 0xFF });
+
+	std::vector<SBatchJob> jobs{};
+	for (std::uint32_t i = 0; i < 64; i++)
+	{
+		jobs.push_back({ program, nullptr, 30, i });
+	}
+	jobs.push_back({ invalidProgram, nullptr, 30, 0 });
+
+	auto runJobs = [&jobs](std::size_t threadCount, std::vector<SBatchResult>& results) {
+		std::vector<std::array<std::uint8_t, constants::NumberOfRegisters>> registers(jobs.size());
+		CBatchRunner runner{ threadCount };
+		const SBatchStats stats =
+			runner.Run(jobs, results, [&registers](std::size_t job, const CInterpreter& i) {
+				registers[job] = i.Context().V;
+			});
+
+		CHECK_EQ(stats.JobCount, jobs.size());
+		CHECK_EQ(stats.FailedJobCount, 1);
+		CHECK_EQ(stats.FrameCount, 64 * 30);
+		return registers;
+	};
+
+	std::vector<SBatchResult> serialResults{}, parallelResults{};
+	const auto serialRegisters = runJobs(1, serialResults);
+	const auto parallelRegisters = runJobs(4, parallelResults);
+
+	CHECK(serialRegisters == parallelRegisters);
+	for (std::size_t i = 0; i < 64; i++)
+	{
+		CHECK_EQ(parallelResults[i].FramesRun, 30);
+		CHECK(parallelResults[i].Error.empty());
+	}
+	CHECK(!parallelResults.back().Error.empty());
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "Interpreter.h"
+#include "Movie.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace c8
+{
+	struct SBatchJob
+	{
+		std::shared_ptr<const std::vector<std::uint8_t>> Program;
+		std::shared_ptr<const CMovie> Movie; // Input to play back, no keys are pressed if null
+		std::uint32_t FrameCount;            // Limited to the length of the movie, if any
+		std::uint32_t RandomSeed;            // Ignored if there is a movie
+	};
+
+	struct SBatchResult
+	{
+		std::uint32_t FramesRun;
+		bool Exited;
+		std::string Error; // Empty if the job completed successfully
+	};
+
+	struct SBatchStats
+	{
+		std::size_t JobCount;
+		std::size_t FailedJobCount;
+		std::uint64_t FrameCount;
+		std::chrono::duration<double> Duration;
+
+		inline std::uint64_t CycleCount() const { return FrameCount * constants::CyclesPerFrame; }
+		inline double CyclesPerSecond() const { return CycleCount() / Duration.count(); }
+	};
+
+	/// Called from the worker threads once a job finishes, with the interpreter that ran it.
+	using FBatchJobFinished = std::function<void(std::size_t jobIndex, const CInterpreter&)>;
+
+	/// Runs independent jobs in parallel, in virtual time. Each worker owns a deque of jobs and,
+	/// once it is empty, steals jobs from the front of the other workers' deques. The interpreters
+	/// are kept per worker and reused by every job it runs, across calls to Run.
+	class CBatchRunner
+	{
+	private:
+		std::vector<CInterpreter> mInterpreters; // One per worker
+
+	public:
+		CBatchRunner(std::size_t threadCount = std::thread::hardware_concurrency());
+
+		inline std::size_t ThreadCount() const { return mInterpreters.size(); }
+
+		SBatchStats Run(const std::vector<SBatchJob>& jobs,
+						std::vector<SBatchResult>& results,
+						const FBatchJobFinished& onJobFinished = nullptr);
+
+	private:
+		static void RunJob(CInterpreter& interpreter, const SBatchJob& job, SBatchResult& result);
+	};
+}
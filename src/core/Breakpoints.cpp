@@ -0,0 +1,240 @@
+#include "Breakpoints.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <iterator>
+
+namespace c8
+{
+	CBreakpoints::CBreakpoints()
+		: mBits{}, mCount{ 0 }, mConditions{}, mTrace{}, mTraceCount{ 0 }
+	{
+	}
+
+	void CBreakpoints::Set(std::uint16_t address, bool set)
+	{
+		if (Has(address) != set)
+		{
+			Toggle(address);
+		}
+	}
+
+	void CBreakpoints::Toggle(std::uint16_t address)
+	{
+		const std::size_t slot = Slot(address);
+		std::uint64_t& word = mBits[slot / WordBits];
+		const std::uint64_t bit = std::uint64_t{ 1 } << (slot % WordBits);
+		word ^= bit;
+		if (word & bit)
+		{
+			mCount++;
+		}
+		else
+		{
+			mCount--;
+			mConditions.erase(slot);
+		}
+	}
+
+	void CBreakpoints::Clear()
+	{
+		mBits.fill(0);
+		mCount = 0;
+		mConditions.clear();
+	}
+
+	void CBreakpoints::SetCondition(std::uint16_t address,
+									std::optional<CExpression> condition,
+									std::optional<CExpression> trace)
+	{
+		Set(address, true);
+		if (trace.has_value())
+		{
+			// entries are only added in place afterwards, for the debugger to read them while
+			// the interpreter runs
+			mTrace.reserve(TraceCapacity);
+		}
+
+		if (condition.has_value() || trace.has_value())
+		{
+			mConditions[Slot(address)] = { std::move(condition), std::move(trace), 0 };
+		}
+		else
+		{
+			mConditions.erase(Slot(address));
+		}
+	}
+
+	const SBreakpointCondition* CBreakpoints::Condition(std::uint16_t address) const
+	{
+		const auto it = mConditions.find(Slot(address));
+		return it != mConditions.end() ? &it->second : nullptr;
+	}
+
+	bool CBreakpoints::ShouldStop(const SContext& c)
+	{
+		const auto it = mConditions.find(Slot(c.PC));
+		if (it == mConditions.end())
+		{
+			return true;
+		}
+
+		SBreakpointCondition& condition = it->second;
+		condition.Hits++;
+		if (condition.Condition.has_value() &&
+			condition.Condition->Evaluate(c, condition.Hits) == 0)
+		{
+			return false;
+		}
+
+		if (!condition.Trace.has_value())
+		{
+			return true;
+		}
+
+		const STracepointEntry entry{ c.PC,
+									  condition.Hits,
+									  condition.Trace->Evaluate(c, condition.Hits) };
+		if (mTrace.size() < TraceCapacity)
+		{
+			mTrace.push_back(entry);
+		}
+		else
+		{
+			mTrace[mTraceCount % TraceCapacity] = entry;
+		}
+		mTraceCount++;
+		return false;
+	}
+
+	bool CBreakpoints::WouldStop(const SContext& c, std::uint64_t hits) const
+	{
+		const SBreakpointCondition* condition = Condition(c.PC);
+		if (condition == nullptr)
+		{
+			return true;
+		}
+
+		// tracepoints never stop
+		return !condition->Trace.has_value() &&
+			   (!condition->Condition.has_value() || condition->Condition->Evaluate(c, hits) != 0);
+	}
+
+	std::vector<STracepointEntry> CBreakpoints::Traces() const
+	{
+		std::vector<STracepointEntry> traces{};
+		traces.reserve(mTrace.size());
+		const std::size_t oldest = mTrace.size() < TraceCapacity ?
+									   0 :
+									   static_cast<std::size_t>(mTraceCount % TraceCapacity);
+		std::rotate_copy(mTrace.begin(),
+						 mTrace.begin() + oldest,
+						 mTrace.end(),
+						 std::back_inserter(traces));
+		return traces;
+	}
+
+	void CBreakpoints::ClearTraces()
+	{
+		mTrace.clear();
+		mTraceCount = 0;
+	}
+
+	std::vector<std::uint16_t> CBreakpoints::Addresses() const
+	{
+		std::vector<std::uint16_t> addresses{};
+		addresses.reserve(mCount);
+		for (std::size_t slot = 0; slot < SlotCount; slot++)
+		{
+			if ((mBits[slot / WordBits] >> (slot % WordBits)) & 1)
+			{
+				addresses.push_back(
+					static_cast<std::uint16_t>(slot * constants::InstructionByteSize));
+			}
+		}
+		return addresses;
+	}
+}
+
+TEST_CASE("Breakpoints")
+{
+	using namespace c8;
+
+	CBreakpoints breakpoints{};
+	CHECK(breakpoints.IsEmpty());
+
+	breakpoints.Set(0x200, true);
+	breakpoints.Set(0x200, true);
+	breakpoints.Toggle(0x27E);
+	breakpoints.Set(0xFFE, true);
+	CHECK_EQ(breakpoints.Count(), 3u);
+	CHECK(breakpoints.Has(0x200));
+	CHECK(breakpoints.Has(0x201)); // Same slot
+	CHECK_FALSE(breakpoints.Has(0x202));
+	CHECK(breakpoints.Has(0x27E));
+	CHECK(breakpoints.Addresses() == std::vector<std::uint16_t>{ 0x200, 0x27E, 0xFFE });
+
+	breakpoints.Toggle(0x27E);
+	breakpoints.Set(0x202, false);
+	CHECK_EQ(breakpoints.Count(), 2u);
+	CHECK_FALSE(breakpoints.Has(0x27E));
+
+	breakpoints.Clear();
+	CHECK(breakpoints.IsEmpty());
+	CHECK_FALSE(breakpoints.Has(0x200));
+}
+
+TEST_CASE("Breakpoint conditions")
+{
+	using namespace c8;
+
+	CBreakpoints breakpoints{};
+	SContext c{};
+	c.PC = 0x200;
+
+	SUBCASE("Condition")
+	{
+		breakpoints.SetCondition(0x200, CExpression::Compile("V3 == 0x10 && HITS >= 2"), {});
+		CHECK(breakpoints.Has(0x200));
+		CHECK_FALSE(breakpoints.ShouldStop(c));
+		CHECK_FALSE(breakpoints.ShouldStop(c));
+		c.V[3] = 0x10;
+		CHECK(breakpoints.ShouldStop(c));
+		CHECK_EQ(breakpoints.Condition(0x200)->Hits, 3u);
+
+		// neither counts the hit
+		CHECK(breakpoints.WouldStop(c, 2));
+		CHECK_FALSE(breakpoints.WouldStop(c, 1));
+		CHECK_EQ(breakpoints.Condition(0x200)->Hits, 3u);
+
+		// removing the breakpoint removes its condition
+		breakpoints.Toggle(0x200);
+		breakpoints.Toggle(0x200);
+		CHECK_EQ(breakpoints.Condition(0x200), nullptr);
+		c.V[3] = 0;
+		CHECK(breakpoints.ShouldStop(c));
+	}
+
+	SUBCASE("Tracepoint")
+	{
+		breakpoints.SetCondition(
+			0x200, CExpression::Compile("HITS % 2"), CExpression::Compile("HITS * 2"));
+		for (std::size_t i = 0; i < CBreakpoints::TraceCapacity * 2 + 2; i++)
+		{
+			CHECK_FALSE(breakpoints.ShouldStop(c));
+		}
+
+		// only the odd hits are logged, the ring keeps the last ones
+		CHECK_EQ(breakpoints.TraceCount(), CBreakpoints::TraceCapacity + 1);
+		const std::vector<STracepointEntry> traces = breakpoints.Traces();
+		REQUIRE_EQ(traces.size(), CBreakpoints::TraceCapacity);
+		CHECK_EQ(traces.front().Hit, 3u);
+		CHECK_EQ(traces.back().Hit, CBreakpoints::TraceCapacity * 2 + 1);
+		CHECK_EQ(traces.back().Value, CBreakpoints::TraceCapacity * 4 + 2);
+		CHECK_EQ(traces.back().PC, 0x200);
+		CHECK_FALSE(breakpoints.WouldStop(c, 1));
+		CHECK_EQ(breakpoints.TraceCount(), CBreakpoints::TraceCapacity + 1);
+
+		breakpoints.ClearTraces();
+		CHECK(breakpoints.Traces().empty());
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "Constants.h"
+#include "Context.h"
+#include "Expression.h"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace c8
+{
+	/// Makes a breakpoint only stop when the condition is not 0, or log the value of the trace
+	/// expression instead of stopping, which makes it a tracepoint.
+	struct SBreakpointCondition
+	{
+		std::optional<CExpression> Condition;
+		std::optional<CExpression> Trace;
+		std::uint64_t Hits; // Times the address was reached, the HITS of the expressions
+	};
+
+	struct STracepointEntry
+	{
+		std::uint16_t PC;
+		std::uint64_t Hit;
+		std::int64_t Value;
+	};
+
+	/// Addresses where the interpreter stops before executing the instruction, as a bitmap
+	/// indexed by PC / 2. The count lets the cycle loops skip the lookup while there are none,
+	/// and the conditions are only looked up once the PC reaches an address in the bitmap.
+	class CBreakpoints
+	{
+	public:
+		static constexpr std::size_t SlotCount{ constants::MemorySize /
+												constants::InstructionByteSize };
+		static constexpr std::size_t TraceCapacity{ 1024 }; // Tracepoint entries kept
+
+	private:
+		static constexpr std::size_t WordBits{ 64 };
+
+		std::array<std::uint64_t, SlotCount / WordBits> mBits;
+		std::size_t mCount;
+		std::unordered_map<std::size_t, SBreakpointCondition> mConditions; // Keyed by slot
+		std::vector<STracepointEntry> mTrace;                              // Ring of entries
+		std::uint64_t mTraceCount;                                         // Entries ever logged
+
+	public:
+		CBreakpoints();
+
+		inline bool IsEmpty() const { return mCount == 0; }
+		inline std::size_t Count() const { return mCount; }
+		inline bool Has(std::uint16_t address) const
+		{
+			const std::size_t slot = Slot(address);
+			return (mBits[slot / WordBits] >> (slot % WordBits)) & 1;
+		}
+
+		/// Removing a breakpoint also removes its condition.
+		void Set(std::uint16_t address, bool set);
+		void Toggle(std::uint16_t address);
+		void Clear();
+
+		/// Sets a breakpoint with a condition or trace expression, replacing the previous one and
+		/// resetting its hits. Without either, the breakpoint stops unconditionally.
+		void SetCondition(std::uint16_t address,
+						  std::optional<CExpression> condition,
+						  std::optional<CExpression> trace);
+		/// Null if the breakpoint at the address has no condition.
+		const SBreakpointCondition* Condition(std::uint16_t address) const;
+		/// Called when the PC reaches an address with a breakpoint. Counts the hit, evaluates the
+		/// condition and logs the trace. Returns whether the interpreter has to stop.
+		bool ShouldStop(const SContext& c);
+		/// Whether the breakpoint at the PC of a replayed context would have stopped with the
+		/// given hits, without counting the hit or logging the trace.
+		bool WouldStop(const SContext& c, std::uint64_t hits) const;
+
+		/// The last TraceCapacity tracepoint entries, oldest first.
+		std::vector<STracepointEntry> Traces() const;
+		inline std::uint64_t TraceCount() const { return mTraceCount; }
+		void ClearTraces();
+
+		/// The addresses with a breakpoint, in ascending order.
+		std::vector<std::uint16_t> Addresses() const;
+
+	private:
+		static inline std::size_t Slot(std::uint16_t address)
+		{
+			return (address / constants::InstructionByteSize) % SlotCount;
+		}
+	};
+}
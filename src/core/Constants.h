@@ -42,6 +42,7 @@ namespace c8::constants
 	constexpr std::size_t TimersHz{ 60 }; // Number of times the timers are decreased per second
 	constexpr std::chrono::milliseconds TimersRate{ static_cast<std::size_t>(
 		(1.0 / TimersHz) * 1000.0 + 0.5) };
+	constexpr std::size_t CyclesPerFrame{ CyclesHz / TimersHz }; // Cycles between timer ticks
 
 	constexpr double BeepFrequency{ 550.0 };
 	constexpr std::chrono::milliseconds BeepDuration{ 50 };
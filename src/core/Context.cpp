@@ -1,4 +1,6 @@
 #include "Context.h"
+#include <cstring>
+#include <doctest/doctest.h>
 
 namespace c8
 {
@@ -9,10 +11,10 @@ namespace c8
 	void SDisplay::Reset()
 	{
 		ExtendedMode = false;
-		std::fill(PixelBuffer.begin(), PixelBuffer.end(), std::uint8_t(0));
+		PixelBuffer.Fill(0);
 	}
 
-	SContext::SContext() { Reset(); }
+	SContext::SContext() : Watchpoints{ nullptr } { Reset(); }
 
 	void SContext::Reset()
 	{
@@ -20,19 +22,114 @@ namespace c8
 		I = 0;
 		PC = 0;
 		SP = 0;
-		DT = 0;
-		ST = 0;
+		Ticks = 0;
+		DTDeadline = 0;
+		STDeadline = 0;
 		IR = 0;
 		std::fill(Stack.begin(), Stack.end(), std::uint16_t(0));
-		std::fill(Memory.begin(), Memory.end(), std::uint8_t(0));
+		std::fill(R.begin(), R.end(), std::uint8_t(0));
+		Memory.Fill(0);
 		Display.Reset();
 		DisplayChanged = true;
 		std::fill(Keyboard.begin(), Keyboard.end(), false);
 		Exited = false;
+		Random.Seed(0);
 
-		std::copy(Fontset.begin(), Fontset.end(), Memory.begin() + FontsetAddress);
-		std::copy(schip::Fontset.begin(),
-				  schip::Fontset.end(),
-				  Memory.begin() + schip::FontsetAddress);
+		Memory.Write(FontsetAddress, Fontset);
+		Memory.Write(schip::FontsetAddress, schip::Fontset);
 	}
-}
\ No newline at end of file
+
+	template<class T, std::size_t N>
+	static void HashArray(std::uint64_t& hash, const std::array<T, N>& values)
+	{
+		static_assert(sizeof(values) % sizeof(std::uint64_t) == 0);
+
+		for (std::size_t offset = 0; offset < sizeof(values); offset += sizeof(std::uint64_t))
+		{
+			std::uint64_t word;
+			std::memcpy(&word, reinterpret_cast<const char*>(values.data()) + offset, sizeof(word));
+			hash = Mix64(hash ^ word);
+		}
+	}
+
+	// the registers are small enough to be hashed in full every time
+	static std::uint64_t HashRegisters(const SContext& c)
+	{
+		std::uint64_t hash = static_cast<std::uint64_t>(EHashDomain::Registers);
+		hash = Mix64(hash ^ (std::uint64_t{ c.I } | std::uint64_t{ c.PC } << 16 |
+							 std::uint64_t{ c.SP } << 32 | std::uint64_t{ c.DT() } << 40 |
+							 std::uint64_t{ c.ST() } << 48 |
+							 std::uint64_t{ c.Display.ExtendedMode } << 56 |
+							 std::uint64_t{ c.Exited } << 57));
+		HashArray(hash, c.V);
+		HashArray(hash, c.Stack);
+		HashArray(hash, c.R);
+		HashArray(hash, c.Random.State);
+		return hash;
+	}
+
+	std::uint64_t SContext::Hash() const
+	{
+		return HashRegisters(*this) ^ Memory.Hash() ^ Display.PixelBuffer.Hash();
+	}
+
+	std::uint64_t SContext::ComputeHash() const
+	{
+		return HashRegisters(*this) ^ Memory.ComputeHash() ^ Display.PixelBuffer.ComputeHash();
+	}
+
+	SPackedKeyboardState PackKeyboardState(const SKeyboardState& state)
+	{
+		SPackedKeyboardState packedState = 0;
+		for (std::size_t key = 0; key < state.size(); key++)
+		{
+			if (state[key])
+			{
+				packedState |= SPackedKeyboardState(1) << key;
+			}
+		}
+		return packedState;
+	}
+
+	void UnpackKeyboardState(SPackedKeyboardState packedState, SKeyboardState& state)
+	{
+		for (std::size_t key = 0; key < state.size(); key++)
+		{
+			state[key] = (packedState >> key) & 1;
+		}
+	}
+}
+
+TEST_CASE("Context hash")
+{
+	using namespace c8;
+
+	SContext a{}, b{};
+	CHECK_EQ(a.Hash(), b.Hash());
+	CHECK_EQ(a.Hash(), a.ComputeHash());
+
+	SUBCASE("Registers")
+	{
+		b.V[3] = 1;
+		CHECK_NE(a.Hash(), b.Hash());
+		b.V[3] = 0;
+		b.Stack[15] = 0x200;
+		CHECK_NE(a.Hash(), b.Hash());
+		b.Stack[15] = 0;
+		b.Exited = true;
+		CHECK_NE(a.Hash(), b.Hash());
+	}
+
+	SUBCASE("Memory and display")
+	{
+		b.Memory.Write(0x300, 1);
+		CHECK_NE(a.Hash(), b.Hash());
+		CHECK_EQ(b.Hash(), b.ComputeHash());
+
+		a.Display.PixelBuffer.Xor(5, 1);
+		b.Memory.Write(0x300, 0);
+		b.Display.PixelBuffer.Set(5, 1);
+		CHECK_EQ(a.Hash(), b.Hash());
+		CHECK_EQ(a.Hash(), a.ComputeHash());
+	}
+}
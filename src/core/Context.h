@@ -1,11 +1,22 @@
 #pragma once
 #include "Constants.h"
+#include "PackedPixelBuffer.h"
+#include "PagedMemory.h"
+#include "Random.h"
 #include <array>
 #include <cstdint>
 
 namespace c8
 {
+	class CWatchpoints;
+
 	using SKeyboardState = std::array<bool, constants::KeyboardKeyCount>;
+	using SPackedKeyboardState = std::uint16_t; // Bit N is set if the key N is down
+
+	SPackedKeyboardState PackKeyboardState(const SKeyboardState& state);
+	void UnpackKeyboardState(SPackedKeyboardState packedState, SKeyboardState& state);
+
+	/// Display pixels with one byte each, as the platforms expect them.
 	using SDisplayPixelBuffer = std::array<std::uint8_t,
 										   (constants::schip::ExtendedDisplayResolutionWidth *
 											constants::schip::ExtendedDisplayResolutionHeight)>;
@@ -13,7 +24,7 @@ namespace c8
 	struct SDisplay
 	{
 		bool ExtendedMode;
-		SDisplayPixelBuffer PixelBuffer;
+		CPackedPixelBuffer PixelBuffer;
 
 		SDisplay();
 
@@ -31,27 +42,54 @@ namespace c8
 		}
 	};
 
+	/// Copies are cheap, the memory pages are shared until written to and the display is packed,
+	/// so the context can be cloned freely to explore different inputs. The timers are kept as
+	/// the tick at which they reach 0, so a tick only increments Ticks and they are computed
+	/// when read.
 	struct SContext
 	{
 		std::array<std::uint8_t, constants::NumberOfRegisters> V; // General purpose registers
 		std::uint16_t I;                                          // The memory address register
 		std::uint16_t PC;                                         // The program counter
 		std::uint8_t SP;                                          // The stack pointer
-		std::uint8_t DT;                                          // The delay timer
-		std::uint8_t ST;                                          // The sound timer
+		std::uint64_t Ticks;                                      // Timer ticks since the reset
+		std::uint64_t DTDeadline;                                 // Tick the delay timer ends at
+		std::uint64_t STDeadline;                                 // Tick the sound timer ends at
 		std::uint16_t IR;                                         // The current instruction opcode
 		std::array<std::uint16_t, constants::StackSize> Stack;
-		std::array<std::uint8_t, constants::MemorySize> Memory;
+		CPagedMemory Memory;
 		std::array<std::uint8_t, constants::schip::NumberOfRPLFlags> R; // RPL user flags
 		SDisplay Display;
 		bool DisplayChanged;
 		SKeyboardState Keyboard;
 		bool Exited;
+		SRandomGenerator Random;   // Used by RND
+		CWatchpoints* Watchpoints; // Where memory accesses are reported, not part of the state
 
 		SContext();
 
 		void Reset();
 
+		/// 64-bit hash of the machine state: registers, stack, memory, display, RPL flags, exit
+		/// flag and generator. The memory and the display keep their hashes updated on writes, so
+		/// this does not need to go through them.
+		std::uint64_t Hash() const;
+		/// Same as Hash, but recomputed from the whole state.
+		std::uint64_t ComputeHash() const;
+
+		/// The delay timer.
+		inline std::uint8_t DT() const
+		{
+			return DTDeadline > Ticks ? static_cast<std::uint8_t>(DTDeadline - Ticks) : 0;
+		}
+		/// The sound timer, the sound stops when it reaches 0.
+		inline std::uint8_t ST() const
+		{
+			return STDeadline > Ticks ? static_cast<std::uint8_t>(STDeadline - Ticks) : 0;
+		}
+		inline void SetDT(std::uint8_t value) { DTDeadline = Ticks + value; }
+		inline void SetST(std::uint8_t value) { STDeadline = Ticks + value; }
+
 		inline std::uint8_t X() const { return (IR & 0x0F00) >> 8; }
 		inline std::uint8_t Y() const { return (IR & 0x00F0) >> 4; }
 		inline std::uint16_t NNN() const { return (IR & 0x0FFF); }
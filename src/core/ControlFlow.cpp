@@ -0,0 +1,407 @@
+#include "ControlFlow.h"
+#include "Interpreter.h"
+#include <algorithm>
+#include <cstdio>
+#include <doctest/doctest.h>
+#include <gsl/gsl_assert>
+#include <set>
+
+namespace c8
+{
+	using namespace constants;
+
+	namespace
+	{
+		/// Where the execution can continue after an instruction.
+		struct SFlow
+		{
+			std::array<std::uint16_t, 2> Successors;
+			std::size_t SuccessorCount;
+			std::optional<std::uint16_t> Call;
+			std::optional<std::uint16_t> Jump;
+			std::optional<std::uint16_t> Data;
+			bool Unknown;
+			bool EndsBlock;
+		};
+
+		SFlow Flow(std::uint16_t address, std::uint16_t opcode)
+		{
+			const std::uint16_t next = static_cast<std::uint16_t>(address + InstructionByteSize);
+			const std::uint16_t nnn = opcode & 0x0FFF;
+
+			SFlow flow{ { next, 0 }, 1, std::nullopt, std::nullopt, std::nullopt, false, false };
+			if (!CInterpreter::TryFindInstruction(opcode))
+			{
+				// the interpreter stops here, the bytes after it are not known to be code
+				flow.SuccessorCount = 0;
+				flow.EndsBlock = true;
+				return flow;
+			}
+
+			switch (opcode & 0xF000)
+			{
+			case 0x0000:
+				if (opcode == 0x00EE || opcode == 0x00FD) // RET, EXIT
+				{
+					flow.SuccessorCount = 0;
+					flow.EndsBlock = true;
+				}
+				break;
+			case 0x1000: // JP nnn
+				flow.Successors[0] = nnn;
+				flow.Jump = nnn;
+				flow.EndsBlock = true;
+				break;
+			case 0x2000: // CALL nnn
+				flow.Call = nnn;
+				flow.EndsBlock = true;
+				break;
+			case 0x3000: // SE Vx, kk
+			case 0x4000: // SNE Vx, kk
+			case 0x5000: // SE Vx, Vy
+			case 0x9000: // SNE Vx, Vy
+				flow.Successors[1] = static_cast<std::uint16_t>(next + InstructionByteSize);
+				flow.SuccessorCount = 2;
+				flow.EndsBlock = true;
+				break;
+			case 0xA000: // LD I, nnn
+				flow.Data = nnn;
+				break;
+			case 0xB000: // JP V0, nnn
+				flow.SuccessorCount = 0;
+				flow.Unknown = true;
+				flow.EndsBlock = true;
+				break;
+			case 0xE000: // SKP Vx, SKNP Vx
+				flow.Successors[1] = static_cast<std::uint16_t>(next + InstructionByteSize);
+				flow.SuccessorCount = 2;
+				flow.EndsBlock = true;
+				break;
+			}
+			return flow;
+		}
+
+		inline bool IsInMemory(std::uint16_t address)
+		{
+			return address + InstructionByteSize <= MemorySize;
+		}
+
+		inline std::uint16_t ReadOpcode(const CPagedMemory& memory, std::uint16_t address)
+		{
+			return static_cast<std::uint16_t>(memory[address] << 8 | memory[address + 1]);
+		}
+
+		std::string MakeLabel(const char* prefix, std::uint16_t address)
+		{
+			char buffer[16];
+			std::snprintf(buffer, sizeof(buffer), "%s%03X", prefix, address);
+			return buffer;
+		}
+	}
+
+	CControlFlow::CControlFlow()
+		: mKinds{}, mBlocks{}, mCallGraph{}, mLabels{}, mReferences{}, mUnknownJumps{}
+	{
+	}
+
+	CControlFlow CControlFlow::Analyze(const CPagedMemory& memory, std::uint16_t entry)
+	{
+		Expects(IsInMemory(entry));
+
+		CControlFlow cf{};
+		cf.mKinds.fill(EByteKind::Unknown);
+
+		std::set<std::uint16_t> leaders{ entry };
+		std::set<std::uint16_t> functions{ entry };
+		std::set<std::uint16_t> jumpTargets{};
+		std::set<std::uint16_t> dataTargets{};
+		std::array<bool, MemorySize> visited{};
+
+		// find every instruction reachable from the entry point
+		std::vector<std::uint16_t> pending{ entry };
+		while (!pending.empty())
+		{
+			const std::uint16_t address = pending.back();
+			pending.pop_back();
+			if (!IsInMemory(address) || visited[address])
+			{
+				continue;
+			}
+
+			visited[address] = true;
+			cf.mKinds[address] = EByteKind::Code;
+			if (cf.mKinds[address + 1] == EByteKind::Unknown)
+			{
+				cf.mKinds[address + 1] = EByteKind::Operand;
+			}
+
+			const std::uint16_t opcode = ReadOpcode(memory, address);
+			const SFlow flow = Flow(address, opcode);
+			for (std::size_t i = 0; i < flow.SuccessorCount; i++)
+			{
+				if (flow.EndsBlock)
+				{
+					leaders.insert(flow.Successors[i]);
+				}
+				pending.push_back(flow.Successors[i]);
+			}
+			if (flow.Call)
+			{
+				leaders.insert(*flow.Call);
+				functions.insert(*flow.Call);
+				cf.mReferences[*flow.Call].push_back({ address, EReferenceKind::Call });
+				pending.push_back(*flow.Call);
+			}
+			if (flow.Jump)
+			{
+				jumpTargets.insert(*flow.Jump);
+				cf.mReferences[*flow.Jump].push_back({ address, EReferenceKind::Jump });
+			}
+			if (flow.Data)
+			{
+				dataTargets.insert(*flow.Data);
+				cf.mReferences[*flow.Data].push_back({ address, EReferenceKind::Data });
+			}
+			if (flow.Unknown)
+			{
+				cf.mUnknownJumps.push_back(address);
+			}
+		}
+
+		for (auto& [address, references] : cf.mReferences)
+		{
+			std::sort(references.begin(),
+					  references.end(),
+					  [](const SReference& a, const SReference& b) { return a.From < b.From; });
+		}
+		std::sort(cf.mUnknownJumps.begin(), cf.mUnknownJumps.end());
+
+		// split the instructions in blocks, each runs until a control transfer or the next leader
+		for (std::uint16_t start : leaders)
+		{
+			if (!IsInMemory(start) || !visited[start])
+			{
+				continue;
+			}
+
+			SBasicBlock block{ start, start, {}, std::nullopt, false };
+			std::uint16_t address = start;
+			while (true)
+			{
+				const SFlow flow = Flow(address, ReadOpcode(memory, address));
+				address = static_cast<std::uint16_t>(address + InstructionByteSize);
+				if (flow.EndsBlock)
+				{
+					block.Successors.assign(flow.Successors.begin(),
+											flow.Successors.begin() + flow.SuccessorCount);
+					block.Call = flow.Call;
+					block.UnknownSuccessor = flow.Unknown;
+					break;
+				}
+				if (!IsInMemory(address))
+				{
+					break;
+				}
+				if (leaders.count(address) != 0)
+				{
+					block.Successors.push_back(address);
+					break;
+				}
+			}
+			block.End = address;
+			cf.mBlocks.push_back(std::move(block));
+		}
+
+		// the functions called from the blocks reachable from each entry point, without
+		// following the calls
+		for (std::uint16_t function : functions)
+		{
+			std::set<std::uint16_t> callees{};
+			std::set<std::uint16_t> seen{ function };
+			std::vector<std::uint16_t> blocks{ function };
+			while (!blocks.empty())
+			{
+				const SBasicBlock* block = cf.BlockAt(blocks.back());
+				blocks.pop_back();
+				if (!block)
+				{
+					continue;
+				}
+
+				if (block->Call)
+				{
+					callees.insert(*block->Call);
+				}
+				for (std::uint16_t successor : block->Successors)
+				{
+					if (seen.insert(successor).second)
+					{
+						blocks.push_back(successor);
+					}
+				}
+			}
+			cf.mCallGraph[function].assign(callees.begin(), callees.end());
+		}
+
+		// data runs from an address loaded to I until the code or the next one, as the size of
+		// what is read from it is only known at runtime
+		for (std::uint16_t address : dataTargets)
+		{
+			for (std::size_t i = address;
+				 i < std::min<std::size_t>(address + MaxDataSize, MemorySize) &&
+				 cf.mKinds[i] == EByteKind::Unknown &&
+				 (i == address || dataTargets.count(static_cast<std::uint16_t>(i)) == 0);
+				 i++)
+			{
+				cf.mKinds[i] = EByteKind::Data;
+			}
+		}
+
+		for (std::uint16_t address : dataTargets)
+		{
+			cf.mLabels[address] = MakeLabel("data_", address);
+		}
+		for (std::uint16_t address : jumpTargets)
+		{
+			cf.mLabels[address] = MakeLabel("loc_", address);
+		}
+		for (std::uint16_t address : functions)
+		{
+			cf.mLabels[address] = MakeLabel("sub_", address);
+		}
+		cf.mLabels[entry] = "start";
+
+		return cf;
+	}
+
+	const SBasicBlock* CControlFlow::BlockAt(std::uint16_t address) const
+	{
+		auto it = std::upper_bound(
+			mBlocks.begin(), mBlocks.end(), address, [](std::uint16_t a, const SBasicBlock& b) {
+				return a < b.Start;
+			});
+		if (it == mBlocks.begin())
+		{
+			return nullptr;
+		}
+
+		--it;
+		return address < it->End ? &*it : nullptr;
+	}
+
+	const std::string* CControlFlow::Label(std::uint16_t address) const
+	{
+		auto it = mLabels.find(address);
+		return it != mLabels.end() ? &it->second : nullptr;
+	}
+
+	const std::vector<SReference>& CControlFlow::References(std::uint16_t address) const
+	{
+		static const std::vector<SReference> None{};
+
+		auto it = mReferences.find(address);
+		return it != mReferences.end() ? it->second : None;
+	}
+}
+
+TEST_CASE("Control flow")
+{
+	using namespace c8;
+
+	// odd-sized data before a function, so a linear disassembly misaligns it
+	CPagedMemory memory{};
+	const std::array<std::uint8_t, 24> program{
+		0xA2, 0x10,       // 200: LD I, 210
+		0x22, 0x13,       // 202: CALL 213
+		0x30, 0x01,       // 204: SE V0, 01
+		0x12, 0x04,       // 206: JP 204
+		0xB2, 0x00,       // 208: JP V0, 200
+		0x00, 0xE0,       // 20A: CLS, only reachable through JP V0
+		0x00, 0x00,       // 20C
+		0x00, 0x00,       // 20E
+		0x3C, 0x42, 0x81, // 210: sprite
+		0x60, 0x05,       // 213: LD V0, 05
+		0x00, 0xEE,       // 215: RET
+		0x00,
+	};
+	memory.Write(ProgramStartAddress, program);
+
+	const CControlFlow cf = CControlFlow::Analyze(memory);
+
+	SUBCASE("Code and data")
+	{
+		CHECK_EQ(cf.Kind(0x200), EByteKind::Code);
+		CHECK_EQ(cf.Kind(0x201), EByteKind::Operand);
+		CHECK_EQ(cf.Kind(0x208), EByteKind::Code);
+		CHECK_EQ(cf.Kind(0x20A), EByteKind::Unknown);
+		CHECK_EQ(cf.Kind(0x210), EByteKind::Data);
+		CHECK_EQ(cf.Kind(0x212), EByteKind::Data);
+		CHECK_EQ(cf.Kind(0x213), EByteKind::Code);
+		CHECK_EQ(cf.Kind(0x214), EByteKind::Operand);
+		CHECK_EQ(cf.Kind(0x215), EByteKind::Code);
+		CHECK_EQ(cf.Kind(0x217), EByteKind::Unknown);
+		CHECK_EQ(cf.Kind(0x100), EByteKind::Unknown);
+	}
+
+	SUBCASE("Blocks")
+	{
+		const std::vector<SBasicBlock>& blocks = cf.Blocks();
+		REQUIRE_EQ(blocks.size(), 5u);
+
+		CHECK_EQ(blocks[0].Start, 0x200);
+		CHECK_EQ(blocks[0].End, 0x204);
+		CHECK_EQ(blocks[0].Call, 0x213);
+		CHECK_EQ(blocks[0].Successors, std::vector<std::uint16_t>{ 0x204 });
+
+		CHECK_EQ(blocks[1].Start, 0x204);
+		CHECK_EQ(blocks[1].Successors, std::vector<std::uint16_t>{ 0x206, 0x208 });
+
+		CHECK_EQ(blocks[2].Start, 0x206);
+		CHECK_EQ(blocks[2].Successors, std::vector<std::uint16_t>{ 0x204 });
+
+		CHECK_EQ(blocks[3].Start, 0x208);
+		CHECK(blocks[3].Successors.empty());
+		CHECK(blocks[3].UnknownSuccessor);
+
+		CHECK_EQ(blocks[4].Start, 0x213);
+		CHECK_EQ(blocks[4].End, 0x217);
+		CHECK(blocks[4].Successors.empty());
+
+		CHECK_EQ(cf.BlockAt(0x202), &blocks[0]);
+		CHECK_EQ(cf.BlockAt(0x215), &blocks[4]);
+		CHECK_EQ(cf.BlockAt(0x210), nullptr);
+	}
+
+	SUBCASE("Call graph")
+	{
+		const auto& graph = cf.CallGraph();
+		REQUIRE_EQ(graph.size(), 2u);
+		CHECK_EQ(graph.at(0x200), std::vector<std::uint16_t>{ 0x213 });
+		CHECK(graph.at(0x213).empty());
+	}
+
+	SUBCASE("Labels and references")
+	{
+		REQUIRE(cf.Label(0x200));
+		CHECK_EQ(*cf.Label(0x200), "start");
+		REQUIRE(cf.Label(0x204));
+		CHECK_EQ(*cf.Label(0x204), "loc_204");
+		REQUIRE(cf.Label(0x210));
+		CHECK_EQ(*cf.Label(0x210), "data_210");
+		REQUIRE(cf.Label(0x213));
+		CHECK_EQ(*cf.Label(0x213), "sub_213");
+		CHECK_EQ(cf.Label(0x206), nullptr);
+
+		REQUIRE_EQ(cf.References(0x213).size(), 1u);
+		CHECK_EQ(cf.References(0x213)[0].From, 0x202);
+		CHECK_EQ(cf.References(0x213)[0].Kind, EReferenceKind::Call);
+		REQUIRE_EQ(cf.References(0x204).size(), 1u);
+		CHECK_EQ(cf.References(0x204)[0].From, 0x206);
+		CHECK_EQ(cf.References(0x204)[0].Kind, EReferenceKind::Jump);
+		REQUIRE_EQ(cf.References(0x210).size(), 1u);
+		CHECK_EQ(cf.References(0x210)[0].Kind, EReferenceKind::Data);
+		CHECK(cf.References(0x208).empty());
+
+		CHECK_EQ(cf.UnknownJumps(), std::vector<std::uint16_t>{ 0x208 });
+	}
+}
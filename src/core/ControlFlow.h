@@ -0,0 +1,86 @@
+#pragma once
+#include "Constants.h"
+#include "PagedMemory.h"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace c8
+{
+	enum class EByteKind : std::uint8_t
+	{
+		Unknown, // Not reached by the analysis
+		Code,    // First byte of an instruction
+		Operand, // Second byte of an instruction
+		Data,    // Pointed to by LD I, nnn
+	};
+
+	enum class EReferenceKind : std::uint8_t
+	{
+		Jump,
+		Call,
+		Data,
+	};
+
+	struct SReference
+	{
+		std::uint16_t From; // Address of the instruction
+		EReferenceKind Kind;
+	};
+
+	/// Instructions executed in sequence, only entered at the start.
+	struct SBasicBlock
+	{
+		std::uint16_t Start;
+		std::uint16_t End; // Address after the last instruction
+		std::vector<std::uint16_t> Successors;
+		std::optional<std::uint16_t> Call; // Called by the last instruction, returns to End
+		bool UnknownSuccessor;             // Ends with JP V0, nnn
+	};
+
+	/// Recursive descent analysis of a program: follows JP, CALL, the skips and RET from the entry
+	/// point, so the instructions are found at their real alignment and the data between them is
+	/// not decoded. The targets of JP V0, nnn depend on V0, so the code only reached through them
+	/// is left unknown.
+	class CControlFlow
+	{
+	public:
+		static constexpr std::size_t MaxDataSize{ 32 }; // Bytes marked as data after LD I, nnn
+
+	private:
+		std::array<EByteKind, constants::MemorySize> mKinds;
+		std::vector<SBasicBlock> mBlocks; // Sorted by start
+		std::map<std::uint16_t, std::vector<std::uint16_t>> mCallGraph;
+		std::map<std::uint16_t, std::string> mLabels;
+		std::map<std::uint16_t, std::vector<SReference>> mReferences;
+		std::vector<std::uint16_t> mUnknownJumps;
+
+	public:
+		static CControlFlow Analyze(const CPagedMemory& memory,
+									std::uint16_t entry = constants::ProgramStartAddress);
+
+		inline EByteKind Kind(std::size_t address) const { return mKinds[address]; }
+		inline const std::vector<SBasicBlock>& Blocks() const { return mBlocks; }
+		/// The block that contains the instruction at the address, or null.
+		const SBasicBlock* BlockAt(std::uint16_t address) const;
+		/// The functions called by each function, keyed by their entry points. The functions are
+		/// the entry point and the targets of CALL.
+		inline const std::map<std::uint16_t, std::vector<std::uint16_t>>& CallGraph() const
+		{
+			return mCallGraph;
+		}
+		/// "start" for the entry point, "sub_" for the functions, "loc_" for the jump targets and
+		/// "data_" for the data, followed by the address. Null if the address has none.
+		const std::string* Label(std::uint16_t address) const;
+		/// The instructions that jump to, call or point to the address, in ascending order.
+		const std::vector<SReference>& References(std::uint16_t address) const;
+		/// Addresses of the JP V0, nnn instructions reached.
+		inline const std::vector<std::uint16_t>& UnknownJumps() const { return mUnknownJumps; }
+
+	private:
+		CControlFlow();
+	};
+}
@@ -0,0 +1,108 @@
+#include "Disassembly.h"
+#include "Interpreter.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <string>
+
+namespace c8
+{
+	using namespace constants;
+
+	CDisassembly::CDisassembly() : mLines{}, mPageGenerations{}
+	{
+		// generation 0 is never used by the memory, so the first update formats every line
+		for (SDisassemblyLine& line : mLines)
+		{
+			line.Opcode = 0;
+			line.Instruction = nullptr;
+			line.Text = { "???" };
+		}
+	}
+
+	std::size_t CDisassembly::Update(const CPagedMemory& memory)
+	{
+		std::size_t formatted = 0;
+		std::size_t updatedEnd = 0; // The lines before it were already read in this update
+		for (std::size_t page = 0; page < CPagedMemory::PageCount; page++)
+		{
+			const std::uint64_t generation = memory.PageGeneration(page);
+			const bool firstUpdate = mPageGenerations[page] == 0;
+			if (generation == mPageGenerations[page])
+			{
+				continue;
+			}
+			mPageGenerations[page] = generation;
+
+			// the last line of the previous page ends in this one
+			const std::size_t pageStart = page * CPagedMemory::PageSize;
+			const std::size_t end = pageStart + CPagedMemory::PageSize;
+			for (std::size_t address = std::max(updatedEnd, pageStart == 0 ? 0 : pageStart - 1);
+				 address < end;
+				 address++)
+			{
+				const std::uint8_t low = address + 1 < MemorySize ? memory[address + 1] : 0;
+				const std::uint16_t opcode = static_cast<std::uint16_t>(memory[address] << 8 | low);
+				SDisassemblyLine& line = mLines[address];
+				if (opcode == line.Opcode && !firstUpdate)
+				{
+					continue;
+				}
+
+				line.Opcode = opcode;
+				line.Instruction = nullptr;
+				line.Text = { "???" };
+				if (auto instruction = CInterpreter::TryFindInstruction(opcode))
+				{
+					line.Instruction = &instruction->get();
+					line.Instruction->Format(*line.Instruction,
+											 opcode,
+											 static_cast<std::uint16_t>(address),
+											 line.Text);
+				}
+				formatted++;
+			}
+			updatedEnd = end;
+		}
+		return formatted;
+	}
+}
+
+TEST_CASE("Disassembly")
+{
+	using namespace c8;
+
+	CPagedMemory memory{};
+	const std::array<std::uint8_t, 4> program{ 0x12, 0x34, 0x00, 0xC4 };
+	memory.Write(0x200, program);
+
+	CDisassembly disassembly{};
+	CHECK_EQ(disassembly.Update(memory), CDisassembly::LineCount);
+	CHECK_EQ(std::string(disassembly.Line(0x200).Text.data()), "JP 234");
+	CHECK_EQ(std::string(disassembly.Line(0x202).Text.data()), "SCD 4");
+	CHECK_EQ(disassembly.Line(0x202).Instruction, &CInterpreter::FindInstruction(0x00C4));
+	CHECK_EQ(std::string(disassembly.Line(0x300).Text.data()), "???");
+	CHECK_EQ(disassembly.Line(0x300).Instruction, nullptr);
+
+	// nothing changed
+	CHECK_EQ(disassembly.Update(memory), 0u);
+
+	CHECK_EQ(std::string(disassembly.Line(0x201).Text.data()), "SE V4, 00");
+	CHECK_EQ(std::string(disassembly.Line(0x1FF).Text.data()), "???");
+
+	// only the lines whose bytes changed are formatted again
+	memory.Write(0x2FF, 0x60);
+	memory.Write(0x201, 0x34);
+	CHECK_EQ(disassembly.Update(memory), 2u);
+	CHECK_EQ(std::string(disassembly.Line(0x2FE).Text.data()), "???");
+	CHECK_EQ(std::string(disassembly.Line(0x2FF).Text.data()), "LD V0, 00");
+
+	memory.Write(0x203, 0xC6);
+	CHECK_EQ(disassembly.Update(memory), 2u);
+	CHECK_EQ(std::string(disassembly.Line(0x202).Text.data()), "SCD 6");
+
+	// a copy from before the changes, like a loaded state
+	CPagedMemory copy{};
+	copy.Write(0x200, program);
+	CHECK_EQ(disassembly.Update(copy), 4u);
+	CHECK_EQ(std::string(disassembly.Line(0x202).Text.data()), "SCD 4");
+}
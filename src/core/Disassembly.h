@@ -0,0 +1,41 @@
+#pragma once
+#include "Constants.h"
+#include "Instructions.h"
+#include "PagedMemory.h"
+#include <array>
+#include <cstdint>
+
+namespace c8
+{
+	struct SDisassemblyLine
+	{
+		std::uint16_t Opcode;
+		const SInstruction* Instruction; // Null if the opcode is not a valid instruction
+		std::array<char, SInstruction::MaxFormattedSize> Text;
+	};
+
+	/// The instruction at each address of the memory, formatted once, so code at odd addresses
+	/// can be shown too. Updating it only reads the pages whose generation changed and only
+	/// formats the lines whose bytes changed, so it can be kept up to date every frame while the
+	/// program runs.
+	class CDisassembly
+	{
+	public:
+		static constexpr std::size_t LineCount{ constants::MemorySize };
+
+	private:
+		std::array<SDisassemblyLine, LineCount> mLines;
+		std::array<std::uint64_t, CPagedMemory::PageCount> mPageGenerations; // Of the lines
+
+	public:
+		CDisassembly();
+
+		/// Formats the lines whose bytes changed since the last update. Returns how many.
+		std::size_t Update(const CPagedMemory& memory);
+
+		inline const SDisassemblyLine& Line(std::uint16_t address) const
+		{
+			return mLines[address % LineCount];
+		}
+	};
+}
@@ -0,0 +1,411 @@
+#include "Environment.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <fstream>
+#include <gsl/gsl_assert>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace c8
+{
+	std::uint8_t SStateLocation::Read(const SContext& c) const
+	{
+		return Kind == EKind::Register ? c.V[Index] : c.Memory[Index];
+	}
+
+	bool SDoneCondition::Test(const SContext& c) const
+	{
+		const std::uint8_t v = Location.Read(c);
+		switch (Comparison)
+		{
+		case EComparison::Equal: return v == Value;
+		case EComparison::NotEqual: return v != Value;
+		case EComparison::Less: return v < Value;
+		case EComparison::LessEqual: return v <= Value;
+		case EComparison::Greater: return v > Value;
+		case EComparison::GreaterEqual: return v >= Value;
+		}
+		return false;
+	}
+
+	static std::uint32_t ParseNumber(const std::string& token, int base, std::uint32_t max)
+	{
+		std::size_t end = 0;
+		unsigned long value = 0;
+		try
+		{
+			value = std::stoul(token, &end, base);
+		}
+		catch (const std::logic_error&)
+		{
+			end = 0;
+		}
+
+		if (token.empty() || end != token.size() || value > max)
+		{
+			throw std::invalid_argument("Invalid number '" + token + "'");
+		}
+		return static_cast<std::uint32_t>(value);
+	}
+
+	static SStateLocation ParseLocation(const std::string& token)
+	{
+		if (token.size() == 2 && (token[0] == 'V' || token[0] == 'v'))
+		{
+			return { SStateLocation::EKind::Register,
+					 static_cast<std::uint16_t>(ParseNumber(token.substr(1), 16, 0xF)) };
+		}
+		else if (token.size() > 2 && token.front() == '[' && token.back() == ']')
+		{
+			const std::string address = token.substr(1, token.size() - 2);
+			return { SStateLocation::EKind::Memory,
+					 static_cast<std::uint16_t>(
+						 ParseNumber(address, 16, constants::MemorySize - 1)) };
+		}
+
+		throw std::invalid_argument("Invalid location '" + token + "'");
+	}
+
+	static SDoneCondition::EComparison ParseComparison(const std::string& token)
+	{
+		using EComparison = SDoneCondition::EComparison;
+
+		if (token == "==") return EComparison::Equal;
+		if (token == "!=") return EComparison::NotEqual;
+		if (token == "<") return EComparison::Less;
+		if (token == "<=") return EComparison::LessEqual;
+		if (token == ">") return EComparison::Greater;
+		if (token == ">=") return EComparison::GreaterEqual;
+
+		throw std::invalid_argument("Invalid comparison '" + token + "'");
+	}
+
+	static void ParseSetting(SEnvironmentSpec& spec, const std::vector<std::string>& tokens)
+	{
+		const std::string& name = tokens[0];
+		const std::size_t argCount = tokens.size() - 1;
+		if (name == "frameskip" && argCount == 1)
+		{
+			spec.FrameSkip = ParseNumber(tokens[1], 10, 0xFFFFFFFF);
+		}
+		else if (name == "maxframes" && argCount == 1)
+		{
+			spec.MaxFrames = ParseNumber(tokens[1], 10, 0xFFFFFFFF);
+		}
+		else if (name == "action" && argCount == 1 && tokens[1] == "-")
+		{
+			spec.Actions.push_back(0);
+		}
+		else if (name == "action" && argCount >= 1)
+		{
+			SPackedKeyboardState keys = 0;
+			for (std::size_t i = 1; i < tokens.size(); i++)
+			{
+				keys |= SPackedKeyboardState(1) << ParseNumber(tokens[i], 16, 0xF);
+			}
+			spec.Actions.push_back(keys);
+		}
+		else if (name == "reward" && (argCount == 1 || argCount == 2))
+		{
+			float scale = 1.0f;
+			if (argCount == 2)
+			{
+				std::size_t end = 0;
+				scale = std::stof(tokens[2], &end);
+				if (end != tokens[2].size())
+				{
+					throw std::invalid_argument("Invalid scale '" + tokens[2] + "'");
+				}
+			}
+			spec.Rewards.push_back({ ParseLocation(tokens[1]), scale });
+		}
+		else if (name == "done" && argCount == 3)
+		{
+			spec.DoneConditions.push_back({ ParseLocation(tokens[1]),
+											ParseComparison(tokens[2]),
+											static_cast<std::uint8_t>(
+												ParseNumber(tokens[3], 0, 0xFF)) });
+		}
+		else
+		{
+			throw std::invalid_argument("Invalid setting '" + name + "'");
+		}
+	}
+
+	SEnvironmentSpec SEnvironmentSpec::Parse(std::istream& input)
+	{
+		SEnvironmentSpec spec{};
+		std::string line;
+		for (std::size_t lineNumber = 1; std::getline(input, line); lineNumber++)
+		{
+			std::istringstream lineStream{ line.substr(0, line.find('#')) };
+			std::vector<std::string> tokens{ std::istream_iterator<std::string>{ lineStream },
+											 std::istream_iterator<std::string>{} };
+			if (tokens.empty())
+			{
+				continue;
+			}
+
+			try
+			{
+				ParseSetting(spec, tokens);
+			}
+			catch (const std::exception& e)
+			{
+				throw std::runtime_error("Line " + std::to_string(lineNumber) + ": " + e.what());
+			}
+		}
+
+		if (spec.Actions.empty())
+		{
+			throw std::runtime_error("The environment has no actions");
+		}
+		if (spec.FrameSkip == 0)
+		{
+			throw std::runtime_error("The frame skip must be at least 1");
+		}
+
+		return spec;
+	}
+
+	SEnvironmentSpec SEnvironmentSpec::Load(const std::filesystem::path& filePath)
+	{
+		if (!fs::is_regular_file(filePath))
+		{
+			throw std::invalid_argument("Path '" + filePath.string() + "' is an invalid file");
+		}
+
+		std::ifstream file(filePath);
+		try
+		{
+			return Parse(file);
+		}
+		catch (const std::runtime_error& e)
+		{
+			throw std::runtime_error("Environment '" + filePath.string() + "': " + e.what());
+		}
+	}
+
+	CEnvironment::CEnvironment(std::shared_ptr<const std::vector<std::uint8_t>> program,
+							   std::shared_ptr<const SEnvironmentSpec> spec)
+		: mProgram{ std::move(program) },
+		  mSpec{ std::move(spec) },
+		  mInterpreter{ std::make_shared<CNullPlatform>() },
+		  mRewardValues(mSpec->Rewards.size()),
+		  mFrame{ 0 },
+		  mEnded{ true }
+	{
+		Expects(mProgram != nullptr && mSpec != nullptr);
+	}
+
+	const CPackedPixelBuffer& CEnvironment::Reset(std::uint32_t seed)
+	{
+		mInterpreter.SetRandomSeed(seed);
+		mInterpreter.LoadProgram(*mProgram);
+		mFrame = 0;
+		mEnded = false;
+
+		for (std::size_t i = 0; i < mRewardValues.size(); i++)
+		{
+			mRewardValues[i] = mSpec->Rewards[i].Location.Read(Context());
+		}
+
+		return Observation();
+	}
+
+	SStepResult CEnvironment::Step(std::size_t action)
+	{
+		Expects(action < ActionCount());
+		Expects(!mEnded);
+
+		SKeyboardState keyboard{};
+		UnpackKeyboardState(mSpec->Actions[action], keyboard);
+
+		SStepResult result{ &Observation(), 0.0f, false, false };
+		for (std::uint32_t i = 0; i < mSpec->FrameSkip && !result.Done && !result.Truncated; i++)
+		{
+			mInterpreter.RunFrame(keyboard);
+			mFrame++;
+
+			const SContext& c = Context();
+			const auto& conditions = mSpec->DoneConditions;
+			auto test = [&c](const SDoneCondition& d) { return d.Test(c); };
+			result.Done = c.Exited || std::any_of(conditions.begin(), conditions.end(), test);
+			result.Truncated = mSpec->MaxFrames != 0 && mFrame >= mSpec->MaxFrames;
+		}
+
+		for (std::size_t i = 0; i < mRewardValues.size(); i++)
+		{
+			const SRewardTerm& term = mSpec->Rewards[i];
+			const std::uint8_t value = term.Location.Read(Context());
+			result.Reward += term.Scale * (static_cast<int>(value) - mRewardValues[i]);
+			mRewardValues[i] = value;
+		}
+
+		mEnded = result.Done || result.Truncated;
+		return result;
+	}
+
+	CEnvironmentBatch::CEnvironmentBatch(std::shared_ptr<const std::vector<std::uint8_t>> program,
+										 std::shared_ptr<const SEnvironmentSpec> spec,
+										 std::size_t count)
+		: mEnvironments{}, mSeeds(count)
+	{
+		mEnvironments.reserve(count);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			mEnvironments.emplace_back(program, spec);
+		}
+	}
+
+	void CEnvironmentBatch::Reset(std::uint32_t seed)
+	{
+		for (std::size_t i = 0; i < size(); i++)
+		{
+			mSeeds[i] = seed + static_cast<std::uint32_t>(i);
+			mEnvironments[i].Reset(mSeeds[i]);
+		}
+	}
+
+	void CEnvironmentBatch::Step(gsl::span<const std::size_t> actions,
+								 gsl::span<SStepResult> results)
+	{
+		Expects(static_cast<std::size_t>(actions.size()) == size());
+		Expects(static_cast<std::size_t>(results.size()) == size());
+
+		for (std::size_t i = 0; i < size(); i++)
+		{
+			CEnvironment& environment = mEnvironments[i];
+			if (environment.HasEnded())
+			{
+				mSeeds[i] += static_cast<std::uint32_t>(size());
+				environment.Reset(mSeeds[i]);
+			}
+
+			results[i] = environment.Step(actions[i]);
+		}
+	}
+}
+
+TEST_CASE("Environment")
+{
+	using namespace c8;
+
+	// counts in V3 the frames where key 5 is down, exits once it reaches 6
+	const auto program = std::make_shared<const std::vector<std::uint8_t>>(
+		std::initializer_list<std::uint8_t>{
+			0x60, 0x05, // 200: LD V0, 05
+			0x61, 0x01, // 202: LD V1, 01
+			0xF1, 0x15, // 204: LD DT, V1
+			0xF2, 0x07, // 206: LD V2, DT
+			0x32, 0x00, // 208: SE V2, 00
+			0x12, 0x06, // 20A: JP 206
+			0xE0, 0xA1, // 20C: SKNP V0
+			0x73, 0x01, // 20E: ADD V3, 01
+			0x33, 0x06, // 210: SE V3, 06
+			0x12, 0x04, // 212: JP 204
+			0x00, 0xFD, // 214: EXIT
+		});
+
+	std::istringstream specText{ "# test\n"
+								 "frameskip 2\n"
+								 "action -\n"
+								 "action 5   # counts\n"
+								 "reward V3 0.5\n"
+								 "done [300] == 0x10\n" };
+	const auto spec = std::make_shared<const SEnvironmentSpec>(SEnvironmentSpec::Parse(specText));
+	CHECK_EQ(spec->FrameSkip, 2u);
+	CHECK_EQ(spec->Actions.size(), 2u);
+	CHECK_EQ(spec->Actions[1], SPackedKeyboardState(1 << 5));
+
+	SUBCASE("Step")
+	{
+		CEnvironment environment{ program, spec };
+		const CPackedPixelBuffer& observation = environment.Reset(0);
+		CHECK_EQ(&observation, &environment.Context().Display.PixelBuffer);
+
+		const SStepResult idle = environment.Step(0);
+		CHECK_EQ(idle.Observation, &observation);
+		CHECK_EQ(idle.Reward, 0.0f);
+		CHECK(!idle.Done);
+		CHECK_EQ(environment.Frame(), 2u);
+
+		float totalReward = 0.0f;
+		std::size_t stepCount = 0;
+		for (SStepResult result{}; !result.Done; stepCount++)
+		{
+			REQUIRE(stepCount < 100);
+			result = environment.Step(1);
+			totalReward += result.Reward;
+		}
+		CHECK_EQ(totalReward, 3.0f);
+		CHECK(environment.Context().Exited);
+		CHECK(environment.HasEnded());
+		CHECK_THROWS(environment.Step(1));
+
+		environment.Reset(0);
+		CHECK(!environment.HasEnded());
+		CHECK_EQ(environment.Context().V[3], 0);
+	}
+
+	SUBCASE("Truncation")
+	{
+		std::istringstream truncatedText{ "maxframes 5\naction -\nframeskip 2" };
+		const auto truncatedSpec =
+			std::make_shared<const SEnvironmentSpec>(SEnvironmentSpec::Parse(truncatedText));
+		CEnvironment environment{ program, truncatedSpec };
+		environment.Reset(0);
+		CHECK(!environment.Step(0).Truncated);
+		CHECK(!environment.Step(0).Truncated);
+		const SStepResult last = environment.Step(0);
+		CHECK(last.Truncated);
+		CHECK(!last.Done);
+		CHECK_EQ(environment.Frame(), 5u);
+	}
+
+	SUBCASE("Batch")
+	{
+		CEnvironmentBatch batch{ program, spec, 3 };
+		batch.Reset(10);
+
+		const std::array<std::size_t, 3> actions{ 1, 0, 1 };
+		std::array<SStepResult, 3> results{};
+		for (std::size_t i = 0; i < 4; i++)
+		{
+			batch.Step(actions, results);
+		}
+		CHECK_EQ(batch[0].Context().V[3], batch[2].Context().V[3]);
+		CHECK_NE(batch[0].Context().V[3], 0);
+		CHECK_EQ(batch[1].Context().V[3], 0);
+		CHECK_EQ(results[1].Observation, &batch[1].Observation());
+
+		// the environments that exited are reset when stepped again
+		while (!results[0].Done)
+		{
+			batch.Step(actions, results);
+		}
+		batch.Step(actions, results);
+		CHECK(!batch[0].HasEnded());
+		CHECK_EQ(batch[0].Frame(), spec->FrameSkip);
+	}
+
+	SUBCASE("Invalid specs")
+	{
+		auto parse = [](const char* text) {
+			std::istringstream input{ text };
+			return SEnvironmentSpec::Parse(input);
+		};
+
+		CHECK_THROWS(parse(""));
+		CHECK_THROWS(parse("action G"));
+		CHECK_THROWS(parse("action -\nframeskip 0"));
+		CHECK_THROWS(parse("action -\nreward VG"));
+		CHECK_THROWS(parse("action -\nreward [1000]"));
+		CHECK_THROWS(parse("action -\ndone V0 = 1"));
+		CHECK_THROWS(parse("action -\ndone V0 == 256"));
+		CHECK_THROWS(parse("action -\nspeed 2"));
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "Interpreter.h"
+#include "PackedPixelBuffer.h"
+#include <cstdint>
+#include <filesystem>
+#include <gsl/span>
+#include <istream>
+#include <memory>
+#include <vector>
+
+namespace c8
+{
+	/// A register or memory byte read to compute rewards and terminations.
+	struct SStateLocation
+	{
+		enum class EKind : std::uint8_t
+		{
+			Register, // V[Index]
+			Memory,   // Memory[Index]
+		};
+
+		EKind Kind;
+		std::uint16_t Index;
+
+		std::uint8_t Read(const SContext& c) const;
+	};
+
+	/// Adds Scale times the change of the value at Location during a step to its reward.
+	struct SRewardTerm
+	{
+		SStateLocation Location;
+		float Scale;
+	};
+
+	/// Ends the episode once the value at Location compares true against Value.
+	struct SDoneCondition
+	{
+		enum class EComparison : std::uint8_t
+		{
+			Equal,
+			NotEqual,
+			Less,
+			LessEqual,
+			Greater,
+			GreaterEqual,
+		};
+
+		SStateLocation Location;
+		EComparison Comparison;
+		std::uint8_t Value;
+
+		bool Test(const SContext& c) const;
+	};
+
+	/// How a program is played as an environment. It is loaded from a text file, one setting per
+	/// line and '#' starting a comment:
+	///   frameskip 4        frames run by each step, 1 by default
+	///   maxframes 18000    frames before the episode is truncated, 0 (no limit) by default
+	///   action -           adds an action pressing no keys
+	///   action 4 C         adds an action pressing the keys 4 and C
+	///   reward V3 1.0      adds a reward term for V3 (or [2F0] for a memory byte)
+	///   done V4 == 0       adds a done condition, with ==, !=, <, <=, > or >=
+	/// The episode also ends when the program exits.
+	struct SEnvironmentSpec
+	{
+		std::uint32_t FrameSkip{ 1 };
+		std::uint32_t MaxFrames{ 0 };
+		std::vector<SPackedKeyboardState> Actions;
+		std::vector<SRewardTerm> Rewards;
+		std::vector<SDoneCondition> DoneConditions;
+
+		static SEnvironmentSpec Parse(std::istream& input);
+		static SEnvironmentSpec Load(const std::filesystem::path& filePath);
+	};
+
+	struct SStepResult
+	{
+		const CPackedPixelBuffer* Observation; // The display, valid until the next step or reset
+		float Reward;
+		bool Done;      // The episode ended, by a done condition or by exiting
+		bool Truncated; // The episode reached the frame limit
+	};
+
+	/// Reinforcement learning environment over an interpreter running in virtual time. The
+	/// observation is the packed display of the interpreter, it is never copied.
+	class CEnvironment
+	{
+	private:
+		std::shared_ptr<const std::vector<std::uint8_t>> mProgram;
+		std::shared_ptr<const SEnvironmentSpec> mSpec;
+		CInterpreter mInterpreter;
+		std::vector<std::uint8_t> mRewardValues; // Value of each reward term at the last step
+		std::uint32_t mFrame;
+		bool mEnded;
+
+	public:
+		CEnvironment(std::shared_ptr<const std::vector<std::uint8_t>> program,
+					 std::shared_ptr<const SEnvironmentSpec> spec);
+
+		inline const SEnvironmentSpec& Spec() const { return *mSpec; }
+		inline std::size_t ActionCount() const { return mSpec->Actions.size(); }
+		inline const SContext& Context() const { return mInterpreter.Context(); }
+		inline std::uint32_t Frame() const { return mFrame; }
+		/// Whether the episode is done or truncated, Reset must be called before stepping again.
+		inline bool HasEnded() const { return mEnded; }
+		inline const CPackedPixelBuffer& Observation() const
+		{
+			return mInterpreter.Context().Display.PixelBuffer;
+		}
+
+		/// Starts a new episode, with the given RND seed.
+		const CPackedPixelBuffer& Reset(std::uint32_t seed);
+		/// Runs FrameSkip frames with the keys of the action pressed, or less if the episode ends.
+		SStepResult Step(std::size_t action);
+	};
+
+	/// Environments of the same program stepped together. Environment N is seeded with the seed
+	/// given to Reset plus N, and an environment whose episode ended is reset with the seed
+	/// increased by the environment count when it is stepped.
+	class CEnvironmentBatch
+	{
+	private:
+		std::vector<CEnvironment> mEnvironments;
+		std::vector<std::uint32_t> mSeeds; // Seed of the current episode of each environment
+
+	public:
+		CEnvironmentBatch(std::shared_ptr<const std::vector<std::uint8_t>> program,
+						  std::shared_ptr<const SEnvironmentSpec> spec,
+						  std::size_t count);
+
+		inline std::size_t size() const { return mEnvironments.size(); }
+		inline const CEnvironment& operator[](std::size_t index) const
+		{
+			return mEnvironments[index];
+		}
+
+		void Reset(std::uint32_t seed);
+		void Step(gsl::span<const std::size_t> actions, gsl::span<SStepResult> results);
+	};
+}
@@ -0,0 +1,523 @@
+#include "ExecutionTrace.h"
+#include "Interpreter.h"
+#include <cstdio>
+#include <cstring>
+#include <doctest/doctest.h>
+#include <gsl/gsl_assert>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace c8
+{
+	using namespace constants;
+
+	static constexpr std::uint32_t IChanged{ 1u << NumberOfRegisters };
+	static constexpr std::uint32_t SPChanged{ IChanged << 1 };
+	static constexpr std::uint32_t DTChanged{ IChanged << 2 };
+	static constexpr std::uint32_t STChanged{ IChanged << 3 };
+
+	static std::uint8_t* WriteVarint(std::uint8_t* output, std::uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			*output++ = static_cast<std::uint8_t>(value | 0x80);
+			value >>= 7;
+		}
+		*output++ = static_cast<std::uint8_t>(value);
+		return output;
+	}
+
+	static const std::uint8_t*
+	ReadVarint(const std::uint8_t* input, const std::uint8_t* end, std::uint32_t& value)
+	{
+		value = 0;
+		for (std::uint32_t shift = 0; shift < 32; shift += 7)
+		{
+			if (input == end)
+			{
+				break;
+			}
+
+			const std::uint8_t byte = *input++;
+			value |= std::uint32_t{ byte & 0x7Fu } << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return input;
+			}
+		}
+		throw std::runtime_error("Execution trace is corrupted");
+	}
+
+	static const std::uint8_t*
+	ReadByte(const std::uint8_t* input, const std::uint8_t* end, std::uint8_t& value)
+	{
+		if (input == end)
+		{
+			throw std::runtime_error("Execution trace is corrupted");
+		}
+		value = *input++;
+		return input;
+	}
+
+	/// Bit N is set if the byte N of the words differs.
+	static std::uint32_t ChangedBytes(std::uint64_t a, std::uint64_t b)
+	{
+		constexpr std::uint64_t Low7{ 0x7F7F7F7F7F7F7F7F };
+		const std::uint64_t difference = a ^ b;
+		// the high bit of each byte is set if any of its bits is
+		const std::uint64_t high = (((difference & Low7) + Low7) | difference) & ~Low7;
+		// gathers the high bits into the top byte
+		return static_cast<std::uint32_t>(((high >> 7) * 0x0102040810204080) >> 56);
+	}
+
+	/// Index of the lowest set bit, the value must not be 0.
+	static std::size_t LowestSetBit(std::uint32_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, value);
+		return index;
+#else
+		return static_cast<std::size_t>(__builtin_ctz(value));
+#endif
+	}
+
+	static SExecutionTraceEntry ToEntry(std::uint16_t pc, std::uint16_t opcode, const SContext& c)
+	{
+		return { pc, opcode, c.V, c.I, c.SP, c.DT(), c.ST() };
+	}
+
+	CExecutionTrace::CExecutionTrace(const SContext& c, std::size_t blockCount)
+		: mBlocks(blockCount),
+		  mFirst{ 0 },
+		  mUsed{ 0 },
+		  mCurrent{ nullptr },
+		  mLast{},
+		  mTimerTicks{ 0 },
+		  mDTDeadline{ 0 },
+		  mSTDeadline{ 0 },
+		  mCount{ 0 },
+		  mDroppedCount{ 0 }
+	{
+		Expects(blockCount > 0);
+
+		Clear(c);
+	}
+
+	void CExecutionTrace::Record(std::uint16_t pc, std::uint16_t opcode, const SContext& c)
+	{
+		SBlock* block = mCurrent;
+		if (block->Size + MaxRecordSize > BlockSize)
+		{
+			block = &NextBlock();
+		}
+
+		std::uint8_t* const start = block->Data.data() + block->Size;
+		std::uint8_t* output = start;
+
+		// zigzag, so the small backward jumps are small too
+		const std::int32_t pcDelta =
+			static_cast<std::int16_t>(pc - (mLast.PC + InstructionByteSize));
+		output = WriteVarint(output,
+							 (static_cast<std::uint32_t>(pcDelta) << 1) ^
+								 static_cast<std::uint32_t>(pcDelta >> 31));
+		*output++ = static_cast<std::uint8_t>(opcode >> 8);
+		*output++ = static_cast<std::uint8_t>(opcode);
+
+		// compares the V registers 8 at a time, most instructions change at most one
+		std::array<std::uint64_t, 2> v{};
+		std::array<std::uint64_t, 2> lastV{};
+		std::memcpy(v.data(), c.V.data(), sizeof(v));
+		std::memcpy(lastV.data(), mLast.V.data(), sizeof(lastV));
+		std::uint32_t changes = ChangedBytes(v[0], lastV[0]) | ChangedBytes(v[1], lastV[1]) << 8;
+		changes |= c.I != mLast.I ? IChanged : 0;
+		changes |= c.SP != mLast.SP ? SPChanged : 0;
+
+		// the timers only change on a tick or when set, so they are not computed from their
+		// deadlines on every instruction
+		if (c.Ticks != mTimerTicks || c.DTDeadline != mDTDeadline || c.STDeadline != mSTDeadline)
+		{
+			const std::uint8_t dt = c.DT();
+			const std::uint8_t st = c.ST();
+			changes |= dt != mLast.DT ? DTChanged : 0;
+			changes |= st != mLast.ST ? STChanged : 0;
+			mLast.DT = dt;
+			mLast.ST = st;
+			mTimerTicks = c.Ticks;
+			mDTDeadline = c.DTDeadline;
+			mSTDeadline = c.STDeadline;
+		}
+		output = WriteVarint(output, changes);
+
+		// only what changed is written and copied to the last registers
+		if (changes & 0xFFFF)
+		{
+			// visits only the changed registers, usually just one
+			for (std::uint32_t bits = changes & 0xFFFF; bits != 0; bits &= bits - 1)
+			{
+				*output++ = c.V[LowestSetBit(bits)];
+			}
+			mLast.V = c.V;
+		}
+		if (changes & IChanged)
+		{
+			*output++ = static_cast<std::uint8_t>(c.I >> 8);
+			*output++ = static_cast<std::uint8_t>(c.I);
+			mLast.I = c.I;
+		}
+		if (changes & SPChanged)
+		{
+			*output++ = c.SP;
+			mLast.SP = c.SP;
+		}
+		if (changes & DTChanged)
+		{
+			*output++ = mLast.DT;
+		}
+		if (changes & STChanged)
+		{
+			*output++ = mLast.ST;
+		}
+
+		mLast.PC = pc;
+		mLast.Opcode = opcode;
+		block->Size += static_cast<std::uint32_t>(output - start);
+		block->Count++;
+		mCount++;
+	}
+
+	void CExecutionTrace::Clear(const SContext& c)
+	{
+		// as if the previous instruction was the one before the PC
+		mLast = ToEntry(static_cast<std::uint16_t>(c.PC - InstructionByteSize), c.IR, c);
+		mTimerTicks = c.Ticks;
+		mDTDeadline = c.DTDeadline;
+		mSTDeadline = c.STDeadline;
+		mFirst = 0;
+		mUsed = 0;
+		mCount = 0;
+		mDroppedCount = 0;
+		NextBlock();
+	}
+
+	CExecutionTrace::SBlock& CExecutionTrace::NextBlock()
+	{
+		if (mUsed == mBlocks.size())
+		{
+			mDroppedCount += mBlocks[mFirst].Count;
+			mFirst = (mFirst + 1) % mBlocks.size();
+		}
+		else
+		{
+			mUsed++;
+		}
+
+		mCurrent = &mBlocks[(mFirst + mUsed - 1) % mBlocks.size()];
+		mCurrent->Start = mLast;
+		mCurrent->Count = 0;
+		mCurrent->Size = 0;
+		return *mCurrent;
+	}
+
+	std::vector<SExecutionTraceEntry> CExecutionTrace::Last(std::size_t count) const
+	{
+		// the newest blocks that have enough records
+		std::size_t blockCount = 0;
+		std::size_t recordCount = 0;
+		while (blockCount < mUsed && recordCount < count)
+		{
+			blockCount++;
+			recordCount += mBlocks[(mFirst + mUsed - blockCount) % mBlocks.size()].Count;
+		}
+
+		std::vector<SExecutionTraceEntry> entries{};
+		entries.reserve(recordCount);
+		for (std::size_t i = mUsed - blockCount; i < mUsed; i++)
+		{
+			const SBlock& block = mBlocks[(mFirst + i) % mBlocks.size()];
+			Decode(block.Start, block.Data.data(), block.Size, entries);
+		}
+
+		if (entries.size() > count)
+		{
+			entries.erase(entries.begin(), entries.end() - static_cast<std::ptrdiff_t>(count));
+		}
+		return entries;
+	}
+
+	void CExecutionTrace::Write(std::ostream& output) const
+	{
+		const std::uint32_t blockCount = static_cast<std::uint32_t>(mUsed);
+		output.write(Magic.data(), Magic.size());
+		output.write(reinterpret_cast<const char*>(&Version), sizeof(Version));
+		output.write(reinterpret_cast<const char*>(&blockCount), sizeof(blockCount));
+		for (std::size_t i = 0; i < mUsed; i++)
+		{
+			const SBlock& block = mBlocks[(mFirst + i) % mBlocks.size()];
+			const SExecutionTraceEntry& start = block.Start;
+			output.write(reinterpret_cast<const char*>(&start.PC), sizeof(start.PC));
+			output.write(reinterpret_cast<const char*>(&start.Opcode), sizeof(start.Opcode));
+			output.write(reinterpret_cast<const char*>(start.V.data()), start.V.size());
+			output.write(reinterpret_cast<const char*>(&start.I), sizeof(start.I));
+			output.write(reinterpret_cast<const char*>(&start.SP), sizeof(start.SP));
+			output.write(reinterpret_cast<const char*>(&start.DT), sizeof(start.DT));
+			output.write(reinterpret_cast<const char*>(&start.ST), sizeof(start.ST));
+			output.write(reinterpret_cast<const char*>(&block.Count), sizeof(block.Count));
+			output.write(reinterpret_cast<const char*>(&block.Size), sizeof(block.Size));
+			output.write(reinterpret_cast<const char*>(block.Data.data()), block.Size);
+		}
+	}
+
+	std::vector<SExecutionTraceEntry> CExecutionTrace::Read(std::istream& input)
+	{
+		std::array<char, 4> magic{};
+		std::uint16_t version = 0;
+		std::uint32_t blockCount = 0;
+		input.read(magic.data(), magic.size());
+		input.read(reinterpret_cast<char*>(&version), sizeof(version));
+		input.read(reinterpret_cast<char*>(&blockCount), sizeof(blockCount));
+		if (!input || magic != Magic || version != Version)
+		{
+			throw std::runtime_error("Stream is not a supported execution trace");
+		}
+
+		std::vector<SExecutionTraceEntry> entries{};
+		std::vector<std::uint8_t> data(BlockSize);
+		for (std::uint32_t i = 0; i < blockCount; i++)
+		{
+			SExecutionTraceEntry start{};
+			std::uint32_t count = 0;
+			std::uint32_t size = 0;
+			input.read(reinterpret_cast<char*>(&start.PC), sizeof(start.PC));
+			input.read(reinterpret_cast<char*>(&start.Opcode), sizeof(start.Opcode));
+			input.read(reinterpret_cast<char*>(start.V.data()), start.V.size());
+			input.read(reinterpret_cast<char*>(&start.I), sizeof(start.I));
+			input.read(reinterpret_cast<char*>(&start.SP), sizeof(start.SP));
+			input.read(reinterpret_cast<char*>(&start.DT), sizeof(start.DT));
+			input.read(reinterpret_cast<char*>(&start.ST), sizeof(start.ST));
+			input.read(reinterpret_cast<char*>(&count), sizeof(count));
+			input.read(reinterpret_cast<char*>(&size), sizeof(size));
+			if (!input || size > BlockSize)
+			{
+				throw std::runtime_error("Execution trace is corrupted");
+			}
+
+			input.read(reinterpret_cast<char*>(data.data()), size);
+			const std::size_t previousSize = entries.size();
+			Decode(start, data.data(), size, entries);
+			if (!input || entries.size() - previousSize != count)
+			{
+				throw std::runtime_error("Execution trace is corrupted");
+			}
+		}
+
+		return entries;
+	}
+
+	void CExecutionTrace::WriteText(const std::vector<SExecutionTraceEntry>& entries,
+									std::ostream& output)
+	{
+		for (std::size_t i = 0; i < entries.size(); i++)
+		{
+			const SExecutionTraceEntry& entry = entries[i];
+
+			std::array<char, SInstruction::MaxFormattedSize> text{ "???" };
+			if (auto instruction = CInterpreter::TryFindInstruction(entry.Opcode))
+			{
+				const SInstruction& inst = instruction->get();
+				inst.Format(inst, entry.Opcode, entry.PC, text);
+			}
+
+			// the registers changed by the instruction, unknown for the first one
+			std::string changes{};
+			char buffer[16];
+			if (i > 0)
+			{
+				const SExecutionTraceEntry& previous = entries[i - 1];
+				for (std::size_t r = 0; r < NumberOfRegisters; r++)
+				{
+					if (entry.V[r] != previous.V[r])
+					{
+						std::snprintf(buffer,
+									  std::size(buffer),
+									  " V%X=%02X",
+									  static_cast<std::uint32_t>(r),
+									  entry.V[r]);
+						changes += buffer;
+					}
+				}
+
+				const std::array<std::tuple<const char*, std::uint32_t, std::uint32_t>, 4> others{ {
+					{ " I=%03X", entry.I, previous.I },
+					{ " SP=%02X", entry.SP, previous.SP },
+					{ " DT=%02X", entry.DT, previous.DT },
+					{ " ST=%02X", entry.ST, previous.ST },
+				} };
+				for (const auto& [format, value, previousValue] : others)
+				{
+					if (value != previousValue)
+					{
+						std::snprintf(buffer, std::size(buffer), format, value);
+						changes += buffer;
+					}
+				}
+			}
+
+			char line[80];
+			std::snprintf(line,
+						  std::size(line),
+						  changes.empty() ? "%04X: %04X  %s" : "%04X: %04X  %-18s",
+						  entry.PC,
+						  entry.Opcode,
+						  text.data());
+			output << line << changes << '\n';
+		}
+	}
+
+	void CExecutionTrace::Decode(const SExecutionTraceEntry& start,
+								 const std::uint8_t* data,
+								 std::size_t size,
+								 std::vector<SExecutionTraceEntry>& entries)
+	{
+		SExecutionTraceEntry entry = start;
+		const std::uint8_t* const end = data + size;
+		while (data != end)
+		{
+			std::uint32_t zigzag = 0;
+			data = ReadVarint(data, end, zigzag);
+			const std::int32_t pcDelta =
+				static_cast<std::int32_t>(zigzag >> 1) ^ -static_cast<std::int32_t>(zigzag & 1);
+			entry.PC = static_cast<std::uint16_t>(entry.PC + InstructionByteSize + pcDelta);
+
+			std::uint8_t high = 0;
+			std::uint8_t low = 0;
+			data = ReadByte(data, end, high);
+			data = ReadByte(data, end, low);
+			entry.Opcode = static_cast<std::uint16_t>(high << 8 | low);
+
+			std::uint32_t changes = 0;
+			data = ReadVarint(data, end, changes);
+			for (std::size_t i = 0; i < NumberOfRegisters; i++)
+			{
+				if (changes & (1u << i))
+				{
+					data = ReadByte(data, end, entry.V[i]);
+				}
+			}
+			if (changes & IChanged)
+			{
+				data = ReadByte(data, end, high);
+				data = ReadByte(data, end, low);
+				entry.I = static_cast<std::uint16_t>(high << 8 | low);
+			}
+			if (changes & SPChanged)
+			{
+				data = ReadByte(data, end, entry.SP);
+			}
+			if (changes & DTChanged)
+			{
+				data = ReadByte(data, end, entry.DT);
+			}
+			if (changes & STChanged)
+			{
+				data = ReadByte(data, end, entry.ST);
+			}
+
+			entries.push_back(entry);
+		}
+	}
+}
+
+TEST_CASE("Execution trace")
+{
+	using namespace c8;
+
+	SContext c{};
+	c.PC = 0x200;
+
+	// loops over ADD V1, 1 and JP 200, changing I every few iterations
+	auto run = [&c](CExecutionTrace& trace, std::size_t count) {
+		for (std::size_t i = 0; i < count; i++)
+		{
+			const std::uint16_t pc = c.PC;
+			const std::uint16_t opcode = pc == 0x200 ? 0x7101 : 0x1200;
+			if (pc == 0x200)
+			{
+				c.V[1]++;
+				c.I = static_cast<std::uint16_t>(c.I + (c.V[1] % 4 == 0 ? 0x100 : 0));
+				c.PC = 0x202;
+			}
+			else
+			{
+				c.PC = 0x200;
+			}
+			trace.Record(pc, opcode, c);
+		}
+	};
+
+	SUBCASE("Last")
+	{
+		CExecutionTrace trace{ c };
+		run(trace, 9);
+		CHECK_EQ(trace.Count(), 9u);
+
+		const std::vector<SExecutionTraceEntry> entries = trace.Last(3);
+		REQUIRE_EQ(entries.size(), 3u);
+		CHECK_EQ(entries[0].PC, 0x200);
+		CHECK_EQ(entries[0].Opcode, 0x7101);
+		CHECK_EQ(entries[0].V[1], 4);
+		CHECK_EQ(entries[0].I, 0x100);
+		CHECK_EQ(entries[1].PC, 0x202);
+		CHECK_EQ(entries[2].V[1], 5);
+		CHECK_EQ(trace.Last(100).size(), 9u);
+
+		trace.Clear(c);
+		CHECK(trace.Last(100).empty());
+		run(trace, 1);
+		CHECK_EQ(trace.Last(100).front().PC, 0x202);
+	}
+
+	SUBCASE("Ring")
+	{
+		CExecutionTrace trace{ c, 2 };
+		run(trace, 10000);
+		CHECK_EQ(trace.Count(), 10000u);
+		CHECK_LT(trace.Size(), 2 * CExecutionTrace::BlockSize);
+		CHECK_GT(trace.Size(), CExecutionTrace::BlockSize / 8);
+
+		// the last records are the same once written and read
+		std::stringstream stream{};
+		trace.Write(stream);
+		const std::vector<SExecutionTraceEntry> read = CExecutionTrace::Read(stream);
+		const std::vector<SExecutionTraceEntry> last = trace.Last(trace.Size());
+		REQUIRE_EQ(read.size(), trace.Size());
+		REQUIRE_EQ(last.size(), read.size());
+		CHECK_EQ(read.back().PC, 0x202);
+		CHECK_EQ(read.back().V[1], static_cast<std::uint8_t>(5000));
+		CHECK_EQ(read.back().I, last.back().I);
+		CHECK_EQ(read.front().PC, last.front().PC);
+		CHECK_EQ(read.front().V[1], last.front().V[1]);
+
+		std::stringstream corrupted{ stream.str().substr(0, stream.str().size() - 1) };
+		CHECK_THROWS(CExecutionTrace::Read(corrupted));
+	}
+
+	SUBCASE("Text")
+	{
+		CExecutionTrace trace{ c };
+		run(trace, 4);
+
+		std::ostringstream text{};
+		CExecutionTrace::WriteText(trace.Last(4), text);
+		CHECK_EQ(text.str(),
+				 "0200: 7101  ADD V1, 01\n"
+				 "0202: 1200  JP 200\n"
+				 "0200: 7101  ADD V1, 01         V1=02\n"
+				 "0202: 1200  JP 200\n");
+	}
+}
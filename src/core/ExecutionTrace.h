@@ -0,0 +1,95 @@
+#pragma once
+#include "Constants.h"
+#include "Context.h"
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace c8
+{
+	/// An executed instruction and the registers after it.
+	struct SExecutionTraceEntry
+	{
+		std::uint16_t PC;
+		std::uint16_t Opcode;
+		std::array<std::uint8_t, constants::NumberOfRegisters> V;
+		std::uint16_t I;
+		std::uint8_t SP;
+		std::uint8_t DT;
+		std::uint8_t ST;
+	};
+
+	/// Records every executed instruction in a fixed-size ring of blocks, allocated once so
+	/// recording does not allocate. Each block starts with the registers before its first record
+	/// and the records only store what changed:
+	///   PC        zigzag varint of the difference with the PC of the previous record + 2
+	///   opcode    2 bytes
+	///   changes   varint mask, bits 0-15 for V0-VF, then I, SP, DT and ST
+	///   values    the new value of each changed register, 2 bytes for I and 1 for the rest
+	/// Most instructions take 4 or 5 bytes. When the ring is full the oldest block is dropped.
+	class CExecutionTrace
+	{
+	public:
+		static constexpr std::size_t BlockSize{ 4096 }; // Bytes of records per block
+		static constexpr std::size_t DefaultBlockCount{ 256 };
+		static constexpr std::array<char, 4> Magic{ 'C', '8', 'X', 'T' };
+		static constexpr std::uint16_t Version{ 1 };
+
+	private:
+		static constexpr std::size_t MaxRecordSize{ 3 + 2 + 3 + constants::NumberOfRegisters + 5 };
+
+		struct SBlock
+		{
+			SExecutionTraceEntry Start; // Registers before the first record, PC of the previous
+			std::uint32_t Count;        // Records in the block
+			std::uint32_t Size;         // Bytes used by the records
+			std::array<std::uint8_t, BlockSize> Data;
+		};
+
+		std::vector<SBlock> mBlocks;
+		std::size_t mFirst;          // Index of the oldest block
+		std::size_t mUsed;           // Blocks with records, the newest one is being filled
+		SBlock* mCurrent;            // Newest block
+		SExecutionTraceEntry mLast;  // Registers after the last recorded instruction
+		std::uint64_t mTimerTicks;   // Ticks when the timers in mLast were computed
+		std::uint64_t mDTDeadline;   // Deadlines when the timers in mLast were computed
+		std::uint64_t mSTDeadline;
+		std::uint64_t mCount;        // Records ever recorded
+		std::uint64_t mDroppedCount; // Records in the dropped blocks
+
+	public:
+		/// The registers of the context are the ones before the first recorded instruction.
+		explicit CExecutionTrace(const SContext& c, std::size_t blockCount = DefaultBlockCount);
+
+		/// Records the instruction at the PC, once executed on the context.
+		void Record(std::uint16_t pc, std::uint16_t opcode, const SContext& c);
+		/// Drops the records, the registers of the context are the ones before the next one.
+		void Clear(const SContext& c);
+
+		inline std::uint64_t Count() const { return mCount; }
+		/// Number of records in the ring.
+		inline std::uint64_t Size() const { return mCount - mDroppedCount; }
+
+		/// Decodes the last records, oldest first. Only the blocks that contain them are decoded.
+		std::vector<SExecutionTraceEntry> Last(std::size_t count) const;
+
+		/// Writes the records in the ring, in the same encoding.
+		void Write(std::ostream& output) const;
+		/// Decodes the records written with Write.
+		static std::vector<SExecutionTraceEntry> Read(std::istream& input);
+		/// Writes each entry as a line with its address, opcode, disassembly and the registers it
+		/// changed.
+		static void WriteText(const std::vector<SExecutionTraceEntry>& entries,
+							  std::ostream& output);
+
+	private:
+		SBlock& NextBlock();
+		/// Appends the records of the block to the entries.
+		static void Decode(const SExecutionTraceEntry& start,
+						   const std::uint8_t* data,
+						   std::size_t count,
+						   std::vector<SExecutionTraceEntry>& entries);
+	};
+}
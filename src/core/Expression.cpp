@@ -0,0 +1,407 @@
+#include "Expression.h"
+#include <array>
+#include <cctype>
+#include <doctest/doctest.h>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace c8
+{
+	using EOp = CExpression::EOp;
+	using SOp = CExpression::SOp;
+
+	namespace
+	{
+		struct SBinaryOperator
+		{
+			const char* Token;
+			int Precedence; // Higher binds tighter
+			EOp Op;
+		};
+
+		// the two-character tokens first, so they are matched before their prefixes
+		constexpr std::array<SBinaryOperator, 16> BinaryOperators{ {
+			{ "||", 1, EOp::Or },
+			{ "&&", 2, EOp::And },
+			{ "==", 6, EOp::Equal },
+			{ "!=", 6, EOp::NotEqual },
+			{ "<=", 7, EOp::LessEqual },
+			{ ">=", 7, EOp::GreaterEqual },
+			{ "|", 3, EOp::BitOr },
+			{ "^", 4, EOp::BitXor },
+			{ "&", 5, EOp::BitAnd },
+			{ "<", 7, EOp::Less },
+			{ ">", 7, EOp::Greater },
+			{ "+", 8, EOp::Add },
+			{ "-", 8, EOp::Subtract },
+			{ "*", 9, EOp::Multiply },
+			{ "/", 9, EOp::Divide },
+			{ "%", 9, EOp::Modulo },
+		} };
+
+		// the arithmetic is done on unsigned values, which wrap around instead of overflowing
+		inline std::int64_t WrapNegate(std::int64_t a)
+		{
+			return static_cast<std::int64_t>(0 - static_cast<std::uint64_t>(a));
+		}
+
+		inline std::int64_t WrapMultiply(std::int64_t a, std::int64_t b)
+		{
+			return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) *
+											 static_cast<std::uint64_t>(b));
+		}
+
+		inline std::int64_t WrapAdd(std::int64_t a, std::int64_t b)
+		{
+			return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) +
+											 static_cast<std::uint64_t>(b));
+		}
+
+		inline std::int64_t WrapSubtract(std::int64_t a, std::int64_t b)
+		{
+			return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) -
+											 static_cast<std::uint64_t>(b));
+		}
+
+		/// Recursive descent parser that emits the code in postfix order.
+		class CParser
+		{
+		private:
+			const std::string& mSource;
+			std::size_t mPosition;
+			std::vector<SOp> mCode;
+			int mDepth; // Values on the stack after the emitted code runs
+
+		public:
+			CParser(const std::string& source)
+				: mSource{ source }, mPosition{ 0 }, mCode{}, mDepth{ 0 }
+			{
+			}
+
+			std::vector<SOp> Parse()
+			{
+				ParseBinary(1);
+				SkipSpaces();
+				if (mPosition != mSource.size())
+				{
+					Fail("unexpected '" + mSource.substr(mPosition, 1) + "'");
+				}
+				return std::move(mCode);
+			}
+
+		private:
+			[[noreturn]] void Fail(const std::string& message) const
+			{
+				throw std::invalid_argument("Invalid expression '" + mSource + "': " + message +
+											" at column " + std::to_string(mPosition + 1));
+			}
+
+			void SkipSpaces()
+			{
+				while (mPosition < mSource.size() && std::isspace(mSource[mPosition]))
+				{
+					mPosition++;
+				}
+			}
+
+			bool Accept(const std::string& token)
+			{
+				SkipSpaces();
+				if (mSource.compare(mPosition, token.size(), token) == 0)
+				{
+					mPosition += token.size();
+					return true;
+				}
+				return false;
+			}
+
+			void Expect(const std::string& token)
+			{
+				if (!Accept(token))
+				{
+					Fail("expected '" + token + "'");
+				}
+			}
+
+			void Emit(EOp op, std::int64_t operand, int stackChange)
+			{
+				mCode.push_back({ op, operand });
+				mDepth += stackChange;
+				if (mDepth > static_cast<int>(CExpression::MaxDepth))
+				{
+					Fail("too deeply nested");
+				}
+			}
+
+			void ParseBinary(int minPrecedence)
+			{
+				ParseUnary();
+				for (;;)
+				{
+					SkipSpaces();
+					const SBinaryOperator* match = nullptr;
+					for (const SBinaryOperator& op : BinaryOperators)
+					{
+						const std::size_t length = std::char_traits<char>::length(op.Token);
+						if (mSource.compare(mPosition, length, op.Token) == 0)
+						{
+							match = &op;
+							break;
+						}
+					}
+
+					if (match == nullptr || match->Precedence < minPrecedence)
+					{
+						return;
+					}
+
+					mPosition += std::char_traits<char>::length(match->Token);
+					ParseBinary(match->Precedence + 1);
+					Emit(match->Op, 0, -1);
+				}
+			}
+
+			void ParseUnary()
+			{
+				if (Accept("!"))
+				{
+					ParseUnary();
+					Emit(EOp::Not, 0, 0);
+				}
+				else if (Accept("~"))
+				{
+					ParseUnary();
+					Emit(EOp::BitNot, 0, 0);
+				}
+				else if (Accept("-"))
+				{
+					ParseUnary();
+					Emit(EOp::Negate, 0, 0);
+				}
+				else
+				{
+					ParsePrimary();
+				}
+			}
+
+			void ParsePrimary()
+			{
+				SkipSpaces();
+				if (Accept("("))
+				{
+					ParseBinary(1);
+					Expect(")");
+				}
+				else if (Accept("["))
+				{
+					ParseBinary(1);
+					Expect("]");
+					Emit(EOp::Memory, 0, 0);
+				}
+				else if (mPosition < mSource.size() && std::isdigit(mSource[mPosition]))
+				{
+					ParseNumber();
+				}
+				else if (mPosition < mSource.size() && std::isalpha(mSource[mPosition]))
+				{
+					ParseName();
+				}
+				else
+				{
+					Fail("expected an operand");
+				}
+			}
+
+			void ParseNumber()
+			{
+				const bool hex = mSource.compare(mPosition, 2, "0x") == 0 ||
+								 mSource.compare(mPosition, 2, "0X") == 0;
+				std::size_t end = mPosition + (hex ? 2 : 0);
+				while (end < mSource.size() && std::isxdigit(mSource[end]))
+				{
+					end++;
+				}
+
+				const std::string digits =
+					mSource.substr(mPosition + (hex ? 2 : 0), end - mPosition - (hex ? 2 : 0));
+				std::size_t parsed = 0;
+				std::int64_t value = 0;
+				try
+				{
+					value = std::stoll(digits, &parsed, hex ? 16 : 10);
+				}
+				catch (const std::logic_error&)
+				{
+					parsed = 0;
+				}
+
+				if (digits.empty() || parsed != digits.size())
+				{
+					Fail("invalid number");
+				}
+				mPosition = end;
+				Emit(EOp::Constant, value, 1);
+			}
+
+			void ParseName()
+			{
+				std::size_t end = mPosition;
+				std::string name{};
+				while (end < mSource.size() && std::isalnum(mSource[end]))
+				{
+					name += static_cast<char>(std::toupper(mSource[end]));
+					end++;
+				}
+
+				static constexpr std::array<std::pair<const char*, EOp>, 6> Registers{ {
+					{ "I", EOp::I },
+					{ "PC", EOp::PC },
+					{ "SP", EOp::SP },
+					{ "DT", EOp::DT },
+					{ "ST", EOp::ST },
+					{ "HITS", EOp::Hits },
+				} };
+
+				if (name.size() == 2 && name[0] == 'V' && std::isxdigit(name[1]))
+				{
+					mPosition = end;
+					Emit(EOp::V, std::stoi(name.substr(1), nullptr, 16), 1);
+					return;
+				}
+
+				for (const auto& [registerName, op] : Registers)
+				{
+					if (name == registerName)
+					{
+						mPosition = end;
+						Emit(op, 0, 1);
+						return;
+					}
+				}
+
+				Fail("unknown name '" + name + "'");
+			}
+		};
+	}
+
+	CExpression::CExpression(std::string source, std::vector<SOp> code)
+		: mSource{ std::move(source) }, mCode{ std::move(code) }
+	{
+	}
+
+	CExpression CExpression::Compile(const std::string& source)
+	{
+		CParser parser{ source };
+		std::vector<SOp> code = parser.Parse();
+		return { source, std::move(code) };
+	}
+
+	std::int64_t CExpression::Evaluate(const SContext& c, std::uint64_t hits) const
+	{
+		std::array<std::int64_t, MaxDepth> stack;
+		std::size_t top = 0; // Index after the top value
+
+		for (const SOp& op : mCode)
+		{
+			std::int64_t* const a = top >= 2 ? &stack[top - 2] : nullptr;
+			const std::int64_t b = top >= 1 ? stack[top - 1] : 0;
+			switch (op.Op)
+			{
+			case EOp::Constant: stack[top++] = op.Operand; break;
+			case EOp::V: stack[top++] = c.V[static_cast<std::size_t>(op.Operand)]; break;
+			case EOp::I: stack[top++] = c.I; break;
+			case EOp::PC: stack[top++] = c.PC; break;
+			case EOp::SP: stack[top++] = c.SP; break;
+			case EOp::DT: stack[top++] = c.DT(); break;
+			case EOp::ST: stack[top++] = c.ST(); break;
+			case EOp::Hits: stack[top++] = static_cast<std::int64_t>(hits); break;
+			case EOp::Memory:
+				stack[top - 1] = c.Memory[static_cast<std::uint64_t>(b) % constants::MemorySize];
+				break;
+			case EOp::Negate: stack[top - 1] = WrapNegate(b); break;
+			case EOp::Not: stack[top - 1] = b == 0; break;
+			case EOp::BitNot: stack[top - 1] = ~b; break;
+			case EOp::Multiply: *a = WrapMultiply(*a, b); break;
+			// the minimum divided by -1 traps, and the quotient by -1 is the negation anyway
+			case EOp::Divide: *a = b == -1 ? WrapNegate(*a) : b != 0 ? *a / b : 0; break;
+			case EOp::Modulo: *a = b != 0 && b != -1 ? *a % b : 0; break;
+			case EOp::Add: *a = WrapAdd(*a, b); break;
+			case EOp::Subtract: *a = WrapSubtract(*a, b); break;
+			case EOp::Less: *a = *a < b; break;
+			case EOp::LessEqual: *a = *a <= b; break;
+			case EOp::Greater: *a = *a > b; break;
+			case EOp::GreaterEqual: *a = *a >= b; break;
+			case EOp::Equal: *a = *a == b; break;
+			case EOp::NotEqual: *a = *a != b; break;
+			case EOp::BitAnd: *a &= b; break;
+			case EOp::BitXor: *a ^= b; break;
+			case EOp::BitOr: *a |= b; break;
+			case EOp::And: *a = *a != 0 && b != 0; break;
+			case EOp::Or: *a = *a != 0 || b != 0; break;
+			}
+
+			// binary operators leave one value out of two
+			if (op.Op >= EOp::Multiply)
+			{
+				top--;
+			}
+		}
+
+		return top != 0 ? stack[top - 1] : 0;
+	}
+}
+
+TEST_CASE("Expression")
+{
+	using namespace c8;
+
+	SContext c{};
+	c.V[3] = 0x10;
+	c.V[0xA] = 7;
+	c.I = 0x310;
+	c.PC = 0x200;
+	c.Memory.Write(0x310, 0x42);
+
+	auto evaluate = [&c](const std::string& source, std::uint64_t hits = 0) {
+		return CExpression::Compile(source).Evaluate(c, hits);
+	};
+
+	CHECK_EQ(evaluate("V3 == 0x10 && I > 0x300"), 1);
+	CHECK_EQ(evaluate("v3 == 0x10 && i > 0x400"), 0);
+	CHECK_EQ(evaluate("1 + 2 * 3 - VA"), 0);
+	CHECK_EQ(evaluate("(1 + 2) * 3 % 5"), 4);
+	CHECK_EQ(evaluate("[I] | 1 ^ 2 & 3"), 0x42 | (1 ^ (2 & 3)));
+	CHECK_EQ(evaluate("[I + 0x10 - 0x10] == 66"), 1);
+	CHECK_EQ(evaluate("!V0 && ~0 == -1 && -VA < 0"), 1);
+	CHECK_EQ(evaluate("PC >= 0x200 || 1 / 0"), 1);
+	CHECK_EQ(evaluate("VA / 0 + VA % 0"), 0);
+	CHECK_EQ(evaluate("HITS % 10 == 0", 20), 1);
+	CHECK_EQ(evaluate("HITS % 10 == 0", 21), 0);
+
+	// the arithmetic wraps around instead of overflowing or trapping
+	constexpr std::int64_t Min{ std::numeric_limits<std::int64_t>::min() };
+	constexpr std::int64_t Max{ std::numeric_limits<std::int64_t>::max() };
+	CHECK_EQ(evaluate("(-9223372036854775807 - 1) / -1"), Min);
+	CHECK_EQ(evaluate("(-9223372036854775807 - 1) % -1"), 0);
+	CHECK_EQ(evaluate("-(-9223372036854775807 - 1)"), Min);
+	CHECK_EQ(evaluate("9223372036854775807 + 1"), Min);
+	CHECK_EQ(evaluate("-9223372036854775807 - 2"), Max);
+	CHECK_EQ(evaluate("9223372036854775807 * 2"), -2);
+	CHECK_EQ(evaluate("-7 / -1 + -7 % -1"), 7);
+	CHECK_EQ(evaluate("-7 / 2 + -7 % 2"), -4);
+
+	CHECK_THROWS(CExpression::Compile(""));
+	CHECK_THROWS(CExpression::Compile("V3 =="));
+	CHECK_THROWS(CExpression::Compile("V3 = 1"));
+	CHECK_THROWS(CExpression::Compile("(V3"));
+	CHECK_THROWS(CExpression::Compile("VG"));
+	CHECK_THROWS(CExpression::Compile("0x"));
+
+	std::string nested = "1";
+	for (std::size_t i = 0; i < CExpression::MaxDepth; i++)
+	{
+		nested = "1 + (" + nested + ")";
+	}
+	CHECK_THROWS(CExpression::Compile(nested));
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "Context.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace c8
+{
+	/// An integer expression over the interpreter state, compiled once to a stack bytecode so it
+	/// can be evaluated on every cycle at a breakpoint. The syntax is a subset of C:
+	///   operands   V0-VF, I, PC, SP, DT, ST, HITS, [address] for a memory byte, numbers in
+	///              decimal or with 0x in hexadecimal
+	///   operators  ! ~ - (unary), * / %, + -, < <= > >=, == !=, &, ^, |, &&, || and parentheses
+	/// HITS is the number of times the breakpoint was reached, this one included. Division by 0
+	/// gives 0 and the arithmetic wraps around on overflow, so no expression traps.
+	class CExpression
+	{
+	public:
+		static constexpr std::size_t MaxDepth{ 16 }; // Values on the stack at once
+
+		enum class EOp : std::uint8_t
+		{
+			Constant, // Pushes the operand
+			V,        // Pushes V[operand]
+			I,
+			PC,
+			SP,
+			DT,
+			ST,
+			Hits,
+			Memory, // Replaces the address on top with the byte at it
+			Negate,
+			Not,
+			BitNot,
+			Multiply,
+			Divide,
+			Modulo,
+			Add,
+			Subtract,
+			Less,
+			LessEqual,
+			Greater,
+			GreaterEqual,
+			Equal,
+			NotEqual,
+			BitAnd,
+			BitXor,
+			BitOr,
+			And,
+			Or,
+		};
+
+		struct SOp
+		{
+			EOp Op;
+			std::int64_t Operand;
+		};
+
+	private:
+		std::string mSource;
+		std::vector<SOp> mCode;
+
+	public:
+		/// Throws std::invalid_argument if the source is not a valid expression.
+		static CExpression Compile(const std::string& source);
+
+		inline const std::string& Source() const { return mSource; }
+		inline const std::vector<SOp>& Code() const { return mCode; }
+
+		std::int64_t Evaluate(const SContext& c, std::uint64_t hits) const;
+
+	private:
+		CExpression(std::string source, std::vector<SOp> code);
+	};
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+
+namespace c8
+{
+	/// SplitMix64 finalizer, a bijection so distinct inputs give distinct outputs.
+	inline std::uint64_t Mix64(std::uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+		return z ^ (z >> 31);
+	}
+
+	/// Parts of the state with their own set of Zobrist keys.
+	enum class EHashDomain : std::uint8_t
+	{
+		Memory = 1,
+		Pixels,
+		Registers,
+	};
+
+	/// Key of a value at an index of the state. The state hash is the XOR of the keys of all its
+	/// values, so changing a value only needs to XOR out the old key and XOR in the new one.
+	/// Zero values have no key, so an all-zero buffer hashes to 0.
+	inline std::uint64_t ZobristKey(EHashDomain domain, std::uint32_t index, std::uint8_t value)
+	{
+		if (value == 0)
+		{
+			return 0;
+		}
+
+		return Mix64(std::uint64_t{ static_cast<std::uint8_t>(domain) } << 40 |
+					 std::uint64_t{ index } << 8 | value);
+	}
+}
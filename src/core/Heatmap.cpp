@@ -0,0 +1,130 @@
+#include "Heatmap.h"
+#include "Interpreter.h"
+#include <algorithm>
+#include <cmath>
+#include <doctest/doctest.h>
+
+namespace c8
+{
+	CHeatmap::CHeatmap() : mCounts{}, mMaxCount{ 0 }, mBackJumps{} {}
+
+	float CHeatmap::Heat(std::uint16_t address) const
+	{
+		const std::uint64_t count = Count(address);
+		if (count == 0)
+		{
+			return 0.0f;
+		}
+
+		return static_cast<float>(std::log2(1.0 + count) / std::log2(1.0 + mMaxCount));
+	}
+
+	void CHeatmap::Reset()
+	{
+		mCounts.fill(0);
+		mMaxCount = 0;
+		mBackJumps.clear();
+	}
+
+	std::vector<SHeatmapEntry> CHeatmap::Hottest(std::size_t count) const
+	{
+		std::vector<SHeatmapEntry> entries{};
+		for (std::size_t slot = 0; slot < SlotCount; slot++)
+		{
+			if (mCounts[slot] != 0)
+			{
+				const std::size_t address = slot * constants::InstructionByteSize;
+				entries.push_back({ static_cast<std::uint16_t>(address), mCounts[slot] });
+			}
+		}
+
+		auto hotter = [](const SHeatmapEntry& a, const SHeatmapEntry& b) {
+			return a.Count > b.Count;
+		};
+		count = std::min(count, entries.size());
+		std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), hotter);
+		entries.resize(count);
+		return entries;
+	}
+
+	std::vector<SHeatmapLoop> CHeatmap::Loops() const
+	{
+		std::vector<SHeatmapLoop> loops{};
+		for (const auto& [key, iterations] : mBackJumps)
+		{
+			SHeatmapLoop loop{ static_cast<std::uint16_t>(key & 0xFFFF),
+							   static_cast<std::uint16_t>(key >> 16),
+							   iterations,
+							   0 };
+			for (std::uint32_t address = loop.Start; address <= loop.End;
+				 address += constants::InstructionByteSize)
+			{
+				loop.Cycles += Count(static_cast<std::uint16_t>(address));
+			}
+			loops.push_back(loop);
+		}
+
+		std::sort(loops.begin(), loops.end(), [](const SHeatmapLoop& a, const SHeatmapLoop& b) {
+			return a.Cycles > b.Cycles;
+		});
+		return loops;
+	}
+}
+
+TEST_CASE("Heatmap")
+{
+	using namespace c8;
+
+	// an inner loop of 0x10 iterations run 3 times, then an idle loop
+	const std::vector<std::uint8_t> program{
+		0x61, 0x03, // 200: LD V1, 03
+		0x60, 0x10, // 202: LD V0, 10
+		0x70, 0xFF, // 204: ADD V0, FF
+		0x30, 0x00, // 206: SE V0, 00
+		0x12, 0x04, // 208: JP 204
+		0x71, 0xFF, // 20A: ADD V1, FF
+		0x31, 0x00, // 20C: SE V1, 00
+		0x12, 0x02, // 20E: JP 202
+		0x12, 0x10, // 210: JP 210
+	};
+
+	CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+	interpreter.LoadProgram(program);
+	CHECK_EQ(interpreter.Heatmap(), nullptr);
+
+	interpreter.EnableHeatmap(true);
+	REQUIRE_NE(interpreter.Heatmap(), nullptr);
+	const CHeatmap& heatmap = *interpreter.Heatmap();
+
+	// 1 + 3 * (1 + 0x10 * 2 + 0xF + 2) + 2 outer jumps + 100 idle jumps
+	interpreter.RunCycles(1 + 3 * 0x32 + 2 + 100);
+	CHECK_EQ(heatmap.Count(0x200), 1);
+	CHECK_EQ(heatmap.Count(0x204), 0x30);
+	CHECK_EQ(heatmap.Count(0x208), 0x2D);
+	CHECK_EQ(heatmap.Count(0x20E), 2);
+	CHECK_EQ(heatmap.Count(0x210), 100);
+	CHECK_EQ(heatmap.Count(0x212), 0);
+	CHECK_EQ(heatmap.MaxCount(), 100);
+	CHECK_EQ(heatmap.Heat(0x210), 1.0f);
+	CHECK_EQ(heatmap.Heat(0x212), 0.0f);
+
+	const std::vector<SHeatmapEntry> hottest = heatmap.Hottest(2);
+	REQUIRE_EQ(hottest.size(), 2);
+	CHECK_EQ(hottest[0].Address, 0x210);
+	CHECK_EQ(hottest[1].Count, 0x30);
+
+	const std::vector<SHeatmapLoop> loops = heatmap.Loops();
+	REQUIRE_EQ(loops.size(), 3);
+	CHECK_EQ(loops[0].Start, 0x202);
+	CHECK_EQ(loops[0].End, 0x20E);
+	CHECK_EQ(loops[0].Iterations, 2);
+	CHECK_EQ(loops[1].Start, 0x204);
+	CHECK_EQ(loops[1].Iterations, 0x2D);
+	CHECK_EQ(loops[1].Cycles, 0x30 * 2 + 0x2D);
+	CHECK_EQ(loops[2].Start, 0x210);
+	CHECK_EQ(loops[2].End, 0x210);
+
+	interpreter.ResetHeatmap();
+	CHECK_EQ(heatmap.MaxCount(), 0);
+	CHECK(heatmap.Loops().empty());
+}
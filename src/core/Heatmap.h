@@ -0,0 +1,77 @@
+#pragma once
+#include "Constants.h"
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace c8
+{
+	struct SHeatmapEntry
+	{
+		std::uint16_t Address;
+		std::uint64_t Count;
+	};
+
+	/// Code between the target of a backward jump and the jump.
+	struct SHeatmapLoop
+	{
+		std::uint16_t Start;
+		std::uint16_t End; // Address of the jump
+		std::uint64_t Iterations;
+		std::uint64_t Cycles; // Executions of the instructions in the loop, including other loops
+	};
+
+	/// Number of times the instruction at each address was executed, indexed by PC / 2 like the
+	/// debugger breakpoints, and the backward jumps taken, which close the loops of the program.
+	class CHeatmap
+	{
+	public:
+		static constexpr std::size_t SlotCount{ constants::MemorySize /
+												constants::InstructionByteSize };
+
+	private:
+		std::array<std::uint64_t, SlotCount> mCounts;
+		std::uint64_t mMaxCount;
+		std::unordered_map<std::uint32_t, std::uint64_t> mBackJumps; // Keyed by from << 16 | to
+
+	public:
+		CHeatmap();
+
+		inline std::uint64_t Count(std::uint16_t address) const { return mCounts[Slot(address)]; }
+		inline std::uint64_t MaxCount() const { return mMaxCount; }
+		/// Count of the address relative to the hottest one, in [0, 1] and in a logarithmic scale.
+		float Heat(std::uint16_t address) const;
+
+		/// Records the instruction executed at the address, that moved the PC to the next address.
+		inline void RecordExecution(std::uint16_t address, std::uint16_t opcode, std::uint16_t next)
+		{
+			std::uint64_t& count = mCounts[Slot(address)];
+			count++;
+			if (count > mMaxCount)
+			{
+				mMaxCount = count;
+			}
+
+			// only JP and JP V0 can close a loop, CALL and RET jump back to other code
+			const std::uint16_t kind = opcode & 0xF000;
+			if ((kind == 0x1000 || kind == 0xB000) && next <= address)
+			{
+				mBackJumps[std::uint32_t{ address } << 16 | next]++;
+			}
+		}
+
+		void Reset();
+
+		/// The addresses executed the most, hottest first.
+		std::vector<SHeatmapEntry> Hottest(std::size_t count) const;
+		/// The loops that were executed, the ones that took most cycles first.
+		std::vector<SHeatmapLoop> Loops() const;
+
+	private:
+		static inline std::size_t Slot(std::uint16_t address)
+		{
+			return (address / constants::InstructionByteSize) % SlotCount;
+		}
+	};
+}
@@ -0,0 +1,208 @@
+#include "History.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <gsl/gsl_util>
+
+namespace c8
+{
+	CHistory::CHistory(const SContext& initialContext)
+		: mEvents{},
+		  mCheckpoints{},
+		  mFirstEventPosition{ 0 },
+		  mPosition{ 0 },
+		  mCheckpointInterval{ DefaultCheckpointInterval },
+		  mMaxCheckpointInterval{ AssumedReplayEventsPerSecond * MaxReplayDuration.count() / 1000 }
+	{
+		mCheckpoints.push_back({ 0, initialContext });
+	}
+
+	const SHistoryEvent& CHistory::Event(std::size_t position) const
+	{
+		Expects(position >= mFirstEventPosition && position < EndPosition());
+
+		return mEvents[position - mFirstEventPosition];
+	}
+
+	const SHistoryCheckpoint& CHistory::FindCheckpoint(std::size_t position) const
+	{
+		Expects(position >= BeginPosition());
+
+		// find the last checkpoint taken at or before the position
+		auto it = std::upper_bound(
+			mCheckpoints.begin(),
+			mCheckpoints.end(),
+			position,
+			[](std::size_t pos, const SHistoryCheckpoint& cp) { return pos < cp.Position; });
+		return *std::prev(it);
+	}
+
+	std::optional<std::size_t> CHistory::FindPreviousCycle(std::size_t position) const
+	{
+		for (std::size_t pos = std::min(position, EndPosition()); pos > mFirstEventPosition; pos--)
+		{
+			if (Event(pos - 1).Type == EHistoryEventType::Cycle)
+			{
+				return pos - 1;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	void CHistory::Record(const SHistoryEvent& event, const SContext& contextAfter)
+	{
+		Truncate();
+
+		mEvents.push_back(event);
+		mPosition++;
+
+		if ((mPosition - mCheckpoints.back().Position) >= mCheckpointInterval)
+		{
+			mCheckpoints.push_back({ mPosition, contextAfter });
+		}
+
+		Compact();
+	}
+
+	void CHistory::Seek(std::size_t position)
+	{
+		Expects(position >= BeginPosition() && position <= EndPosition());
+
+		mPosition = position;
+	}
+
+	void CHistory::ReportReplay(std::size_t eventCount, std::chrono::nanoseconds duration)
+	{
+		if (eventCount == 0 || duration.count() <= 0)
+		{
+			return;
+		}
+
+		const double eventsPerNanosecond = static_cast<double>(eventCount) / duration.count();
+		const double maxDuration = std::chrono::nanoseconds{ MaxReplayDuration }.count();
+		mMaxCheckpointInterval = std::max(
+			MinCheckpointInterval, static_cast<std::size_t>(eventsPerNanosecond * maxDuration));
+		mCheckpointInterval = std::min(mCheckpointInterval, mMaxCheckpointInterval);
+	}
+
+	void CHistory::Truncate()
+	{
+		if (mPosition == EndPosition())
+		{
+			return;
+		}
+
+		mEvents.resize(mPosition - mFirstEventPosition);
+		while (mCheckpoints.back().Position > mPosition)
+		{
+			mCheckpoints.pop_back();
+		}
+	}
+
+	void CHistory::Compact()
+	{
+		if (mCheckpoints.size() > MaxCheckpoints)
+		{
+			if ((mCheckpointInterval * 2) <= mMaxCheckpointInterval)
+			{
+				// keep every other checkpoint, the first one included
+				std::deque<SHistoryCheckpoint> thinned{};
+				for (std::size_t i = 0; i < mCheckpoints.size(); i += 2)
+				{
+					thinned.push_back(std::move(mCheckpoints[i]));
+				}
+				mCheckpoints = std::move(thinned);
+				mCheckpointInterval *= 2;
+			}
+			else
+			{
+				DropOldestCheckpoint();
+			}
+		}
+
+		while (mEvents.size() > MaxEvents && mCheckpoints.size() > 1)
+		{
+			DropOldestCheckpoint();
+		}
+	}
+
+	void CHistory::DropOldestCheckpoint()
+	{
+		mCheckpoints.pop_front();
+
+		const std::size_t newFirstEventPosition =
+			std::min(mCheckpoints.front().Position, mPosition);
+		mEvents.erase(mEvents.begin(),
+					  std::next(mEvents.begin(), newFirstEventPosition - mFirstEventPosition));
+		mFirstEventPosition = newFirstEventPosition;
+	}
+}
+
+TEST_CASE("History")
+{
+	using namespace c8;
+
+	SContext c{};
+	CHistory h{ c };
+
+	auto record = [&h, &c](std::size_t count) {
+		for (std::size_t i = 0; i < count; i++)
+		{
+			c.PC = gsl::narrow_cast<std::uint16_t>((c.PC + 2) % constants::MemorySize);
+			h.Record({ EHistoryEventType::Cycle, c.PC, 0 }, c);
+		}
+	};
+
+	SUBCASE("Checkpoints are taken periodically")
+	{
+		record(CHistory::DefaultCheckpointInterval * 3);
+
+		CHECK_EQ(h.Position(), CHistory::DefaultCheckpointInterval * 3);
+		CHECK_EQ(h.CheckpointCount(), 4);
+		CHECK_EQ(h.FindCheckpoint(CHistory::DefaultCheckpointInterval + 5).Position,
+				 CHistory::DefaultCheckpointInterval);
+		CHECK_EQ(h.FindCheckpoint(CHistory::DefaultCheckpointInterval * 3).Context.PC,
+				 c.PC);
+	}
+
+	SUBCASE("Recording after seeking back discards the future")
+	{
+		record(CHistory::DefaultCheckpointInterval * 2);
+		h.Seek(10);
+		record(1);
+
+		CHECK_EQ(h.Position(), 11);
+		CHECK_EQ(h.EndPosition(), 11);
+		CHECK_EQ(h.CheckpointCount(), 1);
+	}
+
+	SUBCASE("Previous cycle skips timer ticks")
+	{
+		record(3);
+		h.Record({ EHistoryEventType::TimerTick, 0, 0 }, c);
+
+		CHECK_EQ(h.FindPreviousCycle(h.Position()), 2);
+		CHECK_EQ(h.FindPreviousCycle(0), std::nullopt);
+	}
+
+	SUBCASE("Checkpoints are thinned out in long sessions")
+	{
+		record(CHistory::DefaultCheckpointInterval * (CHistory::MaxCheckpoints + 1));
+
+		CHECK(h.CheckpointCount() <= CHistory::MaxCheckpoints);
+		CHECK_EQ(h.CheckpointInterval(), CHistory::DefaultCheckpointInterval * 2);
+		CHECK_EQ(h.BeginPosition(), 0);
+	}
+
+	SUBCASE("Oldest history is dropped once the replay budget is reached")
+	{
+		// pretend replaying is slow so that the interval cannot grow
+		h.ReportReplay(CHistory::MinCheckpointInterval, CHistory::MaxReplayDuration);
+		record(CHistory::MinCheckpointInterval * (CHistory::MaxCheckpoints + 1));
+
+		CHECK_EQ(h.CheckpointInterval(), CHistory::MinCheckpointInterval);
+		CHECK_EQ(h.CheckpointCount(), CHistory::MaxCheckpoints);
+		CHECK(h.BeginPosition() > 0);
+		CHECK_THROWS(h.Seek(0));
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "Context.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+namespace c8
+{
+	enum class EHistoryEventType : std::uint8_t
+	{
+		Cycle,
+		TimerTick,
+	};
+
+	/// Everything needed to deterministically re-execute a single event, the rest of the state
+	/// (including the RND generator) is restored from the checkpoints.
+	struct SHistoryEvent
+	{
+		EHistoryEventType Type;
+		std::uint16_t PC;              // The program counter before the cycle
+		SPackedKeyboardState Keyboard; // The keyboard state seen by the cycle
+	};
+
+	struct SHistoryCheckpoint
+	{
+		std::size_t Position; // Number of events executed before this snapshot was taken
+		SContext Context;
+	};
+
+	/// Execution history used for reverse debugging: a log of every executed event plus periodic
+	/// context snapshots. Going back in time restores the nearest checkpoint and re-executes the
+	/// logged events from there.
+	///
+	/// The checkpoint interval never exceeds the number of events that can be re-executed within
+	/// MaxReplayDuration, measured on each replay, so a reverse step costs a bounded amount of
+	/// time regardless of the session length. When MaxCheckpoints is reached the checkpoints are
+	/// thinned out (doubling the interval) while that bound holds; after that the oldest history
+	/// is dropped.
+	class CHistory
+	{
+	public:
+		static constexpr std::chrono::milliseconds MaxReplayDuration{ 20 };
+		static constexpr std::size_t AssumedReplayEventsPerSecond{ 1'000'000 }; // Until measured
+		static constexpr std::size_t DefaultCheckpointInterval{ 1024 };
+		static constexpr std::size_t MinCheckpointInterval{ 64 };
+		static constexpr std::size_t MaxCheckpoints{ 512 };
+		static constexpr std::size_t MaxEvents{ 1 << 22 };
+
+	private:
+		std::deque<SHistoryEvent> mEvents;
+		std::deque<SHistoryCheckpoint> mCheckpoints;
+		std::size_t mFirstEventPosition; // Position of the first event in mEvents
+		std::size_t mPosition;           // Position of the next event to be executed
+		std::size_t mCheckpointInterval;
+		std::size_t mMaxCheckpointInterval; // Events that can be re-executed in MaxReplayDuration
+
+	public:
+		CHistory(const SContext& initialContext);
+
+		inline std::size_t Position() const { return mPosition; }
+		inline std::size_t BeginPosition() const { return mCheckpoints.front().Position; }
+		inline std::size_t EndPosition() const { return mFirstEventPosition + mEvents.size(); }
+		inline std::size_t CheckpointInterval() const { return mCheckpointInterval; }
+		inline std::size_t CheckpointCount() const { return mCheckpoints.size(); }
+
+		const SHistoryEvent& Event(std::size_t position) const;
+		const SHistoryCheckpoint& FindCheckpoint(std::size_t position) const;
+
+		/// Returns the position of the last cycle before `position`, if any.
+		std::optional<std::size_t> FindPreviousCycle(std::size_t position) const;
+
+		/// Appends an event executed live. Any events after the current position are discarded,
+		/// since they belong to a timeline that no longer exists.
+		void Record(const SHistoryEvent& event, const SContext& contextAfter);
+
+		/// Moves the current position, after the interpreter re-executed the events up to it.
+		void Seek(std::size_t position);
+
+		/// Adapts the checkpoint interval to how fast the interpreter re-executes events.
+		void ReportReplay(std::size_t eventCount, std::chrono::nanoseconds duration);
+
+	private:
+		void Truncate();
+		void Compact();
+		void DropOldestCheckpoint();
+	};
+}
@@ -0,0 +1,114 @@
+#include "IdleDetector.h"
+#include <doctest/doctest.h>
+#include <gsl/gsl_util>
+
+namespace c8
+{
+	CIdleDetector::CIdleDetector() : mSlots{}, mCycle{ 0 } {}
+
+	void CIdleDetector::Reset()
+	{
+		for (SSlot& slot : mSlots)
+		{
+			slot.Valid = false;
+		}
+	}
+
+	std::uint32_t CIdleDetector::RecordRepeatedRegisters(const SContext& c,
+														 SSlot& slot,
+														 std::uint64_t period)
+	{
+		if (slot.Complete && slot.Matches(c))
+		{
+			return gsl::narrow_cast<std::uint32_t>(period);
+		}
+
+		slot.Complete = true;
+		slot.Store(c);
+		return 0;
+	}
+
+	bool CIdleDetector::SSlot::Matches(const SContext& c) const
+	{
+		return SP == c.SP && DTDeadline == c.DTDeadline && STDeadline == c.STDeadline &&
+			   MemoryHash == c.Memory.Hash() && DisplayHash == c.Display.PixelBuffer.Hash() &&
+			   ExtendedMode == c.Display.ExtendedMode && Stack == c.Stack && R == c.R &&
+			   RandomState == c.Random.State;
+	}
+
+	void CIdleDetector::SSlot::Store(const SContext& c)
+	{
+		SP = c.SP;
+		DTDeadline = c.DTDeadline;
+		STDeadline = c.STDeadline;
+		ExtendedMode = c.Display.ExtendedMode;
+		Stack = c.Stack;
+		R = c.R;
+		RandomState = c.Random.State;
+		MemoryHash = c.Memory.Hash();
+		DisplayHash = c.Display.PixelBuffer.Hash();
+	}
+}
+
+TEST_CASE("Idle detector")
+{
+	using namespace c8;
+
+	SContext c{};
+	CIdleDetector detector{};
+
+	// LD V0, DT / SE V0, 00 / JP 200, only the timer tick can take it out of the loop
+	auto iteration = [&c, &detector]() {
+		std::uint32_t period = 0;
+		c.PC = 0x202;
+		c.V[0] = c.DT();
+		period |= detector.RecordCycle(c, 0x200);
+		c.PC = 0x204;
+		period |= detector.RecordCycle(c, 0x202);
+		c.PC = 0x200;
+		period |= detector.RecordCycle(c, 0x204);
+		return period;
+	};
+
+	c.SetDT(5);
+	CHECK_EQ(iteration(), 0u); // V and I are stored
+	CHECK_EQ(iteration(), 0u); // They repeat, the rest of the state is stored
+	CHECK_EQ(iteration(), 3u);
+	CHECK_EQ(iteration(), 3u);
+
+	// the timer tick changes the state, the next iterations start over
+	detector.Reset();
+	c.Ticks++;
+	CHECK_EQ(iteration(), 0u);
+	CHECK_EQ(iteration(), 0u);
+	CHECK_EQ(iteration(), 3u);
+
+	// even without a reset, a different state is not idle
+	c.Ticks++;
+	CHECK_EQ(iteration(), 0u);
+	CHECK_EQ(iteration(), 0u);
+	CHECK_EQ(iteration(), 3u);
+
+	// progress in memory, with the same registers, is not idle
+	detector.Reset();
+	for (std::uint8_t i = 0; i < 4; i++)
+	{
+		c.Memory.Write(0x300, i);
+		CHECK_EQ(iteration(), 0u);
+	}
+
+	// LD V1, K while no key is down
+	detector.Reset();
+	c.PC = 0x206;
+	CHECK_EQ(detector.RecordCycle(c, 0x206), 0u);
+	CHECK_EQ(detector.RecordCycle(c, 0x206), 0u);
+	CHECK_EQ(detector.RecordCycle(c, 0x206), 1u);
+
+	// the ticks move the timers towards their deadlines, which stay the same
+	detector.Reset();
+	c.SetST(10);
+	CHECK_EQ(detector.RecordCycle(c, 0x206), 0u);
+	CHECK_EQ(detector.RecordCycle(c, 0x206), 0u);
+	c.Ticks++;
+	CHECK_EQ(detector.RecordCycle(c, 0x206), 1u);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "Constants.h"
+#include "Context.h"
+#include <array>
+#include <cstdint>
+
+namespace c8
+{
+	/// Detects the loops a program runs while it waits for a timer tick or a key press, like
+	/// LD Vx, DT / SE Vx, 0 / JP or LD Vx, K. On each backward jump, the state is compared with
+	/// the one of the previous jump to the same address. If nothing changed, the loop makes no
+	/// progress and the state repeats every that many cycles, until something besides the program
+	/// changes it.
+	class CIdleDetector
+	{
+	public:
+		static constexpr std::size_t SlotCount{ 4 }; // Jump targets tracked at once
+
+	private:
+		/// The state when jumping back to the target. The registers are kept in full, and the
+		/// memory and the display by their hashes. Most loops change V or I on every iteration,
+		/// so the rest is only stored once those repeat.
+		struct SSlot
+		{
+			bool Valid;
+			bool Complete; // Whether the state besides V and I was stored
+			std::uint16_t Target;
+			std::uint64_t Cycle;
+			std::array<std::uint8_t, constants::NumberOfRegisters> V;
+			std::uint16_t I;
+			std::uint8_t SP;
+			std::uint64_t DTDeadline; // The values change on every tick, the deadlines do not
+			std::uint64_t STDeadline;
+			bool ExtendedMode;
+			std::array<std::uint16_t, constants::StackSize> Stack;
+			std::array<std::uint8_t, constants::schip::NumberOfRPLFlags> R;
+			decltype(SRandomGenerator::State) RandomState;
+			std::uint64_t MemoryHash;
+			std::uint64_t DisplayHash;
+
+			bool Matches(const SContext& c) const;
+			void Store(const SContext& c);
+		};
+
+		std::array<SSlot, SlotCount> mSlots;
+		std::uint64_t mCycle;
+
+	public:
+		CIdleDetector();
+
+		/// Forgets the recorded states. Called when anything besides the program changes the state
+		/// or its inputs, like a timer tick or a key press, and when the program has effects
+		/// outside of it, like updating the display.
+		void Reset();
+
+		/// Records a cycle that moved the PC from the given address. Returns the number of cycles
+		/// after which the state repeats, or 0 if the program is not known to be idle.
+		inline std::uint32_t RecordCycle(const SContext& c, std::uint16_t pc)
+		{
+			mCycle++;
+			// LD Vx, K moves the PC back to itself
+			if (c.PC > pc)
+			{
+				return 0;
+			}
+
+			SSlot& slot = mSlots[(c.PC / constants::InstructionByteSize) % SlotCount];
+			const std::uint64_t period = mCycle - slot.Cycle;
+			slot.Cycle = mCycle;
+			if (!slot.Valid || slot.Target != c.PC || slot.V != c.V || slot.I != c.I)
+			{
+				slot.Valid = true;
+				slot.Complete = false;
+				slot.Target = c.PC;
+				slot.V = c.V;
+				slot.I = c.I;
+				return 0;
+			}
+
+			return RecordRepeatedRegisters(c, slot, period);
+		}
+
+	private:
+		/// Called when V and I are the same as the previous time the slot was recorded.
+		std::uint32_t RecordRepeatedRegisters(const SContext& c, SSlot& slot, std::uint64_t period);
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace c8
+{
+	/// Read-only iterator over a container of bytes that are only accessible through operator[].
+	template<class TContainer>
+	class CIndexedConstIterator
+	{
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = std::uint8_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = std::uint8_t;
+
+	private:
+		const TContainer* mContainer;
+		std::size_t mIndex;
+
+	public:
+		CIndexedConstIterator(const TContainer& container, std::size_t index)
+			: mContainer{ &container }, mIndex{ index }
+		{
+		}
+
+		inline reference operator*() const { return (*mContainer)[mIndex]; }
+
+		inline CIndexedConstIterator& operator++()
+		{
+			mIndex++;
+			return *this;
+		}
+
+		inline CIndexedConstIterator operator++(int)
+		{
+			CIndexedConstIterator copy = *this;
+			mIndex++;
+			return copy;
+		}
+
+		inline CIndexedConstIterator operator+(std::size_t offset) const
+		{
+			return { *mContainer, mIndex + offset };
+		}
+
+		inline difference_type operator-(const CIndexedConstIterator& other) const
+		{
+			return static_cast<difference_type>(mIndex) -
+				   static_cast<difference_type>(other.mIndex);
+		}
+
+		inline bool operator==(const CIndexedConstIterator& other) const
+		{
+			return mContainer == other.mContainer && mIndex == other.mIndex;
+		}
+		inline bool operator!=(const CIndexedConstIterator& other) const
+		{
+			return !(*this == other);
+		}
+	};
+}
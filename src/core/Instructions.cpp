@@ -1,96 +1,113 @@
 #include "Instructions.h"
 #include "Interpreter.h"
+#include "Watchpoints.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
 #include <doctest/doctest.h>
+#include <gsl/gsl_assert>
 #include <gsl/gsl_util>
-#include <iomanip>
-#include <random>
-#include <sstream>
 
 using namespace c8;
 using namespace c8::constants;
 
-static std::string ToString_NAME(const SInstruction& i, const SContext&)
+/// Writes like snprintf, returning the length written instead of the length needed.
+static std::size_t Write(gsl::span<char> buffer, const char* format, ...)
 {
-	return i.Name;
+	Expects(buffer.size() > 0);
+
+	const std::size_t size = static_cast<std::size_t>(buffer.size());
+	std::va_list args;
+	va_start(args, format);
+	const int length = std::vsnprintf(buffer.data(), size, format, args);
+	va_end(args);
+	return std::min(static_cast<std::size_t>(std::max(length, 0)), size - 1);
+}
+
+static std::size_t
+Format_NAME(const SInstruction& i, std::uint16_t, std::uint16_t, gsl::span<char> buffer)
+{
+	return Write(buffer, "%s", i.Name.c_str());
 }
 
-static std::string ToString_NAME_nnn(const SInstruction& i, const SContext& c)
+static std::size_t
+Format_NAME_nnn(const SInstruction& i, std::uint16_t opcode, std::uint16_t, gsl::span<char> buffer)
 {
-	std::ostringstream ss;
-	ss << i.Name << " " << std::uppercase << std::hex << std::setfill('0') << std::setw(3)
-	   << static_cast<std::uint32_t>(c.NNN());
-	return ss.str();
+	return Write(buffer, "%s %03X", i.Name.c_str(), opcode & 0x0FFFu);
 }
 
-static std::string ToString_NAME_Vx_kk(const SInstruction& i, const SContext& c)
+static std::size_t Format_NAME_Vx_kk(const SInstruction& i,
+									 std::uint16_t opcode,
+									 std::uint16_t,
+									 gsl::span<char> buffer)
 {
-	std::ostringstream ss;
-	ss << i.Name << " V" << std::uppercase << std::hex << static_cast<std::uint32_t>(c.X()) << ", "
-	   << std::uppercase << std::hex << std::setfill('0') << std::setw(2)
-	   << static_cast<std::uint32_t>(c.KK());
-	return ss.str();
+	return Write(buffer, "%s V%X, %02X", i.Name.c_str(), (opcode & 0x0F00u) >> 8, opcode & 0x00FFu);
 }
 
-static std::string ToString_NAME_Vx_Vy(const SInstruction& i, const SContext& c)
+static std::size_t Format_NAME_Vx_Vy(const SInstruction& i,
+									 std::uint16_t opcode,
+									 std::uint16_t,
+									 gsl::span<char> buffer)
 {
-	std::ostringstream ss;
-	ss << i.Name << " V" << std::uppercase << std::hex << static_cast<std::uint32_t>(c.X()) << ", V"
-	   << std::uppercase << std::hex << static_cast<std::uint32_t>(c.Y());
-	return ss.str();
+	return Write(
+		buffer, "%s V%X, V%X", i.Name.c_str(), (opcode & 0x0F00u) >> 8, (opcode & 0x00F0u) >> 4);
 }
 
-static std::string ToString_NAME_Vx(const SInstruction& i, const SContext& c)
+static std::size_t
+Format_NAME_Vx(const SInstruction& i, std::uint16_t opcode, std::uint16_t, gsl::span<char> buffer)
 {
-	std::ostringstream ss;
-	ss << i.Name << " V" << std::uppercase << std::uppercase << std::hex
-	   << static_cast<std::uint32_t>(c.X());
-	return ss.str();
+	return Write(buffer, "%s V%X", i.Name.c_str(), (opcode & 0x0F00u) >> 8);
 }
 
-static std::string
-ToString_NAME_dst_nnn(const SInstruction& i, const SContext& c, std::string_view dstName)
+static std::size_t Format_NAME_dst_nnn(const SInstruction& i,
+									   std::uint16_t opcode,
+									   std::uint16_t,
+									   gsl::span<char> buffer,
+									   const char* dstName)
 {
-	std::ostringstream ss;
-	ss << i.Name << " " << dstName << ", " << std::uppercase << std::hex << std::setfill('0')
-	   << std::setw(3) << static_cast<std::uint32_t>(c.NNN());
-	return ss.str();
+	return Write(buffer, "%s %s, %03X", i.Name.c_str(), dstName, opcode & 0x0FFFu);
 }
 
-static std::string ToString_NAME_Vx_Vy_n(const SInstruction& i, const SContext& c)
+static std::size_t Format_NAME_Vx_Vy_n(const SInstruction& i,
+									   std::uint16_t opcode,
+									   std::uint16_t,
+									   gsl::span<char> buffer)
 {
-	std::ostringstream ss;
-	ss << i.Name << " V" << std::uppercase << std::hex << static_cast<std::uint32_t>(c.X()) << ", V"
-	   << std::uppercase << std::hex << static_cast<std::uint32_t>(c.Y()) << ", " << std::uppercase
-	   << std::hex << static_cast<std::uint32_t>(c.N());
-	return ss.str();
+	return Write(buffer,
+				 "%s V%X, V%X, %X",
+				 i.Name.c_str(),
+				 (opcode & 0x0F00u) >> 8,
+				 (opcode & 0x00F0u) >> 4,
+				 opcode & 0x000Fu);
 }
 
-static std::string
-ToString_NAME_Vx_src(const SInstruction& i, const SContext& c, std::string_view srcName)
+static std::size_t Format_NAME_Vx_src(const SInstruction& i,
+									  std::uint16_t opcode,
+									  std::uint16_t,
+									  gsl::span<char> buffer,
+									  const char* srcName)
 {
-	std::ostringstream ss;
-	ss << i.Name << " V" << std::uppercase << std::uppercase << std::hex
-	   << static_cast<std::uint32_t>(c.X()) << ", " << srcName;
-	return ss.str();
+	return Write(buffer, "%s V%X, %s", i.Name.c_str(), (opcode & 0x0F00u) >> 8, srcName);
 }
 
-static std::string
-ToString_NAME_dst_Vx(const SInstruction& i, const SContext& c, std::string_view dstName)
+static std::size_t Format_NAME_dst_Vx(const SInstruction& i,
+									  std::uint16_t opcode,
+									  std::uint16_t,
+									  gsl::span<char> buffer,
+									  const char* dstName)
 {
-	std::ostringstream ss;
-	ss << i.Name << " " << dstName << ", V" << std::uppercase << std::uppercase << std::hex
-	   << static_cast<std::uint32_t>(c.X());
-	return ss.str();
+	return Write(buffer, "%s %s, V%X", i.Name.c_str(), dstName, (opcode & 0x0F00u) >> 8);
 }
 
-static std::string ToString_NAME_n(const SInstruction&, const SContext&)
+static std::size_t
+Format_NAME_n(const SInstruction& i, std::uint16_t opcode, std::uint16_t, gsl::span<char> buffer)
 {
-	throw std::runtime_error("Function not yet implemented");
+	return Write(buffer, "%s %X", i.Name.c_str(), opcode & 0x000Fu);
 }
 
 static void Handler_CLS(SContext& c)
 {
-	std::fill(c.Display.PixelBuffer.begin(), c.Display.PixelBuffer.end(), std::uint8_t(0));
+	c.Display.PixelBuffer.Fill(0);
 	c.DisplayChanged = true;
 }
 
@@ -226,13 +243,7 @@ static void Handler_JP_V0_nnn(SContext& c)
 
 static void Handler_RND_Vx_kk(SContext& c)
 {
-	static std::mt19937 gen{ std::random_device{}() };
-	static std::uniform_int_distribution<std::int32_t> dist{
-		std::numeric_limits<std::uint8_t>::min(),
-		std::numeric_limits<std::uint8_t>::max()
-	};
-
-	const std::uint8_t rnd = gsl::narrow<std::uint8_t>(dist(gen));
+	const std::uint8_t rnd = static_cast<std::uint8_t>(c.Random.Next() >> 24);
 	c.V[c.X()] = rnd & c.KK();
 }
 
@@ -245,6 +256,11 @@ static void Handler_DRW_Vx_Vy_n(SContext& c)
 	c.V[0xF] = 0; // collision flag to 0
 	if (n != 0)
 	{
+		if (c.Watchpoints != nullptr)
+		{
+			c.Watchpoints->RecordRead(c.I, n);
+		}
+
 		for (std::size_t byteIndex = 0; byteIndex < n; byteIndex++)
 		{
 			const std::uint8_t byte = c.Memory[c.I + byteIndex];
@@ -254,15 +270,12 @@ static void Handler_DRW_Vx_Vy_n(SContext& c)
 				const std::uint8_t bit = (byte >> (7 - bitIndex)) & 1;
 				const std::size_t x = (vx + bitIndex) % c.Display.Width();
 				const std::size_t y = (vy + byteIndex) % c.Display.Height();
-				std::uint8_t& pixel = c.Display.PixelBuffer[x + y * c.Display.Width()];
 
 				// collision
-				if (bit && pixel)
+				if (c.Display.PixelBuffer.Xor(x + y * c.Display.Width(), bit))
 				{
 					c.V[0xF] = 1;
 				}
-
-				pixel ^= bit;
 			}
 		}
 		c.DisplayChanged = true;
@@ -271,6 +284,11 @@ static void Handler_DRW_Vx_Vy_n(SContext& c)
 	{
 		// Draw a 16x16 sprite.
 		// Each row consists of two contiguous bytes in memory to get the 16 pixels width
+		if (c.Watchpoints != nullptr)
+		{
+			c.Watchpoints->RecordRead(c.I, 32);
+		}
+
 		for (std::size_t row = 0; row < 16; row++)
 		{
 			for (std::size_t col = 0; col < 16; col++)
@@ -282,15 +300,12 @@ static void Handler_DRW_Vx_Vy_n(SContext& c)
 				const std::uint8_t bit = (byte >> (7 - bitIndex)) & 1;
 				const std::size_t x = (vx + col) % c.Display.Width();
 				const std::size_t y = (vy + row) % c.Display.Height();
-				std::uint8_t& pixel = c.Display.PixelBuffer[x + y * c.Display.Width()];
 
 				// collision
-				if (bit && pixel)
+				if (c.Display.PixelBuffer.Xor(x + y * c.Display.Width(), bit))
 				{
 					c.V[0xF] = 1;
 				}
-
-				pixel ^= bit;
 			}
 		}
 		c.DisplayChanged = true;
@@ -317,7 +332,7 @@ static void Handler_SKNP_Vx(SContext& c)
 
 static void Handler_LD_Vx_DT(SContext& c)
 {
-	c.V[c.X()] = c.DT;
+	c.V[c.X()] = c.DT();
 }
 
 static void Handler_LD_Vx_K(SContext& c)
@@ -337,12 +352,12 @@ static void Handler_LD_Vx_K(SContext& c)
 
 static void Handler_LD_DT_Vx(SContext& c)
 {
-	c.DT = c.V[c.X()];
+	c.SetDT(c.V[c.X()]);
 }
 
 static void Handler_LD_ST_Vx(SContext& c)
 {
-	c.ST = c.V[c.X()];
+	c.SetST(c.V[c.X()]);
 }
 
 static void Handler_ADD_I_Vx(SContext& c)
@@ -368,17 +383,21 @@ static void Handler_LD_B_Vx(SContext& c)
 	const std::uint8_t tens = (vx / 10) % 10;
 	const std::uint8_t hundreds = (vx / 100) % 10;
 
-	c.Memory[c.I + std::size_t{ 0 }] = hundreds;
-	c.Memory[c.I + std::size_t{ 1 }] = tens;
-	c.Memory[c.I + std::size_t{ 2 }] = ones;
+	const std::array<std::uint8_t, 3> digits{ hundreds, tens, ones };
+	c.Memory.Write(c.I, digits);
+	if (c.Watchpoints != nullptr)
+	{
+		c.Watchpoints->RecordWrite(c.I, digits.size());
+	}
 }
 
 static void Handler_LD_derefI_Vx(SContext& c)
 {
 	const std::uint8_t x = c.X();
-	for (std::size_t i = 0; i <= x; i++)
+	c.Memory.Write(c.I, gsl::span<const std::uint8_t>(c.V.data(), x + 1));
+	if (c.Watchpoints != nullptr)
 	{
-		c.Memory[c.I + i] = c.V[i];
+		c.Watchpoints->RecordWrite(c.I, x + 1);
 	}
 }
 
@@ -389,6 +408,10 @@ static void Handler_LD_Vx_derefI(SContext& c)
 	{
 		c.V[i] = c.Memory[c.I + i];
 	}
+	if (c.Watchpoints != nullptr)
+	{
+		c.Watchpoints->RecordRead(c.I, x + 1);
+	}
 }
 
 /*** SuperChip Instructions ***/
@@ -403,19 +426,13 @@ static void Handler_SCD_n(SContext& c)
 	{
 		const std::size_t srcY = y + n;
 
-		if (srcY < displayHeight)
+		for (std::size_t x = 0; x < displayWidth; x++)
 		{
-			// copy the src row to the dst row
-			std::copy(c.Display.PixelBuffer.begin() + (srcY * displayWidth),       // src begin
-					  c.Display.PixelBuffer.begin() + ((srcY + 1) * displayWidth), // src end
-					  c.Display.PixelBuffer.begin() + (y * displayWidth));         // dst begin
-		}
-		else
-		{
-			// the src row out of bounds, so just fill the dst row with 0s
-			std::fill_n(c.Display.PixelBuffer.begin() + (y * displayWidth),
-						displayWidth,
-						std::uint8_t(0));
+			// copy the src row to the dst row, or fill it with 0s if the src row is out of bounds
+			c.Display.PixelBuffer.Set(x + y * displayWidth,
+									  srcY < displayHeight ?
+										  c.Display.PixelBuffer[x + srcY * displayWidth] :
+										  0);
 		}
 	}
 
@@ -434,8 +451,9 @@ static void Handler_SCR(SContext& c)
 		{
 			const std::size_t srcX = x + PixelsToScroll;
 			const std::size_t srcY = y;
-			c.Display.PixelBuffer[x + y * displayWidth] =
-				srcX >= displayWidth ? 0 : c.Display.PixelBuffer[srcX + srcY * displayWidth];
+			c.Display.PixelBuffer.Set(
+				x + y * displayWidth,
+				srcX >= displayWidth ? 0 : c.Display.PixelBuffer[srcX + srcY * displayWidth]);
 		}
 	}
 
@@ -454,8 +472,9 @@ static void Handler_SCL(SContext& c)
 		{
 			const std::size_t srcX = x - PixelsToScroll;
 			const std::size_t srcY = y;
-			c.Display.PixelBuffer[x + y * displayWidth] =
-				x < PixelsToScroll ? 0 : c.Display.PixelBuffer[srcX + srcY * displayWidth];
+			c.Display.PixelBuffer.Set(
+				x + y * displayWidth,
+				x < PixelsToScroll ? 0 : c.Display.PixelBuffer[srcX + srcY * displayWidth]);
 		}
 	}
 
@@ -517,114 +536,128 @@ namespace c8
 	// clang-format off
 	const std::vector<SInstruction> SInstruction::InstructionSet =
 	{
-		{ "CLS",	Handler_CLS,			0x00E0,	0xF0FF,	ToString_NAME									},
-		{ "RET",	Handler_RET,			0x00EE,	0xF0FF,	ToString_NAME									},
-		{ "JP",		Handler_JP_nnn,			0x1000,	0xF000,	ToString_NAME_nnn								},
-		{ "CALL",	Handler_CALL_nnn,		0x2000,	0xF000,	ToString_NAME_nnn								},
-		{ "SE",		Handler_SE_Vx_kk,		0x3000,	0xF000,	ToString_NAME_Vx_kk								},
-		{ "SNE",	Handler_SNE_Vx_kk,		0x4000,	0xF000,	ToString_NAME_Vx_kk								},
-		{ "SE",		Handler_SE_Vx_Vy,		0x5000,	0xF00F,	ToString_NAME_Vx_Vy								},
-		{ "LD",		Handler_LD_Vx_kk,		0x6000,	0xF000,	ToString_NAME_Vx_kk								},
-		{ "ADD",	Handler_ADD_Vx_kk,		0x7000,	0xF000,	ToString_NAME_Vx_kk								},
-		{ "LD",		Handler_LD_Vx_Vy,		0x8000,	0xF00F,	ToString_NAME_Vx_Vy								},
-		{ "OR",		Handler_OR_Vx_Vy,		0x8001,	0xF00F,	ToString_NAME_Vx_Vy								},
-		{ "AND",	Handler_AND_Vx_Vy,		0x8002,	0xF00F,	ToString_NAME_Vx_Vy								},
-		{ "XOR",	Handler_XOR_Vx_Vy,		0x8003,	0xF00F,	ToString_NAME_Vx_Vy								},
-		{ "ADD",	Handler_ADD_Vx_Vy,		0x8004,	0xF00F,	ToString_NAME_Vx_Vy								},
-		{ "SUB",	Handler_SUB_Vx_Vy,		0x8005,	0xF00F,	ToString_NAME_Vx_Vy								},
-		{ "SHR",	Handler_SHR_Vx,			0x8006,	0xF00F,	ToString_NAME_Vx								},
-		{ "SUBN",	Handler_SUBN_Vx_Vy,		0x8007,	0xF00F,	ToString_NAME_Vx_Vy								},
-		{ "SHL",	Handler_SHL_Vx,			0x800E,	0xF00F,	ToString_NAME_Vx								},
-		{ "SNE",	Handler_SNE_Vx_Vy,		0x9000,	0xF00F,	ToString_NAME_Vx_Vy								},
-		{ "LD",		Handler_LD_I_nnn,		0xA000,	0xF000,	std::bind(ToString_NAME_dst_nnn, _1, _2, "I")	},
-		{ "JP",		Handler_JP_V0_nnn,		0xB000,	0xF000,	std::bind(ToString_NAME_dst_nnn, _1, _2, "V0")	},
-		{ "RND",	Handler_RND_Vx_kk,		0xC000,	0xF000,	ToString_NAME_Vx_kk								},
-		{ "DRW",	Handler_DRW_Vx_Vy_n,	0xD000,	0xF000,	ToString_NAME_Vx_Vy_n							},
-		{ "SKP",	Handler_SKP_Vx,			0xE09E,	0xF0FF,	ToString_NAME_Vx								},
-		{ "SKNP",	Handler_SKNP_Vx,		0xE0A1,	0xF0FF,	ToString_NAME_Vx								},
-		{ "LD",		Handler_LD_Vx_DT,		0xF007,	0xF0FF,	std::bind(ToString_NAME_Vx_src, _1, _2, "DT")	},
-		{ "LD",		Handler_LD_Vx_K,		0xF00A,	0xF0FF,	std::bind(ToString_NAME_Vx_src, _1, _2, "K")	},
-		{ "LD",		Handler_LD_DT_Vx,		0xF015,	0xF0FF,	std::bind(ToString_NAME_dst_Vx, _1, _2, "DT")	},
-		{ "LD",		Handler_LD_ST_Vx,		0xF018,	0xF0FF,	std::bind(ToString_NAME_dst_Vx, _1, _2, "ST")	},
-		{ "ADD",	Handler_ADD_I_Vx,		0xF01E,	0xF0FF,	std::bind(ToString_NAME_dst_Vx, _1, _2, "I")	},
-		{ "LD",		Handler_LD_F_Vx,		0xF029,	0xF0FF,	std::bind(ToString_NAME_dst_Vx, _1, _2, "F")	},
-		{ "LD",		Handler_LD_B_Vx,		0xF033,	0xF0FF,	std::bind(ToString_NAME_dst_Vx, _1, _2, "B")	},
-		{ "LD",		Handler_LD_derefI_Vx,	0xF055,	0xF0FF,	std::bind(ToString_NAME_dst_Vx, _1, _2, "[I]")	},
-		{ "LD",		Handler_LD_Vx_derefI,	0xF065,	0xF0FF,	std::bind(ToString_NAME_Vx_src, _1, _2, "[I]")	},
+		{ "CLS",	Handler_CLS,			0x00E0,	0xF0FF,	Format_NAME												},
+		{ "RET",	Handler_RET,			0x00EE,	0xF0FF,	Format_NAME												},
+		{ "JP",		Handler_JP_nnn,			0x1000,	0xF000,	Format_NAME_nnn											},
+		{ "CALL",	Handler_CALL_nnn,		0x2000,	0xF000,	Format_NAME_nnn											},
+		{ "SE",		Handler_SE_Vx_kk,		0x3000,	0xF000,	Format_NAME_Vx_kk										},
+		{ "SNE",	Handler_SNE_Vx_kk,		0x4000,	0xF000,	Format_NAME_Vx_kk										},
+		{ "SE",		Handler_SE_Vx_Vy,		0x5000,	0xF00F,	Format_NAME_Vx_Vy										},
+		{ "LD",		Handler_LD_Vx_kk,		0x6000,	0xF000,	Format_NAME_Vx_kk										},
+		{ "ADD",	Handler_ADD_Vx_kk,		0x7000,	0xF000,	Format_NAME_Vx_kk										},
+		{ "LD",		Handler_LD_Vx_Vy,		0x8000,	0xF00F,	Format_NAME_Vx_Vy										},
+		{ "OR",		Handler_OR_Vx_Vy,		0x8001,	0xF00F,	Format_NAME_Vx_Vy										},
+		{ "AND",	Handler_AND_Vx_Vy,		0x8002,	0xF00F,	Format_NAME_Vx_Vy										},
+		{ "XOR",	Handler_XOR_Vx_Vy,		0x8003,	0xF00F,	Format_NAME_Vx_Vy										},
+		{ "ADD",	Handler_ADD_Vx_Vy,		0x8004,	0xF00F,	Format_NAME_Vx_Vy										},
+		{ "SUB",	Handler_SUB_Vx_Vy,		0x8005,	0xF00F,	Format_NAME_Vx_Vy										},
+		{ "SHR",	Handler_SHR_Vx,			0x8006,	0xF00F,	Format_NAME_Vx											},
+		{ "SUBN",	Handler_SUBN_Vx_Vy,		0x8007,	0xF00F,	Format_NAME_Vx_Vy										},
+		{ "SHL",	Handler_SHL_Vx,			0x800E,	0xF00F,	Format_NAME_Vx											},
+		{ "SNE",	Handler_SNE_Vx_Vy,		0x9000,	0xF00F,	Format_NAME_Vx_Vy										},
+		{ "LD",		Handler_LD_I_nnn,		0xA000,	0xF000,	std::bind(Format_NAME_dst_nnn, _1, _2, _3, _4, "I")		},
+		{ "JP",		Handler_JP_V0_nnn,		0xB000,	0xF000,	std::bind(Format_NAME_dst_nnn, _1, _2, _3, _4, "V0")	},
+		{ "RND",	Handler_RND_Vx_kk,		0xC000,	0xF000,	Format_NAME_Vx_kk										},
+		{ "DRW",	Handler_DRW_Vx_Vy_n,	0xD000,	0xF000,	Format_NAME_Vx_Vy_n										},
+		{ "SKP",	Handler_SKP_Vx,			0xE09E,	0xF0FF,	Format_NAME_Vx											},
+		{ "SKNP",	Handler_SKNP_Vx,		0xE0A1,	0xF0FF,	Format_NAME_Vx											},
+		{ "LD",		Handler_LD_Vx_DT,		0xF007,	0xF0FF,	std::bind(Format_NAME_Vx_src, _1, _2, _3, _4, "DT")		},
+		{ "LD",		Handler_LD_Vx_K,		0xF00A,	0xF0FF,	std::bind(Format_NAME_Vx_src, _1, _2, _3, _4, "K")		},
+		{ "LD",		Handler_LD_DT_Vx,		0xF015,	0xF0FF,	std::bind(Format_NAME_dst_Vx, _1, _2, _3, _4, "DT")		},
+		{ "LD",		Handler_LD_ST_Vx,		0xF018,	0xF0FF,	std::bind(Format_NAME_dst_Vx, _1, _2, _3, _4, "ST")		},
+		{ "ADD",	Handler_ADD_I_Vx,		0xF01E,	0xF0FF,	std::bind(Format_NAME_dst_Vx, _1, _2, _3, _4, "I")		},
+		{ "LD",		Handler_LD_F_Vx,		0xF029,	0xF0FF,	std::bind(Format_NAME_dst_Vx, _1, _2, _3, _4, "F")		},
+		{ "LD",		Handler_LD_B_Vx,		0xF033,	0xF0FF,	std::bind(Format_NAME_dst_Vx, _1, _2, _3, _4, "B")		},
+		{ "LD",		Handler_LD_derefI_Vx,	0xF055,	0xF0FF,	std::bind(Format_NAME_dst_Vx, _1, _2, _3, _4, "[I]")	},
+		{ "LD",		Handler_LD_Vx_derefI,	0xF065,	0xF0FF,	std::bind(Format_NAME_Vx_src, _1, _2, _3, _4, "[I]")	},
 
 		// SuperChip
-		{ "SCD",	Handler_SCD_n,			0x00C0,	0xFFF0,	ToString_NAME_n									},
-		{ "SCR",	Handler_SCR,			0x00FB,	0xFFFF,	ToString_NAME									},
-		{ "SCL",	Handler_SCL,			0x00FC,	0xFFFF,	ToString_NAME									},
-		{ "EXIT",	Handler_EXIT,			0x00FD,	0xFFFF,	ToString_NAME									},
-		{ "LOW",	Handler_LOW,			0x00FE,	0xFFFF,	ToString_NAME									},
-		{ "HIGH",	Handler_HIGH,			0x00FF,	0xFFFF,	ToString_NAME									},
-		{ "LD",		Handler_LD_HF_Vx,		0xF030,	0xF0FF,	std::bind(ToString_NAME_dst_Vx, _1, _2, "HF")	},
-		{ "LD",		Handler_LD_R_Vx,		0xF075,	0xF0FF,	std::bind(ToString_NAME_dst_Vx, _1, _2, "R")	},
-		{ "LD",		Handler_LD_Vx_R,		0xF085,	0xF0FF,	std::bind(ToString_NAME_Vx_src, _1, _2, "R")	},
+		{ "SCD",	Handler_SCD_n,			0x00C0,	0xFFF0,	Format_NAME_n											},
+		{ "SCR",	Handler_SCR,			0x00FB,	0xFFFF,	Format_NAME												},
+		{ "SCL",	Handler_SCL,			0x00FC,	0xFFFF,	Format_NAME												},
+		{ "EXIT",	Handler_EXIT,			0x00FD,	0xFFFF,	Format_NAME												},
+		{ "LOW",	Handler_LOW,			0x00FE,	0xFFFF,	Format_NAME												},
+		{ "HIGH",	Handler_HIGH,			0x00FF,	0xFFFF,	Format_NAME												},
+		{ "LD",		Handler_LD_HF_Vx,		0xF030,	0xF0FF,	std::bind(Format_NAME_dst_Vx, _1, _2, _3, _4, "HF")		},
+		{ "LD",		Handler_LD_R_Vx,		0xF075,	0xF0FF,	std::bind(Format_NAME_dst_Vx, _1, _2, _3, _4, "R")		},
+		{ "LD",		Handler_LD_Vx_R,		0xF085,	0xF0FF,	std::bind(Format_NAME_Vx_src, _1, _2, _3, _4, "R")		},
 	};
 	// clang-format on
 }
 
-TEST_CASE("Instruction ToString")
+TEST_CASE("Instruction Format")
 {
 	SInstruction i{ "A",
 					[](SContext&) {},
 					0x0000,
 					0x0000,
-					[](const SInstruction&, const SContext&) {
-						return std::string{};
+					[](const SInstruction&, std::uint16_t, std::uint16_t, gsl::span<char>) {
+						return std::size_t{ 0 };
 					} };
-	SContext c{};
+	std::array<char, SInstruction::MaxFormattedSize> buffer{};
+	auto text = [&buffer](std::size_t length) { return std::string(buffer.data(), length); };
 
-	SUBCASE("NAME") { CHECK(ToString_NAME(i, c) == "A"); }
+	SUBCASE("NAME") { CHECK(text(Format_NAME(i, 0x0000, 0x200, buffer)) == "A"); }
 
-	SUBCASE("NAME nnn")
-	{
-		c.IR = 0x0012;
-		CHECK(ToString_NAME_nnn(i, c) == "A 012");
-	}
+	SUBCASE("NAME nnn") { CHECK(text(Format_NAME_nnn(i, 0x0012, 0x200, buffer)) == "A 012"); }
 
 	SUBCASE("NAME Vx, kk")
 	{
-		c.IR = 0x0123;
-		CHECK(ToString_NAME_Vx_kk(i, c) == "A V1, 23");
+		CHECK(text(Format_NAME_Vx_kk(i, 0x0123, 0x200, buffer)) == "A V1, 23");
 	}
 
 	SUBCASE("NAME Vx, Vy")
 	{
-		c.IR = 0x0120;
-		CHECK(ToString_NAME_Vx_Vy(i, c) == "A V1, V2");
+		CHECK(text(Format_NAME_Vx_Vy(i, 0x0120, 0x200, buffer)) == "A V1, V2");
 	}
 
-	SUBCASE("NAME Vx")
-	{
-		c.IR = 0x0100;
-		CHECK(ToString_NAME_Vx(i, c) == "A V1");
-	}
+	SUBCASE("NAME Vx") { CHECK(text(Format_NAME_Vx(i, 0x0100, 0x200, buffer)) == "A V1"); }
 
 	SUBCASE("NAME dst, nnn")
 	{
-		c.IR = 0x0012;
-		CHECK(ToString_NAME_dst_nnn(i, c, "D") == "A D, 012");
+		CHECK(text(Format_NAME_dst_nnn(i, 0x0012, 0x200, buffer, "D")) == "A D, 012");
 	}
 
 	SUBCASE("NAME Vx, Vy, n")
 	{
-		c.IR = 0x0123;
-		CHECK(ToString_NAME_Vx_Vy_n(i, c) == "A V1, V2, 3");
+		CHECK(text(Format_NAME_Vx_Vy_n(i, 0x0123, 0x200, buffer)) == "A V1, V2, 3");
 	}
 
 	SUBCASE("NAME Vx, src")
 	{
-		c.IR = 0x0100;
-		CHECK(ToString_NAME_Vx_src(i, c, "S") == "A V1, S");
+		CHECK(text(Format_NAME_Vx_src(i, 0x0100, 0x200, buffer, "S")) == "A V1, S");
 	}
 
 	SUBCASE("NAME dst, Vx")
 	{
-		c.IR = 0x0100;
-		CHECK(ToString_NAME_dst_Vx(i, c, "D") == "A D, V1");
+		CHECK(text(Format_NAME_dst_Vx(i, 0x0100, 0x200, buffer, "D")) == "A D, V1");
+	}
+
+	SUBCASE("NAME n") { CHECK(text(Format_NAME_n(i, 0x00CA, 0x200, buffer)) == "A A"); }
+
+	SUBCASE("Truncated")
+	{
+		std::array<char, 4> small{};
+		CHECK_EQ(Format_NAME_Vx_kk(i, 0x0123, 0x200, small), 3u);
+		CHECK_EQ(std::string(small.data()), "A V");
+	}
+
+	SUBCASE("Instruction set")
+	{
+		// every opcode fits in the buffer
+		for (std::uint32_t opcode = 0; opcode <= 0xFFFF; opcode += 0x11)
+		{
+			auto instruction = c8::CInterpreter::TryFindInstruction(opcode);
+			if (instruction.has_value())
+			{
+				const SInstruction& inst = instruction->get();
+				const std::size_t length = inst.Format(inst, opcode, 0x200, buffer);
+				CHECK_LT(length, buffer.size() - 1);
+				CHECK_EQ(length, std::char_traits<char>::length(buffer.data()));
+			}
+		}
+		const SInstruction& scd = c8::CInterpreter::FindInstruction(0x00C4);
+		CHECK(text(scd.Format(scd, 0x00C4, 0x200, buffer)) == "SCD 4");
 	}
 }
 
@@ -633,7 +666,7 @@ TEST_SUITE_BEGIN("Instruction set");
 TEST_CASE("Instruction: CLS")
 {
 	SContext c{};
-	std::fill(c.Display.PixelBuffer.begin(), c.Display.PixelBuffer.end(), std::uint8_t{ 1 });
+	c.Display.PixelBuffer.Fill(1);
 
 	Handler_CLS(c);
 
@@ -919,6 +952,18 @@ TEST_CASE("Instruction: ADD Vx, Vy")
 		CHECK_EQ(c.V[2], 0xF0);
 		CHECK_EQ(c.V[0xF], 1);
 	}
+
+	SUBCASE("Vx is VF")
+	{
+		// the flag is written first and then overwritten by the result
+		c.V[0xF] = 0xFF;
+		c.V[1] = 0x01;
+		c.IR = 0x0F10;
+
+		Handler_ADD_Vx_Vy(c);
+
+		CHECK_EQ(c.V[0xF], 0x02);
+	}
 }
 
 TEST_CASE("Instruction: SUB Vx, Vy")
@@ -963,6 +1008,29 @@ TEST_CASE("Instruction: SUB Vx, Vy")
 		CHECK_EQ(c.V[2], 0x10);
 		CHECK_EQ(c.V[0xF], 0);
 	}
+
+	SUBCASE("Vx is VF")
+	{
+		c.V[0xF] = 0x05;
+		c.V[1] = 0x03;
+		c.IR = 0x0F10;
+
+		Handler_SUB_Vx_Vy(c);
+
+		CHECK_EQ(c.V[0xF], 0xFE);
+	}
+
+	SUBCASE("Vy is VF")
+	{
+		c.V[1] = 0x05;
+		c.V[0xF] = 0x03;
+		c.IR = 0x01F0;
+
+		Handler_SUB_Vx_Vy(c);
+
+		CHECK_EQ(c.V[1], 0x02);
+		CHECK_EQ(c.V[0xF], 1);
+	}
 }
 
 TEST_CASE("Instruction: SHR Vx")
@@ -990,6 +1058,16 @@ TEST_CASE("Instruction: SHR Vx")
 		CHECK_EQ(c.V[1], 0x08);
 		CHECK_EQ(c.V[0xF], 1);
 	}
+
+	SUBCASE("Vx is VF")
+	{
+		c.V[0xF] = 0x03;
+		c.IR = 0x0F00;
+
+		Handler_SHR_Vx(c);
+
+		CHECK_EQ(c.V[0xF], 0x00);
+	}
 }
 
 TEST_CASE("Instruction: SUBN Vx, Vy")
@@ -1034,6 +1112,17 @@ TEST_CASE("Instruction: SUBN Vx, Vy")
 		CHECK_EQ(c.V[2], 0x10);
 		CHECK_EQ(c.V[0xF], 0);
 	}
+
+	SUBCASE("Vx is VF")
+	{
+		c.V[0xF] = 0x03;
+		c.V[1] = 0x05;
+		c.IR = 0x0F10;
+
+		Handler_SUBN_Vx_Vy(c);
+
+		CHECK_EQ(c.V[0xF], 0x04);
+	}
 }
 
 TEST_CASE("Instruction: SHL Vx")
@@ -1061,6 +1150,16 @@ TEST_CASE("Instruction: SHL Vx")
 		CHECK_EQ(c.V[1], 0x20);
 		CHECK_EQ(c.V[0xF], 1);
 	}
+
+	SUBCASE("Vx is VF")
+	{
+		c.V[0xF] = 0x90;
+		c.IR = 0x0F00;
+
+		Handler_SHL_Vx(c);
+
+		CHECK_EQ(c.V[0xF], 0x02);
+	}
 }
 
 TEST_CASE("Instruction: SNE Vx, Vy")
@@ -1136,6 +1235,19 @@ TEST_CASE("Instruction: RND Vx, kk")
 		// check that all bits not set in `kk` are 0 in `Vx`
 		CHECK_EQ(c.V[1] & kkInv, 0);
 	}
+
+	// check that the generated values only depend on the context
+	SContext other{};
+	other.IR = c.IR;
+	c.Random.Seed(7);
+	other.Random.Seed(7);
+	for (std::size_t i = 0; i < N; i++)
+	{
+		Handler_RND_Vx_kk(c);
+		Handler_RND_Vx_kk(other);
+
+		CHECK_EQ(c.V[1], other.V[1]);
+	}
 }
 
 TEST_CASE("Instruction: DRW Vx, Vy, n")
@@ -1165,7 +1277,7 @@ TEST_CASE("Instruction: DRW Vx, Vy, n")
 		0b01110000,
 	};
 	// clang-format on
-	std::copy(InputSprite.begin(), InputSprite.end(), c.Memory.begin() + c.I);
+	c.Memory.Write(c.I, InputSprite);
 
 	SUBCASE("Single draw")
 	{
@@ -1293,7 +1405,7 @@ TEST_CASE("Instruction: DRW Vx, Vy, n")
 		0b01110000, 0b00001110,
 	};
 	// clang-format on
-	std::copy(ExtendedInputSprite.begin(), ExtendedInputSprite.end(), c.Memory.begin() + c.I);
+	c.Memory.Write(c.I, ExtendedInputSprite);
 	c.IR = 0x0120;
 
 	SUBCASE("Single draw (extended mode, 16x16 sprite)")
@@ -1360,6 +1472,26 @@ TEST_CASE("Instruction: DRW Vx, Vy, n")
 		CHECK(c.DisplayChanged);
 		CHECK_EQ(c.V[0xF], 1);
 	}
+
+	SUBCASE("Sprite wraps around the end of memory")
+	{
+		c.I = 0xFFF;
+		c.IR = 0x0122;
+		c.Memory.Write(0xFFF, 0xFF);
+		c.Memory.Write(0x000, 0x81);
+
+		Handler_DRW_Vx_Vy_n(c);
+
+		auto pixel = [&c](std::size_t x, std::size_t y) {
+			return c.Display.PixelBuffer[x + y * c.Display.Width()];
+		};
+		for (std::size_t x = 0; x < 8; x++)
+		{
+			CHECK_EQ(pixel(X2 + x, Y2), 1);
+			CHECK_EQ(pixel(X2 + x, Y2 + 1), x == 0 || x == 7);
+		}
+		CHECK_EQ(c.V[0xF], 0);
+	}
 }
 
 TEST_CASE("Instruction: SKP Vx")
@@ -1425,13 +1557,13 @@ TEST_CASE("Instruction: LD Vx, DT")
 	SContext c{};
 
 	c.V[1] = 0;
-	c.DT = 0x12;
+	c.SetDT(0x12);
 	c.IR = 0x0100;
 
 	Handler_LD_Vx_DT(c);
 
 	CHECK_EQ(c.V[1], 0x12);
-	CHECK_EQ(c.DT, 0x12);
+	CHECK_EQ(c.DT(), 0x12);
 }
 
 TEST_CASE("Instruction: LD Vx, K")
@@ -1471,13 +1603,13 @@ TEST_CASE("Instruction: LD DT, Vx")
 	SContext c{};
 
 	c.V[1] = 0x12;
-	c.DT = 0;
+	c.SetDT(0);
 	c.IR = 0x0100;
 
 	Handler_LD_DT_Vx(c);
 
 	CHECK_EQ(c.V[1], 0x12);
-	CHECK_EQ(c.DT, 0x12);
+	CHECK_EQ(c.DT(), 0x12);
 }
 
 TEST_CASE("Instruction: LD ST, Vx")
@@ -1485,13 +1617,13 @@ TEST_CASE("Instruction: LD ST, Vx")
 	SContext c{};
 
 	c.V[1] = 0x12;
-	c.ST = 0;
+	c.SetST(0);
 	c.IR = 0x0100;
 
 	Handler_LD_ST_Vx(c);
 
 	CHECK_EQ(c.V[1], 0x12);
-	CHECK_EQ(c.ST, 0x12);
+	CHECK_EQ(c.ST(), 0x12);
 }
 
 TEST_CASE("Instruction: ADD I, Vx")
@@ -1506,6 +1638,26 @@ TEST_CASE("Instruction: ADD I, Vx")
 
 	CHECK_EQ(c.V[1], 0x20);
 	CHECK_EQ(c.I, 0x30);
+	CHECK_EQ(c.V[0xF], 0);
+
+	// VF is set when I + Vx is over 0xFF, here with VF itself as Vx
+	c.V[0xF] = 0xF0;
+	c.I = 0x0020;
+	c.IR = 0x0F00;
+
+	Handler_ADD_I_Vx(c);
+
+	CHECK_EQ(c.V[0xF], 1);
+	CHECK_EQ(c.I, 0x0110);
+
+	// no carry when the sum fits in a byte
+	c.V[0xF] = 0x0F;
+	c.I = 0x00F0;
+
+	Handler_ADD_I_Vx(c);
+
+	CHECK_EQ(c.V[0xF], 0);
+	CHECK_EQ(c.I, 0x00FF);
 }
 
 TEST_CASE("Instruction: LD F, Vx")
@@ -1547,9 +1699,9 @@ TEST_CASE("Instruction: LD B, Vx")
 {
 	SContext c{};
 	c.I = 0x400;
-	c.Memory[c.I + 0] = 0;
-	c.Memory[c.I + 1] = 0;
-	c.Memory[c.I + 2] = 0;
+	c.Memory.Write(c.I + 0, 0);
+	c.Memory.Write(c.I + 1, 0);
+	c.Memory.Write(c.I + 2, 0);
 	c.IR = 0x0100;
 
 	SUBCASE("No digits")
@@ -1681,7 +1833,7 @@ TEST_CASE("Instruction: LD Vx, [I]")
 			0x10, 0xCD, 0xCD, 0xCD, 0xCD, 0xCD, 0xCD, 0xCD,
 			0xCD, 0xCD, 0xCD, 0xCD, 0xCD, 0xCD, 0xCD, 0xCD,
 		};
-		std::copy(InputValues.begin(), InputValues.end(), c.Memory.begin() + c.I);
+		c.Memory.Write(c.I, InputValues);
 		c.IR = 0x0000;
 
 		Handler_LD_Vx_derefI(c);
@@ -1699,7 +1851,7 @@ TEST_CASE("Instruction: LD Vx, [I]")
 			0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80,
 			0xCD, 0xCD, 0xCD, 0xCD, 0xCD, 0xCD, 0xCD, 0xCD,
 		};
-		std::copy(InputValues.begin(), InputValues.end(), c.Memory.begin() + c.I);
+		c.Memory.Write(c.I, InputValues);
 		c.IR = 0x0700;
 
 		Handler_LD_Vx_derefI(c);
@@ -1717,7 +1869,7 @@ TEST_CASE("Instruction: LD Vx, [I]")
 			0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80,
 			0x90, 0xA0, 0xB0, 0xC0, 0xD0, 0xE0, 0xF0, 0xFF,
 		};
-		std::copy(InputValues.begin(), InputValues.end(), c.Memory.begin() + c.I);
+		c.Memory.Write(c.I, InputValues);
 		c.IR = 0x0F00;
 
 		Handler_LD_Vx_derefI(c);
@@ -1728,6 +1880,19 @@ TEST_CASE("Instruction: LD Vx, [I]")
 		};
 		CHECK(std::equal(ExpectedValues.begin(), ExpectedValues.end(), c.V.begin()));
 	}
+
+	SUBCASE("Wrap around")
+	{
+		c.I = 0xFFF;
+		c.Memory.Write(0xFFF, 0x12);
+		c.Memory.Write(0x000, 0x34);
+		c.IR = 0x0100;
+
+		Handler_LD_Vx_derefI(c);
+
+		CHECK_EQ(c.V[0], 0x12);
+		CHECK_EQ(c.V[1], 0x34);
+	}
 }
 
 TEST_CASE("Instruction: SCD n")
@@ -1757,7 +1922,7 @@ TEST_CASE("Instruction: SCD n")
 			0b01110000,
 		};
 		// clang-format on
-		std::copy(InputSprite.begin(), InputSprite.end(), c.Memory.begin() + c.I);
+		c.Memory.Write(c.I, InputSprite);
 		Handler_DRW_Vx_Vy_n(c);
 	}
 
@@ -1977,7 +2142,7 @@ TEST_CASE("Instruction: SCR")
 			0b01110000,
 		};
 		// clang-format on
-		std::copy(InputSprite.begin(), InputSprite.end(), c.Memory.begin() + c.I);
+		c.Memory.Write(c.I, InputSprite);
 		Handler_DRW_Vx_Vy_n(c);
 	}
 
@@ -2140,7 +2305,7 @@ TEST_CASE("Instruction: SCL")
 			0b01110000,
 		};
 		// clang-format on
-		std::copy(InputSprite.begin(), InputSprite.end(), c.Memory.begin() + c.I);
+		c.Memory.Write(c.I, InputSprite);
 		Handler_DRW_Vx_Vy_n(c);
 	}
 
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <functional>
+#include <gsl/span>
 #include <string>
 #include <vector>
 
@@ -10,7 +11,10 @@ namespace c8
 	struct SInstruction;
 
 	using FInstructionHandler = std::function<void(SContext&)>;
-	using FInstructionToString = std::function<std::string(const SInstruction&, const SContext&)>;
+	/// Writes the disassembly of the opcode at the address into the buffer, null-terminated and
+	/// truncated if it does not fit. Returns the number of characters written, without the null.
+	using FInstructionFormat = std::function<std::size_t(
+		const SInstruction&, std::uint16_t opcode, std::uint16_t address, gsl::span<char> buffer)>;
 
 	struct SInstruction
 	{
@@ -18,8 +22,9 @@ namespace c8
 		FInstructionHandler Handler;
 		std::uint16_t Opcode;
 		std::uint16_t OpcodeMask;
-		FInstructionToString ToString;
+		FInstructionFormat Format;
 
+		static constexpr std::size_t MaxFormattedSize{ 32 }; // Fits any instruction formatted
 		static const std::vector<SInstruction> InstructionSet;
 	};
 }
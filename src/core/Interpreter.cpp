@@ -1,10 +1,17 @@
 #include "Interpreter.h"
+#include "Trace.h"
 #include <algorithm>
+#include <doctest/doctest.h>
 #include <fstream>
+#include <gsl/gsl_assert>
+#include <gsl/gsl_util>
 #include <iostream>
 #include <iterator>
 #include <random>
 #include <sstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -13,41 +20,519 @@ namespace c8
 	using namespace constants;
 
 	CInterpreter::CInterpreter(const std::shared_ptr<IPlatform>& platform)
-		: mPlatform{ platform }, mContext{}, mPaused{ false }
+		: mPlatform{ platform },
+		  mContext{},
+		  mPaused{ false },
+		  mHistory{},
+		  mReplaying{ false },
+		  mProgramHash{ 0 },
+		  mRandomSeed{ std::random_device{}() },
+		  mFrameCycle{ 0 },
+		  mProfiler{},
+		  mHeatmap{},
+		  mExecutionTrace{},
+		  mRegionMap{},
+		  mIdleSkip{ false },
+		  mIdleDetector{},
+		  mIdlePeriod{ 0 },
+		  mIdle{ false },
+		  mIdleKeyboard{ 0 },
+		  mIdleSkippedCycles{ 0 },
+		  mBreakpoints{},
+		  mBreakpointHit{},
+		  mResuming{ false },
+		  mWatchpoints{ std::make_unique<CWatchpoints>() },
+		  mWatchpointHit{},
+		  mWatchpointHitPending{ false }
 	{
+		mContext.Random.Seed(mRandomSeed);
+		AttachWatchpoints();
 	}
 
-	void CInterpreter::Pause(bool pause) { mPaused = pause; }
+	CInterpreter::CInterpreter(const std::shared_ptr<IPlatform>& platform,
+							   const SContext& context,
+							   std::uint32_t randomSeed)
+		: mPlatform{ platform },
+		  mContext{ context },
+		  mPaused{ false },
+		  mHistory{},
+		  mReplaying{ false },
+		  mProgramHash{ 0 },
+		  mRandomSeed{ randomSeed },
+		  mFrameCycle{ 0 },
+		  mProfiler{},
+		  mHeatmap{},
+		  mExecutionTrace{},
+		  mRegionMap{},
+		  mIdleSkip{ false },
+		  mIdleDetector{},
+		  mIdlePeriod{ 0 },
+		  mIdle{ false },
+		  mIdleKeyboard{ 0 },
+		  mIdleSkippedCycles{ 0 },
+		  mBreakpoints{},
+		  mBreakpointHit{},
+		  mResuming{ false },
+		  mWatchpoints{ std::make_unique<CWatchpoints>() },
+		  mWatchpointHit{},
+		  mWatchpointHitPending{ false }
+	{
+		// the watchpoints of the interpreter the context comes from are not shared
+		AttachWatchpoints();
+	}
+
+	CInterpreter CInterpreter::Fork() const
+	{
+		CInterpreter fork{ mPlatform, mContext, mRandomSeed };
+		fork.mLastCycleTime = mLastCycleTime;
+		fork.mLastTimerTickTime = mLastTimerTickTime;
+		fork.mPaused = mPaused;
+		fork.mProgramHash = mProgramHash;
+		fork.mFrameCycle = mFrameCycle;
+		fork.mIdleSkip = mIdleSkip;
+		return fork;
+	}
+
+	void CInterpreter::Pause(bool pause)
+	{
+		// continuing from a breakpoint executes it instead of stopping there again
+		mResuming = mResuming || (mPaused && !pause);
+		mPaused = pause;
+	}
 
-	void CInterpreter::Update()
+	SUpdateResult CInterpreter::Update()
 	{
 		if (!IsPaused())
 		{
-			Step();
+			return DoStep(true);
 		}
+
+		return {};
 	}
 
-	void CInterpreter::Step()
+	SUpdateResult CInterpreter::Step() { return DoStep(false); }
+
+	SUpdateResult CInterpreter::DoStep(bool checkBreakpoints)
 	{
+		SUpdateResult result{};
 		if (mContext.Exited)
 		{
-			return;
+			return result;
 		}
 
 		mPlatform->GetKeyboardState(mContext.Keyboard);
+		CheckIdleKeyboard();
 
 		const auto now = Clock::now();
 
 		if ((now - mLastCycleTime) >= CyclesRate)
 		{
-			DoCycle();
+			if (checkBreakpoints && !mBreakpoints.IsEmpty())
+			{
+				if (StopsAtBreakpoint())
+				{
+					return result;
+				}
+			}
+			else
+			{
+				mResuming = false;
+			}
+
+			if (mIdle && IsIdleSkipActive())
+			{
+				// the caller may have slept until the next timer tick, skipping many cycles
+				mIdleSkippedCycles += (now - mLastCycleTime) / CyclesRate;
+			}
+			else
+			{
+				CTraceScope trace{ "CInterpreter::DoCycle" };
+				DoCycle();
+				StopsAtWatchpoint();
+				result.Cycle = true;
+				mIdle = mIdlePeriod != 0;
+				mIdlePeriod = 0;
+			}
 			mLastCycleTime = now;
 		}
 
 		if ((now - mLastTimerTickTime) >= TimersRate)
 		{
+			CTraceScope trace{ "CInterpreter::DoTimerTick" };
 			DoTimerTick();
 			mLastTimerTickTime = now;
+			result.TimerTick = true;
+		}
+
+		result.Idle = mIdle && IsIdleSkipActive();
+		return result;
+	}
+
+	bool CInterpreter::RunFrame(const SKeyboardState& keyboard)
+	{
+		if (mContext.Exited)
+		{
+			return true;
+		}
+
+		CTraceScope trace{ "CInterpreter::RunFrame" };
+		mContext.Keyboard = keyboard;
+		CheckIdleKeyboard();
+
+		// checked once, a breakpoint or watchpoint hit ends the loop
+		const bool checkBreakpoints = !mBreakpoints.IsEmpty();
+		const bool checkWatchpoints = mContext.Watchpoints != nullptr;
+		mResuming = mResuming && checkBreakpoints;
+		while (mFrameCycle < CyclesPerFrame)
+		{
+			if (checkBreakpoints && StopsAtBreakpoint())
+			{
+				return false;
+			}
+
+			DoCycle();
+			mFrameCycle++;
+			if (mIdlePeriod != 0)
+			{
+				mFrameCycle +=
+					static_cast<std::uint32_t>(SkipIdleCycles(CyclesPerFrame - mFrameCycle));
+			}
+
+			// a hit in the last cycle still completes the frame
+			if (checkWatchpoints && StopsAtWatchpoint() && mFrameCycle != CyclesPerFrame)
+			{
+				return false;
+			}
+		}
+
+		DoTimerTick();
+		mFrameCycle = 0;
+		return true;
+	}
+
+	std::uint64_t CInterpreter::RunCycles(std::uint64_t count)
+	{
+		CTraceScope trace{ "CInterpreter::RunCycles" };
+		const bool checkBreakpoints = !mBreakpoints.IsEmpty();
+		const bool checkWatchpoints = mContext.Watchpoints != nullptr;
+		mResuming = mResuming && checkBreakpoints;
+		std::uint64_t executed = 0;
+		for (; executed < count && !mContext.Exited; executed++)
+		{
+			if (mFrameCycle == 0)
+			{
+				mPlatform->GetKeyboardState(mContext.Keyboard);
+				CheckIdleKeyboard();
+			}
+
+			if (checkBreakpoints && StopsAtBreakpoint())
+			{
+				break;
+			}
+
+			DoCycle();
+			if (mIdlePeriod != 0)
+			{
+				const std::uint64_t frameRemaining = CyclesPerFrame - 1 - mFrameCycle;
+				const std::uint64_t skipped =
+					SkipIdleCycles(std::min(frameRemaining, count - 1 - executed));
+				mFrameCycle += static_cast<std::uint32_t>(skipped);
+				executed += skipped;
+			}
+
+			if (++mFrameCycle == CyclesPerFrame)
+			{
+				DoTimerTick();
+				mFrameCycle = 0;
+			}
+
+			if (checkWatchpoints && StopsAtWatchpoint())
+			{
+				executed++;
+				break;
+			}
+		}
+		return executed;
+	}
+
+	bool CInterpreter::StopsAtBreakpoint()
+	{
+		if (std::exchange(mResuming, false) || !mBreakpoints.Has(mContext.PC) ||
+			!mBreakpoints.ShouldStop(mContext))
+		{
+			return false;
+		}
+
+		// calling RunFrame or RunCycles again also resumes
+		mResuming = true;
+		mPaused = true;
+		if (mBreakpointHit)
+		{
+			mBreakpointHit(mContext.PC);
+		}
+		return true;
+	}
+
+	bool CInterpreter::StopsAtWatchpoint()
+	{
+		if (!std::exchange(mWatchpointHitPending, false))
+		{
+			return false;
+		}
+
+		mPaused = true;
+		if (mBreakpointHit)
+		{
+			mBreakpointHit(mWatchpointHit->PC);
+		}
+		return true;
+	}
+
+	void CInterpreter::AddWatchpoint(std::uint16_t address, std::uint16_t size, EWatchAccess access)
+	{
+		mWatchpoints->Add(address, size, access);
+		AttachWatchpoints();
+	}
+
+	void CInterpreter::RemoveWatchpoints(std::uint16_t address)
+	{
+		mWatchpoints->Remove(address);
+		AttachWatchpoints();
+	}
+
+	void CInterpreter::ClearWatchpoints()
+	{
+		mWatchpoints->Clear();
+		mWatchpointHit.reset();
+		mWatchpointHitPending = false;
+		AttachWatchpoints();
+	}
+
+	void CInterpreter::AttachWatchpoints()
+	{
+		mContext.Watchpoints = mWatchpoints->IsEmpty() ? nullptr : mWatchpoints.get();
+	}
+
+	void CInterpreter::SetRandomSeed(std::uint32_t seed)
+	{
+		mRandomSeed = seed;
+		mContext.Random.Seed(seed);
+	}
+
+	void CInterpreter::EnableHistory(bool enable)
+	{
+		if (enable)
+		{
+			mHistory.emplace(mContext);
+		}
+		else
+		{
+			mHistory.reset();
+		}
+	}
+
+	void CInterpreter::EnableHeatmap(bool enable)
+	{
+		if (enable)
+		{
+			if (!mHeatmap)
+			{
+				mHeatmap = std::make_unique<CHeatmap>();
+			}
+		}
+		else
+		{
+			mHeatmap.reset();
+		}
+	}
+
+	void CInterpreter::ResetHeatmap()
+	{
+		if (mHeatmap)
+		{
+			mHeatmap->Reset();
+		}
+	}
+
+	void CInterpreter::EnableExecutionTrace(bool enable)
+	{
+		if (enable)
+		{
+			if (!mExecutionTrace)
+			{
+				mExecutionTrace = std::make_unique<CExecutionTrace>(mContext);
+			}
+		}
+		else
+		{
+			mExecutionTrace.reset();
+		}
+	}
+
+	void CInterpreter::ClearExecutionTrace()
+	{
+		if (mExecutionTrace)
+		{
+			mExecutionTrace->Clear(mContext);
+		}
+	}
+
+	void CInterpreter::EnableRegionMap(bool enable)
+	{
+		if (enable)
+		{
+			if (!mRegionMap)
+			{
+				mRegionMap = std::make_unique<CRegionMap>(mContext.Memory);
+			}
+		}
+		else
+		{
+			mRegionMap.reset();
+		}
+	}
+
+	void CInterpreter::ResetRegionMap()
+	{
+		if (mRegionMap)
+		{
+			mRegionMap->Reset(mContext.Memory);
+		}
+	}
+
+	void CInterpreter::EnableIdleSkip(bool enable)
+	{
+		mIdleSkip = enable;
+		ResetIdle();
+	}
+
+	bool CInterpreter::CanStepBack() const
+	{
+		return mHistory.has_value() &&
+			   mHistory->FindPreviousCycle(mHistory->Position()).has_value();
+	}
+
+	void CInterpreter::StepBack()
+	{
+		if (!mHistory.has_value())
+		{
+			return;
+		}
+
+		if (auto cycle = mHistory->FindPreviousCycle(mHistory->Position()); cycle.has_value())
+		{
+			Rewind(cycle.value());
+		}
+	}
+
+	void CInterpreter::ReverseContinue()
+	{
+		if (!mHistory.has_value())
+		{
+			return;
+		}
+
+		// the breakpoints with a condition need the context where they were reached, so they are
+		// collected back to the last unconditional one and evaluated replaying from it
+		struct SCandidate
+		{
+			std::size_t Position;
+			std::uint64_t Hits;
+		};
+		std::vector<SCandidate> candidates{};
+		// hits counted since each candidate, the one at the current PC already was
+		std::unordered_map<std::uint16_t, std::uint64_t> laterHits{ { mContext.PC, 1 } };
+		std::size_t position = mHistory->Position();
+		std::size_t start = mHistory->BeginPosition();
+		while (auto cycle = mHistory->FindPreviousCycle(position))
+		{
+			position = cycle.value();
+			const std::uint16_t pc = mHistory->Event(position).PC;
+			if (!mBreakpoints.Has(pc))
+			{
+				continue;
+			}
+
+			const SBreakpointCondition* condition = mBreakpoints.Condition(pc);
+			if (condition == nullptr)
+			{
+				start = position;
+				break;
+			}
+
+			// tracepoints never stop
+			if (!condition->Trace.has_value())
+			{
+				const std::uint64_t later = laterHits[pc]++;
+				const std::uint64_t hits = condition->Hits > later ? condition->Hits - later : 0;
+				candidates.push_back({ position, hits });
+			}
+		}
+
+		Rewind(start);
+		if (candidates.empty())
+		{
+			return;
+		}
+
+		mContext.Watchpoints = nullptr;
+		std::optional<std::size_t> stop{};
+		{
+			mReplaying = true;
+			auto replaying = gsl::finally([this]() { mReplaying = false; });
+			std::size_t pos = start;
+			for (auto it = candidates.rbegin(); it != candidates.rend(); ++it)
+			{
+				for (; pos < it->Position; pos++)
+				{
+					ReplayEvent(mHistory->Event(pos));
+				}
+				if (mBreakpoints.WouldStop(mContext, it->Hits))
+				{
+					stop = it->Position;
+				}
+			}
+		}
+		Rewind(stop.value_or(start));
+	}
+
+	void CInterpreter::Rewind(std::size_t position)
+	{
+		const SHistoryCheckpoint& checkpoint = mHistory->FindCheckpoint(position);
+		mContext = checkpoint.Context;
+		// the replayed accesses already stopped the interpreter before
+		mContext.Watchpoints = nullptr;
+
+		const auto start = Clock::now();
+		mReplaying = true;
+		auto replaying = gsl::finally([this]() { mReplaying = false; });
+		for (std::size_t pos = checkpoint.Position; pos < position; pos++)
+		{
+			ReplayEvent(mHistory->Event(pos));
+		}
+		mHistory->ReportReplay(position - checkpoint.Position, Clock::now() - start);
+		mHistory->Seek(position);
+		AttachWatchpoints();
+		if (mRegionMap)
+		{
+			// the pages written after the position keep counting as written
+			mRegionMap->Rebase(mContext.Memory);
+		}
+
+		mPlatform->UpdateDisplay(mContext.Display);
+		mContext.DisplayChanged = false;
+		mProfiler.RecordDisplayUpdate();
+	}
+
+	void CInterpreter::ReplayEvent(const SHistoryEvent& event)
+	{
+		switch (event.Type)
+		{
+		case EHistoryEventType::Cycle:
+			UnpackKeyboardState(event.Keyboard, mContext.Keyboard);
+			DoCycle();
+			break;
+		case EHistoryEventType::TimerTick: DoTimerTick(); break;
 		}
 	}
 
@@ -60,6 +545,8 @@ namespace c8
 			return;
 		}
 
+		const std::uint16_t pc = c.PC;
+
 		// fetch
 		const std::uint16_t opcode = c.Memory[c.PC] << 8 | c.Memory[c.PC + std::size_t{ 1 }];
 		c.IR = opcode;
@@ -69,16 +556,101 @@ namespace c8
 
 		// execute
 		const SInstruction& instr = FindInstruction(opcode);
-		instr.Handler(c);
+		if (mProfiler.ShouldSample())
+		{
+			const std::uint64_t start = ReadTimestamp();
+			instr.Handler(c);
+			mProfiler.RecordSample(instr, ReadTimestamp() - start);
+		}
+		else
+		{
+			instr.Handler(c);
+		}
+		mProfiler.RecordExecution(instr);
+
+		if (mHeatmap && !mReplaying)
+		{
+			mHeatmap->RecordExecution(pc, opcode, c.PC);
+		}
+
+		if (mExecutionTrace && !mReplaying)
+		{
+			mExecutionTrace->Record(pc, opcode, c);
+		}
+
+		if (mRegionMap && !mReplaying)
+		{
+			mRegionMap->RecordExecution(pc, c.Memory);
+		}
+
+		if (c.Watchpoints != nullptr)
+		{
+			if (std::optional<SWatchpointHit> hit = c.Watchpoints->TakeHit())
+			{
+				hit->PC = pc;
+				hit->Value = c.Memory[hit->Address];
+				mWatchpointHit = hit;
+				mWatchpointHitPending = true;
+			}
+		}
+
+		if (IsIdleSkipActive())
+		{
+			mIdlePeriod = mIdleDetector.RecordCycle(c, pc);
+		}
+
+#ifdef C8_VERIFY_STATE_HASH
+		Ensures(c.Hash() == c.ComputeHash());
+#endif
+
+		if (mHistory.has_value() && !mReplaying)
+		{
+			mHistory->Record({ EHistoryEventType::Cycle, pc, PackKeyboardState(c.Keyboard) }, c);
+		}
 
 		// update display
-		if (mContext.DisplayChanged)
+		if (mContext.DisplayChanged && !mReplaying)
 		{
 			mPlatform->UpdateDisplay(mContext.Display);
 			mContext.DisplayChanged = false;
+			mProfiler.RecordDisplayUpdate();
+
+			// updating the display is not idle, even if the state repeats
+			ResetIdle();
 		}
 	}
 
+	std::uint64_t CInterpreter::SkipIdleCycles(std::uint64_t remaining)
+	{
+		// the state repeats every period until the next timer tick, so skipping whole periods
+		// leaves it as if they were executed
+		const std::uint64_t skipped = remaining - remaining % mIdlePeriod;
+		mIdleSkippedCycles += skipped;
+		mIdlePeriod = 0;
+		return skipped;
+	}
+
+	void CInterpreter::CheckIdleKeyboard()
+	{
+		if (IsIdleSkipActive())
+		{
+			// the loops were detected with the previous keys, they may not be idle with the new
+			const SPackedKeyboardState keyboard = PackKeyboardState(mContext.Keyboard);
+			if (keyboard != mIdleKeyboard)
+			{
+				mIdleKeyboard = keyboard;
+				ResetIdle();
+			}
+		}
+	}
+
+	void CInterpreter::ResetIdle()
+	{
+		mIdleDetector.Reset();
+		mIdlePeriod = 0;
+		mIdle = false;
+	}
+
 	void CInterpreter::DoTimerTick()
 	{
 		if (mContext.Exited)
@@ -86,22 +658,34 @@ namespace c8
 			return;
 		}
 
-		if (mContext.DT > 0)
+		// the idle loops wait for the timers to change, a tick that changes nothing keeps them
+		// idle. No instruction reads the sound timer, so it cannot change what they do
+		if (mContext.DT() > 0)
 		{
-			mContext.DT--;
+			ResetIdle();
 		}
 
-		if (mContext.ST > 0)
+		// the timers are computed from their deadlines, only the sound end has to be handled
+		mContext.Ticks++;
+		if (mContext.Ticks == mContext.STDeadline)
 		{
-			mContext.ST--;
-			if (mContext.ST == 0)
-			{
-				DoBeep();
-			}
+			DoBeep();
+		}
+
+		if (mHistory.has_value() && !mReplaying)
+		{
+			mHistory->Record({ EHistoryEventType::TimerTick, mContext.PC, 0 }, mContext);
 		}
 	}
 
-	void CInterpreter::DoBeep() { mPlatform->Beep(BeepFrequency, BeepDuration); }
+	void CInterpreter::DoBeep()
+	{
+		if (!mReplaying)
+		{
+			mPlatform->Beep(BeepFrequency, BeepDuration);
+			mProfiler.RecordBeep();
+		}
+	}
 
 	void CInterpreter::LoadProgram(const std::filesystem::path& filePath)
 	{
@@ -110,14 +694,48 @@ namespace c8
 			throw std::invalid_argument("Path '" + filePath.string() + "' is an invalid file");
 		}
 
+		std::ifstream file(filePath, std::ios::in | std::ios::binary);
+		const std::vector<std::uint8_t> program{ std::istreambuf_iterator<char>(file),
+												 std::istreambuf_iterator<char>() };
+		LoadProgram(program);
+	}
+
+	void CInterpreter::LoadProgram(gsl::span<const std::uint8_t> program)
+	{
+		const std::size_t programSize = static_cast<std::size_t>(program.size());
+		if (programSize > (MemorySize - ProgramStartAddress))
+		{
+			throw std::invalid_argument("Program of " + std::to_string(programSize) +
+										" bytes does not fit in memory");
+		}
+
 		mContext.Reset();
 
-		std::ifstream file(filePath, std::ios::in | std::ios::binary);
-		std::copy(std::istreambuf_iterator(file),
-				  std::istreambuf_iterator<char>(),
-				  std::next(mContext.Memory.begin(), ProgramStartAddress));
+		mContext.Memory.Write(ProgramStartAddress, program);
 
 		mContext.PC = ProgramStartAddress;
+		mContext.Random.Seed(mRandomSeed);
+		mProgramHash = HashProgram(program);
+		mFrameCycle = 0;
+		ResetIdle();
+		ResetRegionMap();
+
+		if (mHistory.has_value())
+		{
+			mHistory.emplace(mContext);
+		}
+	}
+
+	std::uint64_t CInterpreter::HashProgram(gsl::span<const std::uint8_t> program)
+	{
+		// 64-bit FNV-1a
+		std::uint64_t hash = 0xCBF29CE484222325;
+		for (const std::uint8_t byte : program)
+		{
+			hash ^= byte;
+			hash *= 0x100000001B3;
+		}
+		return hash;
 	}
 
 	void CInterpreter::LoadState(const std::filesystem::path& filePath)
@@ -127,28 +745,79 @@ namespace c8
 			throw std::invalid_argument("Path '" + filePath.string() + "' is an invalid file");
 		}
 
-		mContext.Reset();
+		std::ifstream file(filePath, std::ios::in | std::ios::binary);
+		LoadState(file);
+	}
+
+	void CInterpreter::LoadState(std::istream& file)
+	{
+		// read into a copy first, so the state is unchanged if the stream is not a whole state
+		SContext loaded{};
+
+		// the memory and the display are saved unpacked
+		std::array<std::uint8_t, MemorySize> memory{};
+		SDisplayPixelBuffer pixels{};
+
+		SContext& l = loaded;
+		file.read(reinterpret_cast<char*>(l.V.data()), l.V.size() * sizeof(std::uint8_t));
+		file.read(reinterpret_cast<char*>(&l.I), sizeof(l.I));
+		file.read(reinterpret_cast<char*>(&l.PC), sizeof(l.PC));
+		file.read(reinterpret_cast<char*>(&l.SP), sizeof(l.SP));
+		std::uint8_t dt = 0;
+		std::uint8_t st = 0;
+		file.read(reinterpret_cast<char*>(&dt), sizeof(dt));
+		file.read(reinterpret_cast<char*>(&st), sizeof(st));
+		file.read(reinterpret_cast<char*>(l.Stack.data()), l.Stack.size() * sizeof(std::uint16_t));
+		file.read(reinterpret_cast<char*>(memory.data()), memory.size() * sizeof(std::uint8_t));
+		file.read(reinterpret_cast<char*>(l.R.data()), l.R.size() * sizeof(std::uint8_t));
+		file.read(reinterpret_cast<char*>(&l.Display.ExtendedMode),
+				  sizeof(l.Display.ExtendedMode));
+		file.read(reinterpret_cast<char*>(pixels.data()), pixels.size() * sizeof(std::uint8_t));
+		file.read(reinterpret_cast<char*>(&l.Exited), sizeof(l.Exited));
+		if (!file)
+		{
+			throw std::invalid_argument("Save state is truncated");
+		}
 
-		std::basic_ifstream<std::uint8_t> file(filePath, std::ios::in | std::ios::binary);
+		file.read(reinterpret_cast<char*>(l.Random.State.data()),
+				  l.Random.State.size() * sizeof(std::uint32_t));
+		if (file.gcount() == 0 && file.eof())
+		{
+			// saved before the generator state was part of it
+			l.Random.Seed(mRandomSeed);
+		}
+		else if (!file)
+		{
+			throw std::invalid_argument("Save state is truncated");
+		}
 
+		mContext.Reset();
 		SContext& c = mContext;
-		file.read(c.V.data(), c.V.size() * sizeof(std::uint8_t));
-		file.read(reinterpret_cast<std::uint8_t*>(&c.I), sizeof(c.I));
-		file.read(reinterpret_cast<std::uint8_t*>(&c.PC), sizeof(c.PC));
-		file.read(&c.SP, sizeof(c.SP));
-		file.read(&c.DT, sizeof(c.DT));
-		file.read(&c.ST, sizeof(c.ST));
-		file.read(reinterpret_cast<std::uint8_t*>(c.Stack.data()),
-				  c.Stack.size() * sizeof(std::uint16_t));
-		file.read(c.Memory.data(), c.Memory.size() * sizeof(std::uint8_t));
-		file.read(c.R.data(), c.R.size() * sizeof(std::uint8_t));
-		file.read(reinterpret_cast<std::uint8_t*>(&c.Display.ExtendedMode),
-				  sizeof(c.Display.ExtendedMode));
-		file.read(c.Display.PixelBuffer.data(),
-				  c.Display.PixelBuffer.size() * sizeof(std::uint8_t));
-		file.read(reinterpret_cast<std::uint8_t*>(&c.Exited), sizeof(c.Exited));
+		c.V = l.V;
+		c.I = l.I;
+		c.PC = l.PC;
+		c.SP = l.SP;
+		c.SetDT(dt);
+		c.SetST(st);
+		c.Stack = l.Stack;
+		c.R = l.R;
+		c.Display.ExtendedMode = l.Display.ExtendedMode;
+		c.Exited = l.Exited;
+		c.Random = l.Random;
+		c.Memory.Write(0, memory);
+		for (std::size_t i = 0; i < pixels.size(); i++)
+		{
+			c.Display.PixelBuffer.Set(i, pixels[i]);
+		}
 
 		c.DisplayChanged = true;
+		ResetIdle();
+		ResetRegionMap();
+
+		if (mHistory.has_value())
+		{
+			mHistory.emplace(mContext);
+		}
 	}
 
 	void CInterpreter::SaveState(const std::filesystem::path& filePath) const
@@ -166,27 +835,41 @@ namespace c8
 										"' does not exist");
 		}
 
-		std::basic_ofstream<std::uint8_t> file(filePath, std::ios::out | std::ios::binary);
+		std::ofstream file(filePath, std::ios::out | std::ios::binary);
+		SaveState(file);
+	}
 
+	void CInterpreter::SaveState(std::ostream& file) const
+	{
 		const SContext& c = mContext;
-		file.write(c.V.data(), c.V.size() * sizeof(std::uint8_t));
-		file.write(reinterpret_cast<const std::uint8_t*>(&c.I), sizeof(c.I));
-		file.write(reinterpret_cast<const std::uint8_t*>(&c.PC), sizeof(c.PC));
-		file.write(&c.SP, sizeof(c.SP));
-		file.write(&c.DT, sizeof(c.DT));
-		file.write(&c.ST, sizeof(c.ST));
-		file.write(reinterpret_cast<const std::uint8_t*>(c.Stack.data()),
+		std::array<std::uint8_t, MemorySize> memory{};
+		SDisplayPixelBuffer pixels{};
+		c.Memory.Read(0, memory);
+		std::copy(c.Display.PixelBuffer.begin(), c.Display.PixelBuffer.end(), pixels.begin());
+
+		file.write(reinterpret_cast<const char*>(c.V.data()), c.V.size() * sizeof(std::uint8_t));
+		file.write(reinterpret_cast<const char*>(&c.I), sizeof(c.I));
+		file.write(reinterpret_cast<const char*>(&c.PC), sizeof(c.PC));
+		file.write(reinterpret_cast<const char*>(&c.SP), sizeof(c.SP));
+		const std::uint8_t dt = c.DT();
+		const std::uint8_t st = c.ST();
+		file.write(reinterpret_cast<const char*>(&dt), sizeof(dt));
+		file.write(reinterpret_cast<const char*>(&st), sizeof(st));
+		file.write(reinterpret_cast<const char*>(c.Stack.data()),
 				   c.Stack.size() * sizeof(std::uint16_t));
-		file.write(c.Memory.data(), c.Memory.size() * sizeof(std::uint8_t));
-		file.write(c.R.data(), c.R.size() * sizeof(std::uint8_t));
-		file.write(reinterpret_cast<const std::uint8_t*>(&c.Display.ExtendedMode),
+		file.write(reinterpret_cast<const char*>(memory.data()),
+				   memory.size() * sizeof(std::uint8_t));
+		file.write(reinterpret_cast<const char*>(c.R.data()), c.R.size() * sizeof(std::uint8_t));
+		file.write(reinterpret_cast<const char*>(&c.Display.ExtendedMode),
 				   sizeof(c.Display.ExtendedMode));
-		file.write(c.Display.PixelBuffer.data(),
-				   c.Display.PixelBuffer.size() * sizeof(std::uint8_t));
-		file.write(reinterpret_cast<const std::uint8_t*>(&c.Exited), sizeof(c.Exited));
+		file.write(reinterpret_cast<const char*>(pixels.data()),
+				   pixels.size() * sizeof(std::uint8_t));
+		file.write(reinterpret_cast<const char*>(&c.Exited), sizeof(c.Exited));
+		file.write(reinterpret_cast<const char*>(c.Random.State.data()),
+				   c.Random.State.size() * sizeof(std::uint32_t));
 	}
 
-	const SInstruction& CInterpreter::FindInstruction(std::uint16_t opcode) const
+	const SInstruction& CInterpreter::FindInstruction(std::uint16_t opcode)
 	{
 		auto inst = TryFindInstruction(opcode);
 
@@ -202,7 +885,7 @@ namespace c8
 	}
 
 	std::optional<std::reference_wrapper<const SInstruction>>
-	CInterpreter::TryFindInstruction(std::uint16_t opcode) const
+	CInterpreter::TryFindInstruction(std::uint16_t opcode)
 	{
 		for (auto& inst : SInstruction::InstructionSet)
 		{
@@ -215,3 +898,517 @@ namespace c8
 		return std::nullopt;
 	}
 }
+
+TEST_CASE("Interpreter fork")
+{
+	using namespace c8;
+
+	// stores the pressed key and the next random number at 0x300 every frame
+	const std::vector<std::uint8_t> program{
+		0xA3, 0x00, // 200: LD I, 300
+		0xF0, 0x0A, // 202: LD V0, K
+		0xC1, 0xFF, // 204: RND V1, FF
+		0xF1, 0x55, // 206: LD [I], V1
+		0x12, 0x02, // 208: JP 202
+	};
+
+	CInterpreter parent{ std::make_shared<CNullPlatform>() };
+	parent.SetRandomSeed(1234);
+	parent.LoadProgram(program);
+
+	SKeyboardState keyboard{};
+	keyboard[1] = true;
+	parent.RunFrame(keyboard);
+
+	CInterpreter child = parent.Fork();
+	CHECK_EQ(child.ProgramHash(), parent.ProgramHash());
+	CHECK_EQ(child.RandomSeed(), parent.RandomSeed());
+	CHECK_EQ(child.Context().Memory.SharedPageCount(parent.Context().Memory),
+			 CPagedMemory::PageCount);
+
+	SUBCASE("Same input keeps the same state")
+	{
+		parent.RunFrame(keyboard);
+		child.RunFrame(keyboard);
+		CHECK(child.Context().V == parent.Context().V);
+		CHECK(child.Context().Memory == parent.Context().Memory);
+	}
+
+	SUBCASE("Different input only copies the written page")
+	{
+		keyboard[1] = false;
+		keyboard[2] = true;
+		child.RunFrame(keyboard);
+
+		CHECK_EQ(parent.Context().Memory[0x300], 1);
+		CHECK_EQ(child.Context().Memory[0x300], 2);
+		CHECK_EQ(child.Context().Memory.SharedPageCount(parent.Context().Memory),
+				 CPagedMemory::PageCount - 1);
+	}
+}
+
+TEST_CASE("Interpreter cycles and state streams")
+{
+	using namespace c8;
+
+	// counts the frames in V3
+	const std::vector<std::uint8_t> program{
+		0x61, 0x01, // 200: LD V1, 01
+		0xF1, 0x15, // 202: LD DT, V1
+		0xF2, 0x07, // 204: LD V2, DT
+		0x32, 0x00, // 206: SE V2, 00
+		0x12, 0x04, // 208: JP 204
+		0x73, 0x01, // 20A: ADD V3, 01
+		0x12, 0x02, // 20C: JP 202
+	};
+
+	CInterpreter a{ std::make_shared<CNullPlatform>() };
+	CInterpreter b{ std::make_shared<CNullPlatform>() };
+	a.SetRandomSeed(1);
+	b.SetRandomSeed(1);
+	a.LoadProgram(program);
+	b.LoadProgram(program);
+
+	// split in uneven chunks, the timers still tick every CyclesPerFrame cycles
+	const std::uint64_t cycleCount = constants::CyclesPerFrame * 5;
+	CHECK_EQ(a.RunCycles(3), 3u);
+	CHECK_EQ(a.RunCycles(cycleCount - 3), cycleCount - 3);
+	for (std::size_t i = 0; i < 5; i++)
+	{
+		b.RunFrame(SKeyboardState{});
+	}
+	CHECK_NE(a.Context().V[3], 0);
+	CHECK_EQ(a.Context().Hash(), b.Context().Hash());
+
+	std::stringstream state{};
+	a.SaveState(state);
+	a.RunCycles(constants::CyclesPerFrame);
+	CHECK_NE(a.Context().Hash(), b.Context().Hash());
+	a.LoadState(state);
+	CHECK_EQ(a.Context().Hash(), b.Context().Hash());
+
+	// a truncated state is rejected and leaves the state as it was, except for the old format
+	// without the generator state
+	const std::string saved = state.str();
+	const std::size_t generatorSize = sizeof(SRandomGenerator::State);
+	a.RunCycles(constants::CyclesPerFrame);
+	const std::uint64_t hash = a.Context().Hash();
+	for (const std::size_t size : { std::size_t{ 0 },
+									std::size_t{ 100 },
+									saved.size() - generatorSize - 1,
+									saved.size() - generatorSize + 1,
+									saved.size() - 1 })
+	{
+		std::stringstream truncated{ saved.substr(0, size) };
+		CHECK_THROWS_AS(a.LoadState(truncated), std::invalid_argument);
+		CHECK_EQ(a.Context().Hash(), hash);
+	}
+
+	std::stringstream oldFormat{ saved.substr(0, saved.size() - generatorSize) };
+	a.LoadState(oldFormat);
+	CHECK(a.Context().V == b.Context().V);
+	CHECK_EQ(a.Context().PC, b.Context().PC);
+}
+
+TEST_CASE("Interpreter timers")
+{
+	using namespace c8;
+
+	struct SBeepPlatform : IPlatform
+	{
+		std::size_t Beeps{ 0 };
+
+		void GetKeyboardState(SKeyboardState&) override {}
+		void UpdateDisplay(const SDisplay&) override {}
+		void Beep(double, std::chrono::milliseconds) override { Beeps++; }
+	};
+
+	// starts both timers, then waits for a key
+	const std::vector<std::uint8_t> program{
+		0x60, 0x03, // 200: LD V0, 03
+		0xF0, 0x18, // 202: LD ST, V0
+		0x60, 0x05, // 204: LD V0, 05
+		0xF0, 0x15, // 206: LD DT, V0
+		0xF1, 0x0A, // 208: LD V1, K
+	};
+
+	auto platform = std::make_shared<SBeepPlatform>();
+	CInterpreter interpreter{ platform };
+	interpreter.LoadProgram(program);
+	interpreter.EnableIdleSkip(true);
+
+	interpreter.RunFrame(SKeyboardState{});
+	CHECK_EQ(interpreter.Context().DT(), 4);
+	CHECK_EQ(interpreter.Context().ST(), 2);
+
+	std::stringstream state{};
+	interpreter.SaveState(state);
+
+	interpreter.RunFrame(SKeyboardState{});
+	CHECK_EQ(platform->Beeps, 0u);
+	interpreter.RunFrame(SKeyboardState{});
+	CHECK_EQ(platform->Beeps, 1u);
+	CHECK_EQ(interpreter.Context().ST(), 0);
+	CHECK_EQ(interpreter.Context().DT(), 2);
+
+	// the sound does not end again
+	interpreter.RunFrame(SKeyboardState{});
+	interpreter.RunFrame(SKeyboardState{});
+	CHECK_EQ(platform->Beeps, 1u);
+	CHECK_EQ(interpreter.Context().DT(), 0);
+
+	// the values are saved, the deadlines start from the loaded state
+	interpreter.LoadState(state);
+	CHECK_EQ(interpreter.Context().DT(), 4);
+	CHECK_EQ(interpreter.Context().ST(), 2);
+	interpreter.RunFrame(SKeyboardState{});
+	interpreter.RunFrame(SKeyboardState{});
+	CHECK_EQ(platform->Beeps, 2u);
+}
+
+TEST_CASE("Interpreter update result")
+{
+	using namespace c8;
+
+	const std::vector<std::uint8_t> program{
+		0x12, 0x00, // 200: JP 200
+	};
+
+	CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+	interpreter.LoadProgram(program);
+
+	interpreter.Pause(true);
+	SUpdateResult result = interpreter.Update();
+	CHECK_FALSE(result.Cycle);
+	CHECK_FALSE(result.TimerTick);
+
+	// nothing ran yet, so both are due
+	interpreter.Pause(false);
+	result = interpreter.Update();
+	CHECK(result.Cycle);
+	CHECK(result.TimerTick);
+}
+
+TEST_CASE("Interpreter idle skip")
+{
+	using namespace c8;
+
+	// waits for the delay timer 3 times, then for a key, then forever
+	const std::vector<std::uint8_t> program{
+		0x60, 0x05, // 200: LD V0, 05
+		0xF0, 0x15, // 202: LD DT, V0
+		0xF1, 0x07, // 204: LD V1, DT
+		0x31, 0x00, // 206: SE V1, 00
+		0x12, 0x04, // 208: JP 204
+		0x72, 0x01, // 20A: ADD V2, 01
+		0x32, 0x03, // 20C: SE V2, 03
+		0x12, 0x02, // 20E: JP 202
+		0xF3, 0x0A, // 210: LD V3, K
+		0x74, 0x01, // 212: ADD V4, 01
+		0x12, 0x14, // 214: JP 214
+	};
+
+	auto make = [&program](bool idleSkip) {
+		CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+		interpreter.SetRandomSeed(1);
+		interpreter.LoadProgram(program);
+		interpreter.EnableIdleSkip(idleSkip);
+		return interpreter;
+	};
+
+	SUBCASE("Frames")
+	{
+		CInterpreter a = make(false);
+		CInterpreter b = make(true);
+		for (std::size_t frame = 0; frame < 60; frame++)
+		{
+			SKeyboardState keyboard{};
+			keyboard[7] = frame == 40;
+			a.RunFrame(keyboard);
+			b.RunFrame(keyboard);
+			REQUIRE_EQ(a.Context().Hash(), b.Context().Hash());
+		}
+		CHECK_EQ(b.Context().V[3], 7);
+		CHECK_EQ(b.Context().V[4], 1);
+		CHECK_EQ(a.IdleSkippedCycles(), 0u);
+		CHECK_GT(b.IdleSkippedCycles(), 60 * constants::CyclesPerFrame / 2);
+	}
+
+	SUBCASE("Cycles")
+	{
+		CInterpreter a = make(false);
+		CInterpreter b = make(true);
+		for (std::size_t i = 0; i < 100; i++)
+		{
+			CHECK_EQ(a.RunCycles(7), 7u);
+			CHECK_EQ(b.RunCycles(7), 7u);
+			REQUIRE_EQ(a.Context().Hash(), b.Context().Hash());
+		}
+		CHECK_GT(b.IdleSkippedCycles(), 0u);
+	}
+
+	SUBCASE("Observed cycles are not skipped")
+	{
+		CInterpreter b = make(true);
+		b.EnableHeatmap(true);
+		b.RunCycles(100);
+		CHECK_EQ(b.IdleSkippedCycles(), 0u);
+	}
+}
+
+TEST_CASE("Interpreter execution trace")
+{
+	using namespace c8;
+
+	const std::vector<std::uint8_t> program{
+		0x71, 0x01, // 200: ADD V1, 01
+		0xA3, 0x00, // 202: LD I, 300
+		0x12, 0x00, // 204: JP 200
+	};
+
+	CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+	interpreter.LoadProgram(program);
+	interpreter.EnableIdleSkip(true);
+	interpreter.EnableHistory(true);
+	interpreter.EnableExecutionTrace(true);
+	REQUIRE_NE(interpreter.ExecutionTrace(), nullptr);
+
+	// every cycle is recorded, even if idle skip is enabled
+	CHECK_EQ(interpreter.RunCycles(1000), 1000u);
+	CHECK_EQ(interpreter.IdleSkippedCycles(), 0u);
+	CHECK_EQ(interpreter.ExecutionTrace()->Count(), 1000u);
+
+	const std::vector<SExecutionTraceEntry> last = interpreter.ExecutionTrace()->Last(2);
+	REQUIRE_EQ(last.size(), 2u);
+	CHECK_EQ(last[0].PC, 0x204);
+	CHECK_EQ(last[0].Opcode, 0x1200);
+	CHECK_EQ(last[1].PC, 0x200);
+	CHECK_EQ(last[1].I, 0x300);
+	CHECK_EQ(last[1].V[1], static_cast<std::uint8_t>(1000 / 3 + 1));
+
+	// replaying the history to step back does not record the cycles again
+	interpreter.StepBack();
+	CHECK_EQ(interpreter.ExecutionTrace()->Count(), 1000u);
+
+	interpreter.ClearExecutionTrace();
+	CHECK_EQ(interpreter.ExecutionTrace()->Count(), 0u);
+	interpreter.EnableExecutionTrace(false);
+	CHECK_EQ(interpreter.ExecutionTrace(), nullptr);
+}
+
+TEST_CASE("Interpreter breakpoints")
+{
+	using namespace c8;
+
+	// counts the iterations in V0
+	const std::vector<std::uint8_t> program{
+		0x70, 0x01, // 200: ADD V0, 01
+		0x71, 0x02, // 202: ADD V1, 02
+		0x12, 0x00, // 204: JP 200
+	};
+
+	auto make = [&program]() {
+		CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+		interpreter.SetRandomSeed(1);
+		interpreter.LoadProgram(program);
+		return interpreter;
+	};
+
+	CInterpreter a = make();
+	CInterpreter b = make();
+	std::vector<std::uint16_t> hits{};
+	b.SetBreakpointHitCallback([&hits](std::uint16_t pc) { hits.push_back(pc); });
+	b.Breakpoints().Set(0x202, true);
+
+	SUBCASE("Cycles")
+	{
+		CHECK_EQ(b.RunCycles(100), 1u);
+		CHECK_EQ(b.Context().PC, 0x202);
+		CHECK(b.IsPaused());
+		CHECK_EQ(b.RunCycles(100), 3u);
+		CHECK_EQ(b.RunCycles(100), 3u);
+		REQUIRE_EQ(hits.size(), 3u);
+		CHECK_EQ(hits[2], 0x202);
+
+		a.RunCycles(7);
+		CHECK_EQ(a.Context().Hash(), b.Context().Hash());
+	}
+
+	SUBCASE("Frames")
+	{
+		// the frame is completed by the next calls
+		std::size_t calls = 0;
+		while (!b.RunFrame(SKeyboardState{}))
+		{
+			calls++;
+		}
+		CHECK_EQ(calls, (constants::CyclesPerFrame + 1) / 3);
+		CHECK_EQ(hits.size(), calls);
+
+		a.RunFrame(SKeyboardState{});
+		CHECK_EQ(a.Context().Hash(), b.Context().Hash());
+	}
+
+	SUBCASE("Update")
+	{
+		// stepping ignores the breakpoint
+		b.Pause(true);
+		while (b.Context().PC != 0x204)
+		{
+			b.Step();
+		}
+		CHECK(hits.empty());
+
+		b.Pause(false);
+		while (!b.IsPaused())
+		{
+			b.Update();
+		}
+		CHECK_EQ(b.Context().PC, 0x202);
+		CHECK_EQ(b.Context().V[0], 2);
+		CHECK_EQ(hits.size(), 1u);
+
+		// continuing runs the instruction at the breakpoint
+		b.Pause(false);
+		while (b.Context().PC == 0x202)
+		{
+			b.Update();
+		}
+		CHECK_EQ(b.Context().V[1], 4);
+	}
+
+	SUBCASE("Conditions")
+	{
+		b.Breakpoints().SetCondition(0x202, CExpression::Compile("V0 == 5"), {});
+		b.Breakpoints().SetCondition(0x204, {}, CExpression::Compile("V1"));
+		CHECK_EQ(b.RunCycles(100), 13u);
+		CHECK_EQ(b.Context().V[0], 5);
+		CHECK_EQ(b.Breakpoints().TraceCount(), 4u);
+		CHECK_EQ(b.Breakpoints().Traces().back().Value, 8);
+		CHECK(hits == std::vector<std::uint16_t>{ 0x202 });
+
+		a.RunCycles(13);
+		CHECK_EQ(a.Context().Hash(), b.Context().Hash());
+	}
+
+	SUBCASE("Reverse continue")
+	{
+		b.Breakpoints().Clear();
+		b.EnableHistory(true);
+		CHECK_EQ(b.RunCycles(30), 30u);
+		CHECK_EQ(b.Context().V[0], 10);
+
+		// stops where continuing forward would, the tracepoint and false conditions are skipped
+		b.Breakpoints().SetCondition(0x202, CExpression::Compile("V0 == 3 || V0 == 8"), {});
+		b.Breakpoints().SetCondition(0x204, {}, CExpression::Compile("V1"));
+		b.ReverseContinue();
+		CHECK_EQ(b.Context().PC, 0x202);
+		CHECK_EQ(b.Context().V[0], 8);
+		b.ReverseContinue();
+		CHECK_EQ(b.Context().PC, 0x202);
+		CHECK_EQ(b.Context().V[0], 3);
+		CHECK_EQ(b.Context().V[1], 4);
+		CHECK_EQ(b.Breakpoints().TraceCount(), 0u);
+
+		// an unconditional breakpoint before them still stops
+		b.Breakpoints().Set(0x200, true);
+		b.ReverseContinue();
+		CHECK_EQ(b.Context().PC, 0x200);
+		CHECK_EQ(b.Context().V[0], 2);
+
+		b.Breakpoints().Clear();
+		b.ReverseContinue();
+		CHECK_EQ(b.Context().V[0], 0);
+		CHECK_EQ(b.Context().Hash(), a.Context().Hash());
+		CHECK(hits.empty());
+	}
+
+	SUBCASE("Removed")
+	{
+		b.RunCycles(100);
+		b.Breakpoints().Clear();
+		CHECK_EQ(b.RunCycles(5), 5u);
+
+		// the stop at 202 was already resumed, one at the PC stops right away
+		b.Breakpoints().Set(0x200, true);
+		CHECK_EQ(b.RunCycles(100), 0u);
+		CHECK_EQ(hits.size(), 2u);
+	}
+}
+
+TEST_CASE("Interpreter watchpoints")
+{
+	using namespace c8;
+
+	// stores the iteration in 0x300 and reads it back
+	const std::vector<std::uint8_t> program{
+		0xA3, 0x00, // 200: LD I, 300
+		0x70, 0x01, // 202: ADD V0, 01
+		0xF0, 0x55, // 204: LD [I], V0
+		0xF1, 0x65, // 206: LD V1, [I]
+		0x12, 0x02, // 208: JP 202
+	};
+
+	auto make = [&program]() {
+		CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+		interpreter.SetRandomSeed(1);
+		interpreter.LoadProgram(program);
+		return interpreter;
+	};
+
+	CInterpreter a = make();
+	CInterpreter b = make();
+	std::vector<std::uint16_t> hits{};
+	b.SetBreakpointHitCallback([&hits](std::uint16_t pc) { hits.push_back(pc); });
+
+	SUBCASE("Write")
+	{
+		b.AddWatchpoint(0x300, 1, EWatchAccess::Write);
+		CHECK_EQ(b.RunCycles(100), 3u);
+		CHECK(b.IsPaused());
+		CHECK_EQ(b.Context().PC, 0x206);
+		REQUIRE(b.LastWatchpointHit().has_value());
+		CHECK_EQ(b.LastWatchpointHit()->PC, 0x204);
+		CHECK_EQ(b.LastWatchpointHit()->Address, 0x300);
+		CHECK_EQ(b.LastWatchpointHit()->Value, 1);
+		CHECK(b.LastWatchpointHit()->Access == EWatchAccess::Write);
+
+		CHECK_EQ(b.RunCycles(100), 4u);
+		CHECK_EQ(b.LastWatchpointHit()->Value, 2);
+		CHECK(hits == std::vector<std::uint16_t>{ 0x204, 0x204 });
+
+		a.RunCycles(7);
+		CHECK_EQ(a.Context().Hash(), b.Context().Hash());
+	}
+
+	SUBCASE("Read")
+	{
+		b.AddWatchpoint(0x2FF, 2, EWatchAccess::Read);
+		std::size_t calls = 1;
+		while (!b.RunFrame(SKeyboardState{}))
+		{
+			calls++;
+		}
+		CHECK_GT(calls, 1u);
+		CHECK(std::all_of(hits.begin(), hits.end(), [](std::uint16_t pc) { return pc == 0x206; }));
+
+		a.RunFrame(SKeyboardState{});
+		CHECK_EQ(a.Context().Hash(), b.Context().Hash());
+	}
+
+	SUBCASE("Other pages and removed")
+	{
+		b.AddWatchpoint(0x400, 0x100, EWatchAccess::ReadWrite);
+		b.AddWatchpoint(0x302, 1, EWatchAccess::ReadWrite);
+		CHECK_EQ(b.RunCycles(100), 100u);
+
+		b.AddWatchpoint(0x300, 1, EWatchAccess::ReadWrite);
+		b.RemoveWatchpoints(0x300);
+		CHECK_EQ(b.RunCycles(100), 100u);
+
+		b.ClearWatchpoints();
+		CHECK_EQ(b.RunCycles(100), 100u);
+		CHECK(hits.empty());
+		CHECK_FALSE(b.LastWatchpointHit().has_value());
+	}
+}
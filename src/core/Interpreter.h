@@ -1,21 +1,44 @@
 #pragma once
+#include "Breakpoints.h"
 #include "Constants.h"
 #include "Context.h"
+#include "ExecutionTrace.h"
+#include "Heatmap.h"
+#include "History.h"
+#include "IdleDetector.h"
 #include "Instructions.h"
 #include "Platform.h"
+#include "Profiler.h"
+#include "RegionMap.h"
+#include "Watchpoints.h"
 #include <array>
 #include <chrono>
 #include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <gsl/span>
+#include <istream>
+#include <memory>
 #include <optional>
+#include <ostream>
 
 namespace c8
 {
+	/// What a call to CInterpreter::Update or Step executed.
+	struct SUpdateResult
+	{
+		bool Cycle;
+		bool TimerTick;
+		bool Idle; // The program waits for the next timer tick or key press, see EnableIdleSkip
+	};
+
 	class CInterpreter
 	{
 	public:
 		using Clock = std::chrono::high_resolution_clock;
+		/// Called with the PC when the interpreter stops at a breakpoint, or with the PC of the
+		/// instruction that accessed a watched address, from the thread that runs it.
+		using FBreakpointHit = std::function<void(std::uint16_t pc)>;
 
 	private:
 		std::shared_ptr<IPlatform> mPlatform;
@@ -23,6 +46,27 @@ namespace c8
 		Clock::time_point mLastCycleTime;
 		Clock::time_point mLastTimerTickTime;
 		bool mPaused;
+		std::optional<CHistory> mHistory;
+		bool mReplaying; // Whether logged events are being re-executed
+		std::uint64_t mProgramHash;
+		std::uint32_t mRandomSeed; // Seed applied to the context when a program is loaded
+		std::uint32_t mFrameCycle; // Cycles run by RunCycles since its last timer tick
+		CProfiler mProfiler;
+		std::unique_ptr<CHeatmap> mHeatmap;
+		std::unique_ptr<CExecutionTrace> mExecutionTrace;
+		std::unique_ptr<CRegionMap> mRegionMap;
+		bool mIdleSkip;
+		CIdleDetector mIdleDetector;
+		std::uint32_t mIdlePeriod;          // Cycles after which the state repeats, set by DoCycle
+		bool mIdle;                         // Whether Step skips cycles until the state changes
+		SPackedKeyboardState mIdleKeyboard; // Keyboard state the loops were detected with
+		std::uint64_t mIdleSkippedCycles;
+		CBreakpoints mBreakpoints;
+		FBreakpointHit mBreakpointHit;
+		bool mResuming;                             // Whether the next cycle skips its breakpoint
+		std::unique_ptr<CWatchpoints> mWatchpoints; // Referenced by the context while not empty
+		std::optional<SWatchpointHit> mWatchpointHit;
+		bool mWatchpointHitPending; // Whether the last cycle hit a watchpoint
 
 	public:
 		CInterpreter(const std::shared_ptr<IPlatform>& platform);
@@ -33,23 +77,143 @@ namespace c8
 		CInterpreter(const CInterpreter&) = delete;
 		CInterpreter& operator=(const CInterpreter&) = delete;
 
+		/// Returns an interpreter with the same state and platform, to explore different inputs
+		/// from here. The memory pages are shared until either of them writes to them, so forking
+		/// is cheap. The history is not forked.
+		CInterpreter Fork() const;
+
 		inline const SContext& Context() const { return mContext; }
 		inline bool IsPaused() const { return mPaused; }
+		inline bool IsHistoryEnabled() const { return mHistory.has_value(); }
+		inline std::uint64_t ProgramHash() const { return mProgramHash; }
+		inline std::uint32_t RandomSeed() const { return mRandomSeed; }
+		/// Only records anything if the core is built with C8_PROFILER. It is not forked.
+		inline const CProfiler& Profiler() const { return mProfiler; }
+		inline void ResetProfiler() { mProfiler.Reset(); }
+		/// Null unless enabled with EnableHeatmap. It is not forked.
+		inline const CHeatmap* Heatmap() const { return mHeatmap.get(); }
+		/// Null unless enabled with EnableExecutionTrace. It is not forked.
+		inline const CExecutionTrace* ExecutionTrace() const { return mExecutionTrace.get(); }
+		/// Null unless enabled with EnableRegionMap. It is not forked.
+		inline const CRegionMap* RegionMap() const { return mRegionMap.get(); }
+		inline bool IsIdleSkipEnabled() const { return mIdleSkip; }
+		inline std::uint64_t IdleSkippedCycles() const { return mIdleSkippedCycles; }
+		/// When Step ticks the timers next, for callers of Update to sleep while it is idle.
+		inline Clock::time_point NextTimerTickTime() const
+		{
+			return mLastTimerTickTime + constants::TimersRate;
+		}
+		/// Checked before every cycle run by Update, RunFrame and RunCycles, with their conditions
+		/// and tracepoints. Stepping through the program ignores them. They are not forked.
+		inline CBreakpoints& Breakpoints() { return mBreakpoints; }
+		inline const CBreakpoints& Breakpoints() const { return mBreakpoints; }
+		inline void SetBreakpointHitCallback(FBreakpointHit callback)
+		{
+			mBreakpointHit = std::move(callback);
+		}
+		/// Like the breakpoints, but the interpreter stops after the instruction that accessed the
+		/// memory. They are not forked.
+		inline const CWatchpoints& Watchpoints() const { return *mWatchpoints; }
+		inline const std::optional<SWatchpointHit>& LastWatchpointHit() const
+		{
+			return mWatchpointHit;
+		}
+		void AddWatchpoint(std::uint16_t address, std::uint16_t size, EWatchAccess access);
+		/// Removes the watchpoints that cover the address.
+		void RemoveWatchpoints(std::uint16_t address);
+		void ClearWatchpoints();
 
 		void Pause(bool pause);
-		void Update();
-		void Step();
+		/// Steps unless paused. Reaching a breakpoint pauses it before the cycle is executed.
+		SUpdateResult Update();
+		/// Executes the next cycle if it is due, even at a breakpoint.
+		SUpdateResult Step();
+		/// Executes one frame in virtual time: CyclesPerFrame cycles followed by a timer tick,
+		/// with the given keyboard state. Unlike Update/Step, it does not depend on the host clock
+		/// so the same inputs always produce the same state. Returns false if it stopped at a
+		/// breakpoint or watchpoint before the end of the frame, in which case the next call
+		/// resumes the same frame from there.
+		bool RunFrame(const SKeyboardState& keyboard);
+		/// Executes cycles in virtual time, ticking the timers every CyclesPerFrame cycles and
+		/// reading the keyboard state from the platform at the start of each frame. Returns the
+		/// number of cycles executed, less than requested if the program exits or it stops at a
+		/// breakpoint or watchpoint.
+		std::uint64_t RunCycles(std::uint64_t count);
+		/// Reseeds the generator used by RND. By default, it is seeded with a random value.
+		void SetRandomSeed(std::uint32_t seed);
+
+		/// Starts or stops recording the execution history required to go back in time.
+		void EnableHistory(bool enable);
+		/// Starts or stops counting the executions of each instruction in a heatmap.
+		void EnableHeatmap(bool enable);
+		void ResetHeatmap();
+		/// Starts or stops recording every executed instruction in an execution trace.
+		void EnableExecutionTrace(bool enable);
+		void ClearExecutionTrace();
+		/// Starts or stops recording which memory pages are executed and written. Loading a
+		/// program or a state resets it.
+		void EnableRegionMap(bool enable);
+		void ResetRegionMap();
+		/// Starts or stops skipping the cycles of loops that wait for a timer tick or key press.
+		/// RunFrame and RunCycles skip whole iterations until the next timer tick, so the state is
+		/// the same as running them, and Update/Step stop executing until the next timer tick or
+		/// keyboard change. Nothing is skipped while the history, the heatmap, the execution
+		/// trace or the region map are enabled or there are breakpoints or watchpoints, and the
+		/// profiler does not count the skipped cycles.
+		void EnableIdleSkip(bool enable);
+		bool CanStepBack() const;
+		/// Goes back to the state before the last executed instruction.
+		void StepBack();
+		/// Goes back to the last time an instruction at a breakpoint was about to be executed, or
+		/// to the beginning of the history if there is none. The conditions are evaluated on the
+		/// replayed states and the tracepoints are skipped, as continuing forward would.
+		void ReverseContinue();
 
 		void LoadProgram(const std::filesystem::path& filePath);
+		void LoadProgram(gsl::span<const std::uint8_t> program);
 		void LoadState(const std::filesystem::path& filePath);
+		/// Throws std::invalid_argument if the stream ends before the state does, the state is
+		/// then unchanged. A state that ends before the generator state is the old format.
+		void LoadState(std::istream& file);
 		void SaveState(const std::filesystem::path& filePath) const;
-		const SInstruction& FindInstruction(std::uint16_t opcode) const;
-		std::optional<std::reference_wrapper<const SInstruction>>
-		TryFindInstruction(std::uint16_t opcode) const;
+		void SaveState(std::ostream& file) const;
+		static const SInstruction& FindInstruction(std::uint16_t opcode);
+		static std::optional<std::reference_wrapper<const SInstruction>>
+		TryFindInstruction(std::uint16_t opcode);
+
+		/// Hash identifying a program, as returned by ProgramHash once it is loaded.
+		static std::uint64_t HashProgram(gsl::span<const std::uint8_t> program);
 
 	private:
+		CInterpreter(const std::shared_ptr<IPlatform>& platform,
+					 const SContext& context,
+					 std::uint32_t randomSeed);
+
+		SUpdateResult DoStep(bool checkBreakpoints);
+		/// Whether the cycle at the PC has to wait because of a breakpoint. Pauses and notifies the
+		/// callback unless it is the first cycle after resuming.
+		bool StopsAtBreakpoint();
+		/// Whether the last cycle hit a watchpoint. Pauses and notifies the callback if so.
+		bool StopsAtWatchpoint();
+		/// Points the context to the watchpoints if there are any.
+		void AttachWatchpoints();
 		void DoCycle();
+		inline bool IsIdleSkipActive() const
+		{
+			// skipping whole loop iterations would also skip the breakpoints in them
+			return mIdleSkip && !mReplaying && !mHistory.has_value() && !mHeatmap &&
+				   !mExecutionTrace && !mRegionMap && mBreakpoints.IsEmpty() &&
+				   mContext.Watchpoints == nullptr;
+		}
+		/// Skips the whole periods of the detected idle loop within the remaining cycles.
+		/// Returns the number of cycles skipped.
+		std::uint64_t SkipIdleCycles(std::uint64_t remaining);
+		/// Forgets the detected loops if the keyboard state changed.
+		void CheckIdleKeyboard();
+		void ResetIdle();
 		void DoTimerTick();
 		void DoBeep();
+		void Rewind(std::size_t position);
+		void ReplayEvent(const SHistoryEvent& event);
 	};
 }
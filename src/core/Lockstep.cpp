@@ -0,0 +1,621 @@
+#include "Lockstep.h"
+#include "Interpreter.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <gsl/gsl_assert>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace c8
+{
+	using namespace constants;
+
+	/// Every lane, used while all of them are in lockstep so the loops are over contiguous arrays.
+	struct SAllLanes
+	{
+		std::size_t Count;
+	};
+
+	/// Lanes at the same PC and opcode.
+	using SLaneGroup = gsl::span<const std::uint32_t>;
+
+	// the lane count is copied to a local in the loops, otherwise the stores to the uint8_t
+	// registers may alias it and the compiler cannot compute the number of iterations to
+	// vectorize them
+
+	template<class F>
+	static inline void ForEachLane(const SAllLanes& lanes, F f)
+	{
+		const std::size_t count = lanes.Count;
+		for (std::size_t lane = 0; lane < count; lane++)
+		{
+			f(lane);
+		}
+	}
+
+	template<class F>
+	static inline void ForEachLane(const SLaneGroup& lanes, F f)
+	{
+		for (const std::uint32_t lane : lanes)
+		{
+			f(lane);
+		}
+	}
+
+	CLockstepEngine::CLockstepEngine(std::size_t laneCount)
+		: mLaneCount{ laneCount },
+		  mV{},
+		  mI(laneCount, 0),
+		  mPC(laneCount, 0),
+		  mDT(laneCount, 0),
+		  mST(laneCount, 0),
+		  mIR(laneCount, 0),
+		  mExited(laneCount, false),
+		  mContexts(laneCount),
+		  mRandomSeeds(laneCount, 0),
+		  mExitedLaneCount{ 0 },
+		  mLastGroupCount{ 0 },
+		  mSortedLanes{},
+		  mGroupEnds{},
+		  mSortedExitedLaneCount{ 0 }
+	{
+		Expects(laneCount > 0);
+
+		for (std::vector<std::uint8_t>& v : mV)
+		{
+			v.assign(laneCount, 0);
+		}
+
+		// by default, each lane gets a different sequence of random numbers
+		for (std::size_t lane = 0; lane < laneCount; lane++)
+		{
+			SetRandomSeed(lane, static_cast<std::uint32_t>(lane));
+		}
+
+		mSortedLanes.reserve(laneCount);
+		CollectLiveLanes();
+	}
+
+	void CLockstepEngine::SetRandomSeed(std::size_t lane, std::uint32_t seed)
+	{
+		Expects(lane < mLaneCount);
+
+		mRandomSeeds[lane] = seed;
+		mContexts[lane].Random.Seed(seed);
+	}
+
+	void CLockstepEngine::LoadProgram(gsl::span<const std::uint8_t> program)
+	{
+		const std::size_t programSize = static_cast<std::size_t>(program.size());
+		if (programSize > (MemorySize - ProgramStartAddress))
+		{
+			throw std::invalid_argument("Program of " + std::to_string(programSize) +
+										" bytes does not fit in memory");
+		}
+
+		SContext initialContext{};
+		initialContext.Memory.Write(ProgramStartAddress, program);
+		initialContext.PC = ProgramStartAddress;
+
+		for (std::size_t lane = 0; lane < mLaneCount; lane++)
+		{
+			SContext& context = mContexts[lane];
+			context = initialContext;
+			context.Random.Seed(mRandomSeeds[lane]);
+			LoadRegisters(lane, context);
+			mExited[lane] = false;
+		}
+
+		mExitedLaneCount = 0;
+		mLastGroupCount = 0;
+		CollectLiveLanes();
+	}
+
+	void CLockstepEngine::RunFrame(gsl::span<const SPackedKeyboardState> keyboards)
+	{
+		Expects(static_cast<std::size_t>(keyboards.size()) == mLaneCount);
+
+		auto keyboard = keyboards.begin();
+		for (std::size_t lane = 0; lane < mLaneCount; lane++, keyboard++)
+		{
+			if (!mExited[lane])
+			{
+				UnpackKeyboardState(*keyboard, mContexts[lane].Keyboard);
+			}
+		}
+
+		for (std::size_t i = 0; i < CyclesPerFrame; i++)
+		{
+			Cycle();
+		}
+
+		TimerTick();
+	}
+
+	void CLockstepEngine::Cycle()
+	{
+		if (mExitedLaneCount == mLaneCount)
+		{
+			mLastGroupCount = 0;
+			return;
+		}
+
+		// fetch, each lane has its own memory so lanes at the same PC may still differ
+		bool lockstep = true;
+		std::size_t first = mLaneCount; // First lane not exited
+		for (std::size_t lane = 0; lane < mLaneCount; lane++)
+		{
+			if (!mExited[lane])
+			{
+				const SContext& c = mContexts[lane];
+				const std::uint16_t pc = mPC[lane];
+				mIR[lane] = c.Memory[pc] << 8 | c.Memory[pc + std::size_t{ 1 }];
+				if (first == mLaneCount)
+				{
+					first = lane;
+				}
+				lockstep = lockstep && LaneKey(lane) == LaneKey(first);
+			}
+		}
+
+		if (mSortedExitedLaneCount != mExitedLaneCount)
+		{
+			CollectLiveLanes();
+		}
+
+		if (lockstep)
+		{
+			mLastGroupCount = 1;
+			if (mExitedLaneCount == 0)
+			{
+				Execute(SAllLanes{ mLaneCount }, mIR[first]);
+			}
+			else
+			{
+				const std::uint32_t* const lanes = mSortedLanes.data();
+				mGroupEnds.assign(1, static_cast<std::uint32_t>(mSortedLanes.size()));
+				Execute(SLaneGroup{ lanes, lanes + mSortedLanes.size() }, mIR[first]);
+			}
+			return;
+		}
+
+		// the lanes usually stay in the same groups for many cycles, so they are only sorted
+		// again when the groups change
+		if (!GroupsMatch())
+		{
+			Regroup();
+		}
+
+		mLastGroupCount = mGroupEnds.size();
+		const std::uint32_t* const lanes = mSortedLanes.data();
+		std::size_t begin = 0;
+		for (const std::uint32_t end : mGroupEnds)
+		{
+			Execute(SLaneGroup{ lanes + begin, lanes + end }, mIR[lanes[begin]]);
+			begin = end;
+		}
+	}
+
+	void CLockstepEngine::CollectLiveLanes()
+	{
+		mSortedLanes.clear();
+		for (std::size_t lane = 0; lane < mLaneCount; lane++)
+		{
+			if (!mExited[lane])
+			{
+				mSortedLanes.push_back(static_cast<std::uint32_t>(lane));
+			}
+		}
+		mGroupEnds.clear();
+		mSortedExitedLaneCount = mExitedLaneCount;
+	}
+
+	bool CLockstepEngine::GroupsMatch() const
+	{
+		if (mGroupEnds.empty())
+		{
+			return false;
+		}
+
+		std::size_t begin = 0;
+		for (std::size_t group = 0; group < mGroupEnds.size(); group++)
+		{
+			const std::size_t end = mGroupEnds[group];
+			const std::uint32_t key = LaneKey(mSortedLanes[begin]);
+			if (group > 0 && key <= LaneKey(mSortedLanes[begin - 1]))
+			{
+				return false;
+			}
+
+			for (std::size_t i = begin + 1; i < end; i++)
+			{
+				if (LaneKey(mSortedLanes[i]) != key)
+				{
+					return false;
+				}
+			}
+			begin = end;
+		}
+		return true;
+	}
+
+	void CLockstepEngine::Regroup()
+	{
+		// sort the lanes so that the ones at the same instruction are contiguous
+		std::sort(mSortedLanes.begin(),
+				  mSortedLanes.end(),
+				  [this](std::uint32_t a, std::uint32_t b) { return LaneKey(a) < LaneKey(b); });
+
+		mGroupEnds.clear();
+		const std::size_t count = mSortedLanes.size();
+		for (std::size_t i = 1; i <= count; i++)
+		{
+			if (i == count || LaneKey(mSortedLanes[i]) != LaneKey(mSortedLanes[i - 1]))
+			{
+				mGroupEnds.push_back(static_cast<std::uint32_t>(i));
+			}
+		}
+	}
+
+	void CLockstepEngine::TimerTick()
+	{
+		const std::uint8_t* const exited = mExited.data();
+		std::uint8_t* const dt = mDT.data();
+		std::uint8_t* const st = mST.data();
+		const std::size_t laneCount = mLaneCount;
+		for (std::size_t lane = 0; lane < laneCount; lane++)
+		{
+			dt[lane] -= !exited[lane] && dt[lane] > 0;
+			st[lane] -= !exited[lane] && st[lane] > 0;
+		}
+	}
+
+	SContext CLockstepEngine::LaneContext(std::size_t lane) const
+	{
+		Expects(lane < mLaneCount);
+
+		SContext context = mContexts[lane];
+		StoreRegisters(lane, context);
+		return context;
+	}
+
+	template<class TLanes>
+	void CLockstepEngine::Execute(const TLanes& lanes, std::uint16_t opcode)
+	{
+		const SInstruction& instruction = CInterpreter::FindInstruction(opcode);
+		const std::uint8_t x = (opcode & 0x0F00) >> 8;
+		const std::uint8_t y = (opcode & 0x00F0) >> 4;
+		const std::uint8_t kk = (opcode & 0x00FF);
+		const std::uint16_t nnn = (opcode & 0x0FFF);
+
+		// Vx, Vy and VF may be the same array, so the registers are read and written in the same
+		// order as in the handlers
+		std::uint8_t* const vx = mV[x].data();
+		const std::uint8_t* const vy = mV[y].data();
+		const std::uint8_t* const v0 = mV[0].data();
+		std::uint8_t* const vf = mV[0xF].data();
+		std::uint16_t* const i = mI.data();
+		std::uint16_t* const pc = mPC.data();
+		std::uint8_t* const dt = mDT.data();
+		std::uint8_t* const st = mST.data();
+
+		// move to next instruction
+		ForEachLane(lanes, [=](std::size_t l) { pc[l] += InstructionByteSize; });
+
+		// execute, the instructions that only use the registers are done across all the lanes
+		switch (instruction.Opcode)
+		{
+		case 0x1000: // JP nnn
+			ForEachLane(lanes, [=](std::size_t l) { pc[l] = nnn; });
+			break;
+		case 0x3000: // SE Vx, kk
+			ForEachLane(lanes, [=](std::size_t l) {
+				pc[l] += vx[l] == kk ? InstructionByteSize : 0;
+			});
+			break;
+		case 0x4000: // SNE Vx, kk
+			ForEachLane(lanes, [=](std::size_t l) {
+				pc[l] += vx[l] != kk ? InstructionByteSize : 0;
+			});
+			break;
+		case 0x5000: // SE Vx, Vy
+			ForEachLane(lanes, [=](std::size_t l) {
+				pc[l] += vx[l] == vy[l] ? InstructionByteSize : 0;
+			});
+			break;
+		case 0x6000: // LD Vx, kk
+			ForEachLane(lanes, [=](std::size_t l) { vx[l] = kk; });
+			break;
+		case 0x7000: // ADD Vx, kk
+			ForEachLane(lanes, [=](std::size_t l) { vx[l] += kk; });
+			break;
+		case 0x8000: // LD Vx, Vy
+			ForEachLane(lanes, [=](std::size_t l) { vx[l] = vy[l]; });
+			break;
+		case 0x8001: // OR Vx, Vy
+			ForEachLane(lanes, [=](std::size_t l) { vx[l] |= vy[l]; });
+			break;
+		case 0x8002: // AND Vx, Vy
+			ForEachLane(lanes, [=](std::size_t l) { vx[l] &= vy[l]; });
+			break;
+		case 0x8003: // XOR Vx, Vy
+			ForEachLane(lanes, [=](std::size_t l) { vx[l] ^= vy[l]; });
+			break;
+		// VF is computed here, not deferred to when it is read: storing the operands of every lane
+		// to compute it later costs more than the comparison (see lockstep/flags in c8-core-bench)
+		case 0x8004: // ADD Vx, Vy
+			ForEachLane(lanes, [=](std::size_t l) {
+				const std::uint8_t b = vy[l];
+				vf[l] = (vx[l] + b) > std::numeric_limits<std::uint8_t>::max();
+				vx[l] += b;
+			});
+			break;
+		case 0x8005: // SUB Vx, Vy
+			ForEachLane(lanes, [=](std::size_t l) {
+				const std::uint8_t b = vy[l];
+				vf[l] = vx[l] > b;
+				vx[l] -= b;
+			});
+			break;
+		case 0x8006: // SHR Vx
+			ForEachLane(lanes, [=](std::size_t l) {
+				vf[l] = vx[l] & 1;
+				vx[l] >>= 1;
+			});
+			break;
+		case 0x8007: // SUBN Vx, Vy
+			ForEachLane(lanes, [=](std::size_t l) {
+				const std::uint8_t b = vy[l];
+				vf[l] = b > vx[l];
+				vx[l] = b - vx[l];
+			});
+			break;
+		case 0x800E: // SHL Vx
+			ForEachLane(lanes, [=](std::size_t l) {
+				vf[l] = (vx[l] >> 7) & 1;
+				vx[l] <<= 1;
+			});
+			break;
+		case 0x9000: // SNE Vx, Vy
+			ForEachLane(lanes, [=](std::size_t l) {
+				pc[l] += vx[l] != vy[l] ? InstructionByteSize : 0;
+			});
+			break;
+		case 0xA000: // LD I, nnn
+			ForEachLane(lanes, [=](std::size_t l) { i[l] = nnn; });
+			break;
+		case 0xB000: // JP V0, nnn
+			ForEachLane(lanes, [=](std::size_t l) { pc[l] = nnn + v0[l]; });
+			break;
+		case 0xF007: // LD Vx, DT
+			ForEachLane(lanes, [=](std::size_t l) { vx[l] = dt[l]; });
+			break;
+		case 0xF015: // LD DT, Vx
+			ForEachLane(lanes, [=](std::size_t l) { dt[l] = vx[l]; });
+			break;
+		case 0xF018: // LD ST, Vx
+			ForEachLane(lanes, [=](std::size_t l) { st[l] = vx[l]; });
+			break;
+		case 0xF01E: // ADD I, Vx
+			ForEachLane(lanes, [=](std::size_t l) {
+				const std::uint8_t a = vx[l];
+				vf[l] = (a + i[l]) > std::numeric_limits<std::uint8_t>::max();
+				i[l] += a;
+			});
+			break;
+		default:
+			ForEachLane(lanes, [&](std::size_t l) { ExecuteHandler(l, instruction); });
+			break;
+		}
+	}
+
+	void CLockstepEngine::ExecuteHandler(std::size_t lane, const SInstruction& instruction)
+	{
+		SContext& context = mContexts[lane];
+		StoreRegisters(lane, context);
+		instruction.Handler(context);
+		LoadRegisters(lane, context);
+
+		if (context.Exited)
+		{
+			mExited[lane] = true;
+			mExitedLaneCount++;
+		}
+	}
+
+	void CLockstepEngine::StoreRegisters(std::size_t lane, SContext& context) const
+	{
+		for (std::size_t x = 0; x < NumberOfRegisters; x++)
+		{
+			context.V[x] = mV[x][lane];
+		}
+		context.I = mI[lane];
+		context.PC = mPC[lane];
+		context.SetDT(mDT[lane]);
+		context.SetST(mST[lane]);
+		context.IR = mIR[lane];
+	}
+
+	void CLockstepEngine::LoadRegisters(std::size_t lane, const SContext& context)
+	{
+		for (std::size_t x = 0; x < NumberOfRegisters; x++)
+		{
+			mV[x][lane] = context.V[x];
+		}
+		mI[lane] = context.I;
+		mPC[lane] = context.PC;
+		mDT[lane] = context.DT();
+		mST[lane] = context.ST();
+		mIR[lane] = context.IR;
+	}
+}
+
+TEST_CASE("Lockstep engine")
+{
+	using namespace c8;
+
+	constexpr std::size_t LaneCount{ 16 };
+	constexpr std::uint32_t FrameCount{ 120 };
+
+	auto keyboardOf = [](std::size_t lane, std::uint32_t frame) -> SPackedKeyboardState {
+		// odd lanes press key 3 after a while
+		return (lane % 2 == 1 && frame >= 10) ? (1 << 3) : 0;
+	};
+
+	auto checkLane = [](const SContext& a, const SContext& b) {
+		CHECK(a.V == b.V);
+		CHECK_EQ(a.I, b.I);
+		CHECK_EQ(a.PC, b.PC);
+		CHECK_EQ(a.SP, b.SP);
+		CHECK_EQ(a.DT(), b.DT());
+		CHECK_EQ(a.ST(), b.ST());
+		CHECK_EQ(a.IR, b.IR);
+		CHECK(a.Stack == b.Stack);
+		CHECK(a.Memory == b.Memory);
+		CHECK(a.Display.PixelBuffer == b.Display.PixelBuffer);
+		CHECK_EQ(a.Exited, b.Exited);
+	};
+
+	SUBCASE("Diverging lanes match the interpreter")
+	{
+		// branches on a random number, so lanes diverge and converge again every iteration
+		const std::vector<std::uint8_t> program{
+			0x6A, 0x00, // 200: LD VA, 00
+			0xA3, 0x00, // 202: LD I, 300
+			0xC0, 0x07, // 204: RND V0, 07
+			0x81, 0x00, // 206: LD V1, V0
+			0x81, 0x04, // 208: ADD V1, V0
+			0x82, 0x15, // 20A: SUB V2, V1
+			0x73, 0xC8, // 20C: ADD V3, C8
+			0x83, 0x06, // 20E: SHR V3
+			0x83, 0x0E, // 210: SHL V3
+			0x84, 0x37, // 212: SUBN V4, V3
+			0x85, 0x01, // 214: OR V5, V0
+			0x85, 0x42, // 216: AND V5, V4
+			0x86, 0x13, // 218: XOR V6, V1
+			0x8F, 0x14, // 21A: ADD VF, V1
+			0x40, 0x03, // 21C: SNE V0, 03
+			0x12, 0x30, // 21E: JP 230
+			0x50, 0x10, // 220: SE V0, V1
+			0x22, 0x46, // 222: CALL 246
+			0x91, 0x20, // 224: SNE V1, V2
+			0xF0, 0x18, // 226: LD ST, V0
+			0xF1, 0x29, // 228: LD F, V1
+			0xD5, 0x65, // 22A: DRW V5, V6, 5
+			0x12, 0x36, // 22C: JP 236
+			0x00, 0x00, // 22E:
+			0xE0, 0x9E, // 230: SKP V0
+			0x00, 0xFD, // 232: EXIT
+			0x12, 0x36, // 234: JP 236
+			0x7A, 0x01, // 236: ADD VA, 01
+			0xFA, 0x33, // 238: LD B, VA
+			0xF2, 0x65, // 23A: LD V2, [I]
+			0x3A, 0x40, // 23C: SE VA, 40
+			0x12, 0x42, // 23E: JP 242
+			0x00, 0xE0, // 240: CLS
+			0x60, 0x00, // 242: LD V0, 00
+			0xB2, 0x02, // 244: JP V0, 202
+			0xF0, 0x15, // 246: LD DT, V0
+			0xF3, 0x07, // 248: LD V3, DT
+			0xF4, 0x1E, // 24A: ADD I, V4
+			0x00, 0xEE, // 24C: RET
+		};
+
+		auto platform = std::make_shared<CNullPlatform>();
+		std::vector<CInterpreter> interpreters{};
+		CLockstepEngine engine{ LaneCount };
+		for (std::size_t lane = 0; lane < LaneCount; lane++)
+		{
+			interpreters.emplace_back(platform);
+			interpreters[lane].SetRandomSeed(static_cast<std::uint32_t>(lane * 7 + 1));
+			interpreters[lane].LoadProgram(program);
+			engine.SetRandomSeed(lane, static_cast<std::uint32_t>(lane * 7 + 1));
+		}
+		engine.LoadProgram(program);
+
+		std::size_t maxGroupCount = 0;
+		std::array<SPackedKeyboardState, LaneCount> keyboards{};
+		for (std::uint32_t frame = 0; frame < FrameCount; frame++)
+		{
+			for (std::size_t lane = 0; lane < LaneCount; lane++)
+			{
+				keyboards[lane] = keyboardOf(lane, frame);
+
+				SKeyboardState keyboard{};
+				UnpackKeyboardState(keyboards[lane], keyboard);
+				interpreters[lane].RunFrame(keyboard);
+			}
+
+			engine.RunFrame(keyboards);
+			maxGroupCount = std::max(maxGroupCount, engine.LastGroupCount());
+		}
+
+		CHECK_GT(maxGroupCount, 1);
+		CHECK_GT(engine.ExitedLaneCount(), 0);
+		CHECK_LT(engine.ExitedLaneCount(), LaneCount);
+		for (std::size_t lane = 0; lane < LaneCount; lane++)
+		{
+			checkLane(engine.LaneContext(lane), interpreters[lane].Context());
+		}
+	}
+
+	SUBCASE("Lanes stay in lockstep")
+	{
+		const std::vector<std::uint8_t> program{
+			0x60, 0x05, // 200: LD V0, 05
+			0x70, 0x01, // 202: ADD V0, 01
+			0xF0, 0x15, // 204: LD DT, V0
+			0x12, 0x02, // 206: JP 202
+		};
+
+		CLockstepEngine engine{ LaneCount };
+		engine.LoadProgram(program);
+
+		const std::array<SPackedKeyboardState, LaneCount> keyboards{};
+		for (std::uint32_t frame = 0; frame < FrameCount; frame++)
+		{
+			engine.RunFrame(keyboards);
+			CHECK_EQ(engine.LastGroupCount(), 1);
+		}
+
+		for (std::size_t lane = 1; lane < LaneCount; lane++)
+		{
+			checkLane(engine.LaneContext(lane), engine.LaneContext(0));
+		}
+	}
+
+	SUBCASE("Lanes left stay in lockstep")
+	{
+		// about half of the lanes exit, the others loop at the same instructions
+		const std::vector<std::uint8_t> program{
+			0xC0, 0x01, // 200: RND V0, 01
+			0x30, 0x00, // 202: SE V0, 00
+			0x00, 0xFD, // 204: EXIT
+			0x70, 0x01, // 206: ADD V0, 01
+			0x12, 0x06, // 208: JP 206
+		};
+
+		CLockstepEngine engine{ LaneCount };
+		engine.LoadProgram(program);
+		for (std::size_t i = 0; i < 4; i++)
+		{
+			engine.Cycle();
+		}
+		REQUIRE_GT(engine.ExitedLaneCount(), 0);
+		REQUIRE_LT(engine.ExitedLaneCount(), LaneCount);
+
+		for (std::size_t i = 0; i < 10; i++)
+		{
+			engine.Cycle();
+			CHECK_EQ(engine.LastGroupCount(), 1);
+		}
+	}
+
+	SUBCASE("Program too big")
+	{
+		CLockstepEngine engine{ LaneCount };
+		const std::vector<std::uint8_t> program(constants::MemorySize, 0);
+		CHECK_THROWS(engine.LoadProgram(program));
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "Constants.h"
+#include "Context.h"
+#include "Instructions.h"
+#include <array>
+#include <cstdint>
+#include <gsl/span>
+#include <vector>
+
+namespace c8
+{
+	/// Runs many instances of the same program in lockstep, in virtual time. The registers are
+	/// stored as structure-of-arrays, with an element per lane, so the lanes that are about to
+	/// execute the same instruction do it together in loops that the compiler can vectorize.
+	/// Lanes that diverge are regrouped by PC and opcode every cycle.
+	/// The memory, display, stack and keyboard are kept in a context per lane, and instructions
+	/// that use them run the SInstruction handler on it, so the semantics match CInterpreter.
+	class CLockstepEngine
+	{
+	private:
+		std::size_t mLaneCount;
+		std::array<std::vector<std::uint8_t>, constants::NumberOfRegisters> mV; // mV[x][lane]
+		std::vector<std::uint16_t> mI;
+		std::vector<std::uint16_t> mPC;
+		std::vector<std::uint8_t> mDT;
+		std::vector<std::uint8_t> mST;
+		std::vector<std::uint16_t> mIR;
+		std::vector<std::uint8_t> mExited;
+		std::vector<SContext> mContexts; // The registers stored above are stale here
+		std::vector<std::uint32_t> mRandomSeeds;
+		std::size_t mExitedLaneCount;
+		std::size_t mLastGroupCount;
+		std::vector<std::uint32_t> mSortedLanes; // The lanes not exited, by PC and opcode
+		std::vector<std::uint32_t> mGroupEnds;   // End of each group in mSortedLanes
+		std::size_t mSortedExitedLaneCount;      // Exited lanes when mSortedLanes was collected
+
+	public:
+		CLockstepEngine(std::size_t laneCount);
+
+		inline std::size_t LaneCount() const { return mLaneCount; }
+		inline std::size_t ExitedLaneCount() const { return mExitedLaneCount; }
+		/// Number of groups of lanes executed separately in the last cycle, 1 while all the lanes
+		/// are in lockstep.
+		inline std::size_t LastGroupCount() const { return mLastGroupCount; }
+
+		/// Reseeds the generator used by RND in a lane, also applied when a program is loaded.
+		void SetRandomSeed(std::size_t lane, std::uint32_t seed);
+		/// Resets every lane and loads the same program in all of them.
+		void LoadProgram(gsl::span<const std::uint8_t> program);
+		/// Executes one frame in every lane that has not exited, same as CInterpreter::RunFrame,
+		/// with a keyboard state per lane.
+		void RunFrame(gsl::span<const SPackedKeyboardState> keyboards);
+		void Cycle();
+		void TimerTick();
+
+		/// Returns a copy of the full state of a lane.
+		SContext LaneContext(std::size_t lane) const;
+
+	private:
+		inline std::uint32_t LaneKey(std::size_t lane) const
+		{
+			return std::uint32_t{ mPC[lane] } << 16 | mIR[lane];
+		}
+		void CollectLiveLanes();
+		/// Whether the groups of the last cycle still have one PC and opcode each, in order.
+		bool GroupsMatch() const;
+		void Regroup();
+		template<class TLanes>
+		void Execute(const TLanes& lanes, std::uint16_t opcode);
+		void ExecuteHandler(std::size_t lane, const SInstruction& instruction);
+		void StoreRegisters(std::size_t lane, SContext& context) const;
+		void LoadRegisters(std::size_t lane, const SContext& context);
+	};
+}
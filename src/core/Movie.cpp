@@ -0,0 +1,191 @@
+#include "Movie.h"
+#include "Interpreter.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace c8
+{
+	CMovie::CMovie(std::uint64_t programHash, std::uint32_t randomSeed)
+		: mProgramHash{ programHash },
+		  mRandomSeed{ randomSeed },
+		  mFrameCount{ 0 },
+		  mKeyboardChanges{}
+	{
+	}
+
+	void CMovie::RecordFrame(const SKeyboardState& keyboard)
+	{
+		const SPackedKeyboardState packedKeyboard = PackKeyboardState(keyboard);
+		if (mKeyboardChanges.empty() || mKeyboardChanges.back().Keyboard != packedKeyboard)
+		{
+			mKeyboardChanges.push_back({ mFrameCount, packedKeyboard });
+		}
+
+		mFrameCount++;
+	}
+
+	void CMovie::GetFrame(std::uint32_t frame, SKeyboardState& keyboard) const
+	{
+		if (frame >= mFrameCount)
+		{
+			throw std::out_of_range("Frame " + std::to_string(frame) +
+									" is past the end of the movie");
+		}
+
+		// find the last change at or before the frame
+		auto it = std::upper_bound(
+			mKeyboardChanges.begin(),
+			mKeyboardChanges.end(),
+			frame,
+			[](std::uint32_t f, const SMovieKeyboardChange& change) { return f < change.Frame; });
+		UnpackKeyboardState(std::prev(it)->Keyboard, keyboard);
+	}
+
+	void CMovie::Save(const std::filesystem::path& filePath) const
+	{
+		if (!filePath.has_filename())
+		{
+			throw std::invalid_argument("Path '" + filePath.string() +
+										"' is not a valid file path");
+		}
+
+		std::ofstream file(filePath, std::ios::out | std::ios::binary);
+
+		const std::uint32_t changeCount = static_cast<std::uint32_t>(mKeyboardChanges.size());
+		file.write(Magic.data(), Magic.size());
+		file.write(reinterpret_cast<const char*>(&Version), sizeof(Version));
+		file.write(reinterpret_cast<const char*>(&mProgramHash), sizeof(mProgramHash));
+		file.write(reinterpret_cast<const char*>(&mRandomSeed), sizeof(mRandomSeed));
+		file.write(reinterpret_cast<const char*>(&mFrameCount), sizeof(mFrameCount));
+		file.write(reinterpret_cast<const char*>(&changeCount), sizeof(changeCount));
+		for (const SMovieKeyboardChange& change : mKeyboardChanges)
+		{
+			file.write(reinterpret_cast<const char*>(&change.Frame), sizeof(change.Frame));
+			file.write(reinterpret_cast<const char*>(&change.Keyboard),
+					   sizeof(change.Keyboard));
+		}
+	}
+
+	CMovie CMovie::Load(const std::filesystem::path& filePath)
+	{
+		if (!fs::is_regular_file(filePath))
+		{
+			throw std::invalid_argument("Path '" + filePath.string() + "' is an invalid file");
+		}
+
+		std::ifstream file(filePath, std::ios::in | std::ios::binary);
+
+		std::array<char, 4> magic{};
+		std::uint16_t version = 0;
+		file.read(magic.data(), magic.size());
+		file.read(reinterpret_cast<char*>(&version), sizeof(version));
+		if (!file || magic != Magic || version != Version)
+		{
+			throw std::runtime_error("File '" + filePath.string() + "' is not a supported movie");
+		}
+
+		CMovie movie{ 0, 0 };
+		std::uint32_t changeCount = 0;
+		file.read(reinterpret_cast<char*>(&movie.mProgramHash), sizeof(movie.mProgramHash));
+		file.read(reinterpret_cast<char*>(&movie.mRandomSeed), sizeof(movie.mRandomSeed));
+		file.read(reinterpret_cast<char*>(&movie.mFrameCount), sizeof(movie.mFrameCount));
+		file.read(reinterpret_cast<char*>(&changeCount), sizeof(changeCount));
+		for (std::uint32_t i = 0; i < changeCount && file; i++)
+		{
+			SMovieKeyboardChange change{};
+			file.read(reinterpret_cast<char*>(&change.Frame), sizeof(change.Frame));
+			file.read(reinterpret_cast<char*>(&change.Keyboard), sizeof(change.Keyboard));
+			movie.mKeyboardChanges.push_back(change);
+		}
+
+		if (!file || (movie.mFrameCount > 0 && (movie.mKeyboardChanges.empty() ||
+												movie.mKeyboardChanges.front().Frame != 0)))
+		{
+			throw std::runtime_error("Movie '" + filePath.string() + "' is corrupted");
+		}
+
+		return movie;
+	}
+}
+
+TEST_CASE("Movie")
+{
+	using namespace c8;
+
+	// waits for a key, then draws random sprites from the fontset forever
+	const std::array<std::uint8_t, 12> program{
+		0xF0, 0x0A, // LD V0, K
+		0xC1, 0x0F, // RND V1, 0F
+		0xF1, 0x29, // LD F, V1
+		0xC2, 0x3F, // RND V2, 3F
+		0xD2, 0x05, // DRW V2, V0, 5
+		0x12, 0x02, // JP 202
+	};
+	const fs::path programPath = fs::temp_directory_path() / "c8-movie-test.ch8";
+	const fs::path moviePath = fs::temp_directory_path() / "c8-movie-test.c8mv";
+	{
+		std::ofstream file(programPath, std::ios::out | std::ios::binary);
+		file.write(reinterpret_cast<const char*>(program.data()), program.size());
+	}
+
+	auto platform = std::make_shared<CNullPlatform>();
+	CInterpreter recorder{ platform };
+	recorder.LoadProgram(programPath);
+	recorder.SetRandomSeed(1234);
+
+	CMovie movie{ recorder.ProgramHash(), 1234 };
+	SKeyboardState keyboard{};
+	for (std::uint32_t frame = 0; frame < 120; frame++)
+	{
+		keyboard[3] = (frame >= 30 && frame < 40);
+		movie.RecordFrame(keyboard);
+		recorder.RunFrame(keyboard);
+	}
+	movie.Save(moviePath);
+
+	SUBCASE("Save and load")
+	{
+		const CMovie loaded = CMovie::Load(moviePath);
+
+		CHECK_EQ(loaded.ProgramHash(), movie.ProgramHash());
+		CHECK_EQ(loaded.RandomSeed(), 1234);
+		CHECK_EQ(loaded.FrameCount(), 120);
+
+		loaded.GetFrame(35, keyboard);
+		CHECK(keyboard[3]);
+		loaded.GetFrame(40, keyboard);
+		CHECK(!keyboard[3]);
+		CHECK_THROWS(loaded.GetFrame(120, keyboard));
+	}
+
+	SUBCASE("Playback reproduces the final state")
+	{
+		const CMovie loaded = CMovie::Load(moviePath);
+		CInterpreter player{ platform };
+		player.LoadProgram(programPath);
+		player.SetRandomSeed(loaded.RandomSeed());
+
+		CHECK_EQ(player.ProgramHash(), loaded.ProgramHash());
+
+		for (std::uint32_t frame = 0; frame < loaded.FrameCount(); frame++)
+		{
+			loaded.GetFrame(frame, keyboard);
+			player.RunFrame(keyboard);
+		}
+
+		const SContext& a = recorder.Context();
+		const SContext& b = player.Context();
+		CHECK(a.V == b.V);
+		CHECK_EQ(a.I, b.I);
+		CHECK_EQ(a.PC, b.PC);
+		CHECK_EQ(a.DT(), b.DT());
+		CHECK(a.Memory == b.Memory);
+		CHECK(a.Display.PixelBuffer == b.Display.PixelBuffer);
+	}
+
+	fs::remove(programPath);
+	fs::remove(moviePath);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "Context.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace c8
+{
+	struct SMovieKeyboardChange
+	{
+		std::uint32_t Frame; // First frame with this keyboard state
+		SPackedKeyboardState Keyboard;
+	};
+
+	/// Input recording that reproduces a run of a program when played back with
+	/// CInterpreter::RunFrame. Besides the keyboard state of each frame, stored as the list of
+	/// frames where it changed, it stores the hash of the program and the RND seed, which must
+	/// match for the playback to be deterministic.
+	class CMovie
+	{
+	public:
+		static constexpr std::array<char, 4> Magic{ 'C', '8', 'M', 'V' };
+		static constexpr std::uint16_t Version{ 1 };
+
+	private:
+		std::uint64_t mProgramHash;
+		std::uint32_t mRandomSeed;
+		std::uint32_t mFrameCount;
+		std::vector<SMovieKeyboardChange> mKeyboardChanges;
+
+	public:
+		CMovie(std::uint64_t programHash, std::uint32_t randomSeed);
+
+		inline std::uint64_t ProgramHash() const { return mProgramHash; }
+		inline std::uint32_t RandomSeed() const { return mRandomSeed; }
+		inline std::uint32_t FrameCount() const { return mFrameCount; }
+
+		void RecordFrame(const SKeyboardState& keyboard);
+		void GetFrame(std::uint32_t frame, SKeyboardState& keyboard) const;
+
+		void Save(const std::filesystem::path& filePath) const;
+		static CMovie Load(const std::filesystem::path& filePath);
+	};
+}
@@ -0,0 +1,90 @@
+#include "PackedPixelBuffer.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+
+namespace c8
+{
+	CPackedPixelBuffer::CPackedPixelBuffer() : mWords{}, mHash{ 0 } {}
+
+	void CPackedPixelBuffer::Fill(std::uint8_t value)
+	{
+		mWords.fill(value ? ~SWord{ 0 } : SWord{ 0 });
+
+		mHash = 0;
+		for (std::size_t index = 0; value != 0 && index < size(); index++)
+		{
+			mHash ^= PixelKey(index);
+		}
+	}
+
+	std::uint64_t CPackedPixelBuffer::ComputeHash() const
+	{
+		std::uint64_t hash = 0;
+		for (std::size_t index = 0; index < size(); index++)
+		{
+			if ((*this)[index])
+			{
+				hash ^= PixelKey(index);
+			}
+		}
+		return hash;
+	}
+}
+
+TEST_CASE("Packed pixel buffer")
+{
+	using namespace c8;
+
+	CPackedPixelBuffer pixels{};
+	CHECK(std::all_of(pixels.begin(), pixels.end(), [](std::uint8_t p) { return p == 0; }));
+
+	SUBCASE("Set")
+	{
+		pixels.Set(63, 1);
+		pixels.Set(64, 1);
+		CHECK_EQ(pixels[62], 0);
+		CHECK_EQ(pixels[63], 1);
+		CHECK_EQ(pixels[64], 1);
+		CHECK_EQ(std::count(pixels.begin(), pixels.end(), std::uint8_t{ 1 }), 2);
+
+		pixels.Set(63, 0);
+		CHECK_EQ(pixels[63], 0);
+	}
+
+	SUBCASE("Xor")
+	{
+		CHECK(!pixels.Xor(100, 1));
+		CHECK_EQ(pixels[100], 1);
+		CHECK(!pixels.Xor(100, 0));
+		CHECK_EQ(pixels[100], 1);
+		CHECK(pixels.Xor(100, 1));
+		CHECK_EQ(pixels[100], 0);
+	}
+
+	SUBCASE("Fill")
+	{
+		pixels.Fill(1);
+		CHECK(std::all_of(pixels.begin(), pixels.end(), [](std::uint8_t p) { return p == 1; }));
+		CHECK(pixels != CPackedPixelBuffer{});
+		CHECK_EQ(pixels.Hash(), pixels.ComputeHash());
+	}
+
+	SUBCASE("Hash is updated on changes")
+	{
+		pixels.Xor(10, 1);
+		pixels.Set(20, 1);
+		pixels.Set(20, 1);
+		const std::uint64_t hash = pixels.Hash();
+		CHECK_NE(hash, 0);
+		CHECK_EQ(hash, pixels.ComputeHash());
+
+		pixels.Xor(30, 1);
+		CHECK_NE(pixels.Hash(), hash);
+		pixels.Xor(30, 1);
+		CHECK_EQ(pixels.Hash(), hash);
+
+		pixels.Set(10, 0);
+		pixels.Set(20, 0);
+		CHECK_EQ(pixels.Hash(), 0);
+	}
+}
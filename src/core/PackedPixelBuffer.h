@@ -0,0 +1,88 @@
+#pragma once
+#include "Constants.h"
+#include "Hash.h"
+#include "IndexedIterator.h"
+#include <array>
+#include <cstdint>
+#include <gsl/span>
+
+namespace c8
+{
+	/// Display pixels packed as one bit each, indexed as x + y * width. Iterating it yields each
+	/// pixel as 0 or 1. A Zobrist hash of the pixels that are on is updated on every change.
+	class CPackedPixelBuffer
+	{
+	public:
+		static constexpr std::size_t PixelCount{
+			constants::schip::ExtendedDisplayResolutionWidth *
+			constants::schip::ExtendedDisplayResolutionHeight
+		};
+
+		using const_iterator = CIndexedConstIterator<CPackedPixelBuffer>;
+
+	private:
+		using SWord = std::uint64_t;
+		static constexpr std::size_t PixelsPerWord{ 64 };
+
+		std::array<SWord, PixelCount / PixelsPerWord> mWords;
+		std::uint64_t mHash;
+
+	public:
+		CPackedPixelBuffer();
+
+		inline std::size_t size() const { return PixelCount; }
+		inline const_iterator begin() const { return { *this, 0 }; }
+		inline const_iterator end() const { return { *this, size() }; }
+
+		/// The packed pixels, pixel N is bit N % 64 of word N / 64.
+		inline gsl::span<const std::uint64_t> Words() const { return mWords; }
+
+		inline std::uint8_t operator[](std::size_t index) const
+		{
+			return (mWords[index / PixelsPerWord] >> (index % PixelsPerWord)) & 1;
+		}
+
+		inline void Set(std::size_t index, std::uint8_t value)
+		{
+			SWord& word = mWords[index / PixelsPerWord];
+			const SWord mask = SWord{ 1 } << (index % PixelsPerWord);
+			if (((word & mask) != 0) != (value != 0))
+			{
+				word ^= mask;
+				mHash ^= PixelKey(index);
+			}
+		}
+
+		/// XORs the pixel with the bit, returns whether it turned the pixel off.
+		inline bool Xor(std::size_t index, std::uint8_t bit)
+		{
+			SWord& word = mWords[index / PixelsPerWord];
+			const SWord mask = SWord{ bit & 1u } << (index % PixelsPerWord);
+			const bool collision = (word & mask) != 0;
+			if (mask != 0)
+			{
+				word ^= mask;
+				mHash ^= PixelKey(index);
+			}
+			return collision;
+		}
+
+		void Fill(std::uint8_t value);
+
+		inline std::uint64_t Hash() const { return mHash; }
+		/// Hashes all the pixels, the same value that Hash returns.
+		std::uint64_t ComputeHash() const;
+
+		inline bool operator==(const CPackedPixelBuffer& other) const
+		{
+			return mWords == other.mWords;
+		}
+		inline bool operator!=(const CPackedPixelBuffer& other) const { return !(*this == other); }
+
+	private:
+		static inline std::uint64_t PixelKey(std::size_t index)
+		{
+			return ZobristKey(EHashDomain::Pixels, static_cast<std::uint32_t>(index), 1);
+		}
+	};
+}
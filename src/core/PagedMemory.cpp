@@ -0,0 +1,235 @@
+#include "PagedMemory.h"
+#include <algorithm>
+#include <atomic>
+#include <doctest/doctest.h>
+#include <gsl/gsl_assert>
+
+namespace c8
+{
+	static std::uint64_t NextGeneration()
+	{
+		// each thread takes a range at a time, so the threads writing to different memories do
+		// not contend on the counter
+		constexpr std::uint64_t RangeSize{ 1 << 16 };
+		static std::atomic<std::uint64_t> nextRange{ 1 };
+		thread_local std::uint64_t next{ 0 };
+		thread_local std::uint64_t end{ 0 };
+		if (next == end)
+		{
+			next = nextRange.fetch_add(RangeSize, std::memory_order_relaxed);
+			end = next + RangeSize;
+		}
+		return next++;
+	}
+
+	CPagedMemory::CPagedMemory() : mPages{}, mHash{ 0 }, mGenerations{} { Fill(0); }
+
+	void CPagedMemory::Write(std::size_t address, std::uint8_t value)
+	{
+		Expects(address < size());
+
+		std::uint8_t& byte = WritablePage(address / PageSize)[address % PageSize];
+		const std::uint32_t index = static_cast<std::uint32_t>(address);
+		mHash ^= ZobristKey(EHashDomain::Memory, index, byte) ^
+				 ZobristKey(EHashDomain::Memory, index, value);
+		byte = value;
+	}
+
+	void CPagedMemory::Write(std::size_t address, gsl::span<const std::uint8_t> values)
+	{
+		const std::size_t count = static_cast<std::size_t>(values.size());
+		Expects(address <= size() && count <= size() - address);
+
+		for (std::size_t i = 0; i < count;)
+		{
+			const std::size_t offset = (address + i) % PageSize;
+			const std::size_t chunk = std::min(PageSize - offset, count - i);
+			SPage& page = WritablePage((address + i) / PageSize);
+			for (std::size_t j = 0; j < chunk; j++)
+			{
+				std::uint8_t& byte = page[offset + j];
+				const std::uint8_t value = values.begin()[i + j];
+				const std::uint32_t index = static_cast<std::uint32_t>(address + i + j);
+				mHash ^= ZobristKey(EHashDomain::Memory, index, byte) ^
+						 ZobristKey(EHashDomain::Memory, index, value);
+				byte = value;
+			}
+			i += chunk;
+		}
+	}
+
+	void CPagedMemory::Read(std::size_t address, gsl::span<std::uint8_t> values) const
+	{
+		const std::size_t count = static_cast<std::size_t>(values.size());
+		Expects(address <= size() && count <= size() - address);
+
+		for (std::size_t i = 0; i < count;)
+		{
+			const std::size_t offset = (address + i) % PageSize;
+			const std::size_t chunk = std::min(PageSize - offset, count - i);
+			const SPage& page = *mPages[(address + i) / PageSize];
+			std::copy_n(page.begin() + offset, chunk, values.begin() + i);
+			i += chunk;
+		}
+	}
+
+	void CPagedMemory::Fill(std::uint8_t value)
+	{
+		// every page starts shared, they are copied as the program writes to them
+		auto page = std::make_shared<SPage>();
+		page->fill(value);
+		mPages.fill(page);
+		mGenerations.fill(NextGeneration());
+
+		mHash = 0;
+		for (std::uint32_t address = 0; value != 0 && address < size(); address++)
+		{
+			mHash ^= ZobristKey(EHashDomain::Memory, address, value);
+		}
+	}
+
+	std::uint64_t CPagedMemory::ComputeHash() const
+	{
+		std::uint64_t hash = 0;
+		for (std::uint32_t address = 0; address < size(); address++)
+		{
+			hash ^= ZobristKey(EHashDomain::Memory, address, (*this)[address]);
+		}
+		return hash;
+	}
+
+	std::size_t CPagedMemory::SharedPageCount(const CPagedMemory& other) const
+	{
+		std::size_t count = 0;
+		for (std::size_t i = 0; i < PageCount; i++)
+		{
+			count += mPages[i] == other.mPages[i];
+		}
+		return count;
+	}
+
+	bool CPagedMemory::operator==(const CPagedMemory& other) const
+	{
+		for (std::size_t i = 0; i < PageCount; i++)
+		{
+			if (mPages[i] != other.mPages[i] && *mPages[i] != *other.mPages[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	CPagedMemory::SPage& CPagedMemory::WritablePage(std::size_t page)
+	{
+		std::shared_ptr<SPage>& p = mPages[page];
+		if (p.use_count() > 1)
+		{
+			p = std::make_shared<SPage>(*p);
+		}
+		mGenerations[page] = NextGeneration();
+		return *p;
+	}
+}
+
+TEST_CASE("Paged memory")
+{
+	using namespace c8;
+
+	CPagedMemory a{};
+	a.Write(0x200, 0x12);
+	a.Write(0x3FF, 0x34);
+
+	SUBCASE("Copies share the pages until written to")
+	{
+		CPagedMemory b = a;
+		CHECK_EQ(b.SharedPageCount(a), CPagedMemory::PageCount);
+		CHECK(a == b);
+
+		b.Write(0x201, 0x56);
+		CHECK_EQ(b.SharedPageCount(a), CPagedMemory::PageCount - 1);
+		CHECK_EQ(a[0x201], 0x00);
+		CHECK_EQ(b[0x201], 0x56);
+		CHECK_EQ(b[0x200], 0x12);
+		CHECK(a != b);
+
+		// a page that is no longer shared is written in place
+		a.Write(0x3FE, 0x78);
+		CHECK_EQ(b[0x3FE], 0x00);
+		CHECK_EQ(b.SharedPageCount(a), CPagedMemory::PageCount - 2);
+	}
+
+	SUBCASE("Write and read across pages")
+	{
+		const std::array<std::uint8_t, 4> values{ 1, 2, 3, 4 };
+		a.Write(0x2FE, values);
+
+		std::array<std::uint8_t, 4> read{};
+		a.Read(0x2FE, read);
+		CHECK(read == values);
+		CHECK(std::equal(values.begin(), values.end(), a.begin() + 0x2FE));
+		CHECK_THROWS(a.Write(constants::MemorySize - 2, values));
+		CHECK_THROWS(a.Write(constants::MemorySize, 0));
+	}
+
+	SUBCASE("Reads wrap around the end")
+	{
+		a.Write(0x000, 0x9A);
+		CHECK_EQ(a[constants::MemorySize], 0x9A);
+		CHECK_EQ(a[constants::MemorySize + 0x200], 0x12);
+	}
+
+	SUBCASE("Equal contents in different pages")
+	{
+		CPagedMemory b{};
+		b.Write(0x200, 0x12);
+		b.Write(0x3FF, 0x34);
+		CHECK_EQ(b.SharedPageCount(a), 0);
+		CHECK(a == b);
+		CHECK_EQ(a.Hash(), b.Hash());
+	}
+
+	SUBCASE("Hash is updated on writes")
+	{
+		const std::uint64_t hash = a.Hash();
+		CHECK_NE(hash, CPagedMemory{}.Hash());
+		CHECK_EQ(hash, a.ComputeHash());
+
+		const std::array<std::uint8_t, 3> values{ 5, 0, 7 };
+		a.Write(0x2FF, values);
+		CHECK_NE(a.Hash(), hash);
+		CHECK_EQ(a.Hash(), a.ComputeHash());
+
+		// back to the previous contents
+		a.Write(0x2FF, 0);
+		a.Write(0x301, 0);
+		CHECK_EQ(a.Hash(), hash);
+
+		a.Fill(0xAB);
+		CHECK_EQ(a.Hash(), a.ComputeHash());
+	}
+
+	SUBCASE("Generations change on writes")
+	{
+		const std::uint64_t generation = a.PageGeneration(2);
+		CHECK_NE(generation, 0u);
+
+		// copies keep them until written to, and then never get the same ones
+		CPagedMemory b = a;
+		CHECK_EQ(b.PageGeneration(2), generation);
+		b.Write(0x2FF, 0x12);
+		a.Write(0x2FF, 0x12);
+		CHECK_NE(b.PageGeneration(2), generation);
+		CHECK_NE(a.PageGeneration(2), generation);
+		CHECK_NE(a.PageGeneration(2), b.PageGeneration(2));
+		CHECK_EQ(a.PageGeneration(1), b.PageGeneration(1));
+
+		a = b;
+		CHECK_EQ(a.PageGeneration(2), b.PageGeneration(2));
+
+		const std::uint64_t other = a.PageGeneration(5);
+		a.Fill(0);
+		CHECK_NE(a.PageGeneration(5), other);
+		CHECK_EQ(a.PageGeneration(5), a.PageGeneration(0));
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "Constants.h"
+#include "Hash.h"
+#include "IndexedIterator.h"
+#include <array>
+#include <cstdint>
+#include <gsl/span>
+#include <memory>
+
+namespace c8
+{
+	/// The interpreter memory, split in pages that are shared between copies. A page is copied the
+	/// first time it is written to while shared, so copying the memory only copies the pointers.
+	/// A Zobrist hash of the contents is updated on every write, and each page has a generation
+	/// that changes to a value never used before, in any memory, every time the page is written.
+	/// Pages with the same generation have the same contents, even across copies.
+	class CPagedMemory
+	{
+	public:
+		static constexpr std::size_t PageSize{ 256 };
+		static constexpr std::size_t PageCount{ constants::MemorySize / PageSize };
+
+		using SPage = std::array<std::uint8_t, PageSize>;
+		using const_iterator = CIndexedConstIterator<CPagedMemory>;
+
+	private:
+		std::array<std::shared_ptr<SPage>, PageCount> mPages;
+		std::uint64_t mHash;
+		std::array<std::uint64_t, PageCount> mGenerations;
+
+	public:
+		CPagedMemory();
+
+		inline std::size_t size() const { return constants::MemorySize; }
+		inline const_iterator begin() const { return { *this, 0 }; }
+		inline const_iterator end() const { return { *this, size() }; }
+
+		/// The address wraps around the end of the memory, so I or PC near the end read from the
+		/// start of it.
+		inline std::uint8_t operator[](std::size_t address) const
+		{
+			address %= constants::MemorySize;
+			return (*mPages[address / PageSize])[address % PageSize];
+		}
+
+		void Write(std::size_t address, std::uint8_t value);
+		void Write(std::size_t address, gsl::span<const std::uint8_t> values);
+		void Read(std::size_t address, gsl::span<std::uint8_t> values) const;
+		void Fill(std::uint8_t value);
+
+		inline std::uint64_t Hash() const { return mHash; }
+		/// Hashes the whole memory, the same value that Hash returns.
+		std::uint64_t ComputeHash() const;
+
+		/// Never 0, so 0 can stand for contents that were not read yet.
+		inline std::uint64_t PageGeneration(std::size_t page) const { return mGenerations[page]; }
+
+		/// Number of pages that are shared with the other memory.
+		std::size_t SharedPageCount(const CPagedMemory& other) const;
+
+		bool operator==(const CPagedMemory& other) const;
+		inline bool operator!=(const CPagedMemory& other) const { return !(*this == other); }
+
+	private:
+		SPage& WritablePage(std::size_t page);
+	};
+}
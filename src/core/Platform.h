@@ -13,4 +13,13 @@ namespace c8
 		virtual void UpdateDisplay(const SDisplay& display) = 0;
 		virtual void Beep(double frequency, std::chrono::milliseconds duration) = 0;
 	};
+
+	/// Platform without input or output, for interpreters driven in virtual time.
+	class CNullPlatform : public IPlatform
+	{
+	public:
+		void GetKeyboardState(SKeyboardState&) override {}
+		void UpdateDisplay(const SDisplay&) override {}
+		void Beep(double, std::chrono::milliseconds) override {}
+	};
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "Profiler.h"
+#include "Interpreter.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <sstream>
+
+namespace c8
+{
+	CProfiler::CProfiler()
+		: mInstructions(SInstruction::InstructionSet.size()),
+		  mHistogram{},
+		  mCycleCount{ 0 },
+		  mDisplayUpdateCount{ 0 },
+		  mBeepCount{ 0 },
+		  mSampleCountdown{ SamplePeriod }
+	{
+	}
+
+	void CProfiler::Reset()
+	{
+		std::fill(mInstructions.begin(), mInstructions.end(), SInstructionProfile{});
+		mHistogram.fill(0);
+		mCycleCount = 0;
+		mDisplayUpdateCount = 0;
+		mBeepCount = 0;
+		mSampleCountdown = SamplePeriod;
+	}
+
+	void CProfiler::RecordSample(const SInstruction& instruction, std::uint64_t ticks)
+	{
+		SInstructionProfile& profile = mInstructions[IndexOf(instruction)];
+		profile.SampleCount++;
+		profile.SampledTicks += ticks;
+
+		std::size_t bucket = 0;
+		while (bucket < (HistogramBucketCount - 1) && (ticks >> (bucket + 1)) != 0)
+		{
+			bucket++;
+		}
+		mHistogram[bucket]++;
+	}
+
+	void CProfiler::WriteJson(std::ostream& output) const
+	{
+#ifdef C8_HAS_RDTSC
+		constexpr const char* TickUnit = "rdtsc";
+#else
+		constexpr const char* TickUnit = "ns";
+#endif
+
+		output << "{\n";
+		output << "  \"enabled\": " << (Enabled ? "true" : "false") << ",\n";
+		output << "  \"cycles\": " << mCycleCount << ",\n";
+		output << "  \"displayUpdates\": " << mDisplayUpdateCount << ",\n";
+		output << "  \"beeps\": " << mBeepCount << ",\n";
+		output << "  \"samplePeriod\": " << SamplePeriod << ",\n";
+		output << "  \"tickUnit\": \"" << TickUnit << "\",\n";
+		output << "  \"instructions\": [";
+		for (std::size_t i = 0; i < mInstructions.size(); i++)
+		{
+			const SInstructionProfile& profile = mInstructions[i];
+			output << (i == 0 ? "\n" : ",\n");
+			output << "    { \"name\": \"" << SInstruction::InstructionSet[i].Name
+				   << "\", \"executions\": " << profile.ExecutionCount
+				   << ", \"samples\": " << profile.SampleCount
+				   << ", \"averageTicks\": " << profile.AverageTicks() << " }";
+		}
+		output << "\n  ],\n";
+		output << "  \"histogram\": [";
+		for (std::size_t i = 0; i < mHistogram.size(); i++)
+		{
+			output << (i == 0 ? "" : ", ") << mHistogram[i];
+		}
+		output << "]\n";
+		output << "}\n";
+	}
+}
+
+TEST_CASE("Profiler")
+{
+	using namespace c8;
+
+	// runs 0x80 cycles of each instruction in the loop and then exits
+	const std::vector<std::uint8_t> program{
+		0x70, 0x01, // 200: ADD V0, 01
+		0x30, 0x80, // 202: SE V0, 80
+		0x12, 0x00, // 204: JP 200
+		0x00, 0xFD, // 206: EXIT
+	};
+
+	CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+	interpreter.LoadProgram(program);
+	interpreter.RunCycles(1000);
+	REQUIRE(interpreter.Context().Exited);
+
+	const CProfiler& profiler = interpreter.Profiler();
+	if constexpr (CProfiler::Enabled)
+	{
+		CHECK_EQ(profiler.CycleCount(), 0x80 * 3);
+
+		auto countOf = [&profiler](std::uint16_t opcode) {
+			const SInstruction& instruction = CInterpreter::FindInstruction(opcode);
+			return profiler.Instructions()[&instruction - SInstruction::InstructionSet.data()]
+				.ExecutionCount;
+		};
+		CHECK_EQ(countOf(0x7001), 0x80);
+		CHECK_EQ(countOf(0x3080), 0x80);
+		CHECK_EQ(countOf(0x1200), 0x7F);
+		CHECK_EQ(countOf(0x00FD), 1);
+
+		std::uint64_t sampleCount = 0, histogramCount = 0;
+		for (const auto& profile : profiler.Instructions())
+		{
+			sampleCount += profile.SampleCount;
+		}
+		for (std::uint64_t count : profiler.Histogram())
+		{
+			histogramCount += count;
+		}
+		CHECK_EQ(sampleCount, profiler.CycleCount() / CProfiler::SamplePeriod);
+		CHECK_EQ(histogramCount, sampleCount);
+
+		std::ostringstream json{};
+		profiler.WriteJson(json);
+		CHECK_NE(json.str().find("\"cycles\": 384"), std::string::npos);
+		CHECK_NE(json.str().find("{ \"name\": \"EXIT\", \"executions\": 1,"), std::string::npos);
+	}
+
+	interpreter.ResetProfiler();
+	CHECK_EQ(profiler.CycleCount(), 0);
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include "Instructions.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define C8_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define C8_HAS_RDTSC
+#endif
+
+namespace c8
+{
+	/// Reads the processor time stamp counter, or a steady clock in nanoseconds without one.
+	inline std::uint64_t ReadTimestamp()
+	{
+#ifdef C8_HAS_RDTSC
+		return __rdtsc();
+#else
+		return static_cast<std::uint64_t>(
+			std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	/// Counts the instructions executed by an interpreter and times a sample of them. It only
+	/// records anything when the core is built with C8_PROFILER, otherwise its recording
+	/// functions are empty and the interpreter pays nothing for them.
+	class CProfiler
+	{
+	public:
+#ifdef C8_PROFILER
+		static constexpr bool Enabled{ true };
+#else
+		static constexpr bool Enabled{ false };
+#endif
+		static constexpr std::uint32_t SamplePeriod{ 64 }; // One of every N executions is timed
+		static constexpr std::size_t HistogramBucketCount{ 32 };
+
+		struct SInstructionProfile
+		{
+			std::uint64_t ExecutionCount;
+			std::uint64_t SampleCount;
+			std::uint64_t SampledTicks; // Total time of the sampled executions
+
+			inline double AverageTicks() const
+			{
+				return SampleCount != 0 ? static_cast<double>(SampledTicks) / SampleCount : 0.0;
+			}
+		};
+
+	private:
+		std::vector<SInstructionProfile> mInstructions; // Indexed as SInstruction::InstructionSet
+		// Bucket N counts the sampled executions that took [2^N, 2^(N+1)) ticks
+		std::array<std::uint64_t, HistogramBucketCount> mHistogram;
+		std::uint64_t mCycleCount;
+		std::uint64_t mDisplayUpdateCount;
+		std::uint64_t mBeepCount;
+		std::uint32_t mSampleCountdown;
+
+	public:
+		CProfiler();
+
+		inline const std::vector<SInstructionProfile>& Instructions() const
+		{
+			return mInstructions;
+		}
+		inline const std::array<std::uint64_t, HistogramBucketCount>& Histogram() const
+		{
+			return mHistogram;
+		}
+		inline std::uint64_t CycleCount() const { return mCycleCount; }
+		inline std::uint64_t DisplayUpdateCount() const { return mDisplayUpdateCount; }
+		inline std::uint64_t BeepCount() const { return mBeepCount; }
+
+		void Reset();
+
+		/// Whether the next execution should be timed and passed to RecordSample.
+		inline bool ShouldSample()
+		{
+			if constexpr (Enabled)
+			{
+				if (--mSampleCountdown == 0)
+				{
+					mSampleCountdown = SamplePeriod;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		inline void RecordExecution(const SInstruction& instruction)
+		{
+			if constexpr (Enabled)
+			{
+				mInstructions[IndexOf(instruction)].ExecutionCount++;
+				mCycleCount++;
+			}
+		}
+
+		void RecordSample(const SInstruction& instruction, std::uint64_t ticks);
+
+		inline void RecordDisplayUpdate()
+		{
+			if constexpr (Enabled)
+			{
+				mDisplayUpdateCount++;
+			}
+		}
+
+		inline void RecordBeep()
+		{
+			if constexpr (Enabled)
+			{
+				mBeepCount++;
+			}
+		}
+
+		void WriteJson(std::ostream& output) const;
+
+	private:
+		static inline std::size_t IndexOf(const SInstruction& instruction)
+		{
+			return static_cast<std::size_t>(&instruction - SInstruction::InstructionSet.data());
+		}
+	};
+}
@@ -0,0 +1,63 @@
+#include "Random.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+
+namespace c8
+{
+	void SRandomGenerator::Seed(std::uint64_t seed)
+	{
+		for (std::size_t i = 0; i < State.size(); i += 2)
+		{
+			seed += 0x9E3779B97F4A7C15;
+			std::uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+			z ^= z >> 31;
+
+			State[i] = static_cast<std::uint32_t>(z);
+			State[i + 1] = static_cast<std::uint32_t>(z >> 32);
+		}
+	}
+}
+
+TEST_CASE("Random generator")
+{
+	using namespace c8;
+
+	SRandomGenerator a{}, b{};
+
+	SUBCASE("Same seed produces the same sequence")
+	{
+		a.Seed(1234);
+		b.Seed(1234);
+		for (std::size_t i = 0; i < 100; i++)
+		{
+			CHECK_EQ(a.Next(), b.Next());
+		}
+	}
+
+	SUBCASE("Different seeds produce different sequences")
+	{
+		a.Seed(1);
+		b.Seed(2);
+		CHECK(a.State != b.State);
+		CHECK_NE(a.Next(), b.Next());
+	}
+
+	SUBCASE("Seed 0 produces a valid state")
+	{
+		a.Seed(0);
+		CHECK(std::any_of(a.State.begin(), a.State.end(), [](std::uint32_t s) { return s != 0; }));
+	}
+
+	SUBCASE("All byte values are generated")
+	{
+		a.Seed(42);
+		std::array<bool, 256> seen{};
+		for (std::size_t i = 0; i < 10000; i++)
+		{
+			seen[a.Next() >> 24] = true;
+		}
+		CHECK(std::all_of(seen.begin(), seen.end(), [](bool s) { return s; }));
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+namespace c8
+{
+	/// xoshiro128** pseudo-random number generator.
+	/// Its whole state is 16 bytes, so it lives in the context and is saved and restored with it.
+	struct SRandomGenerator
+	{
+		std::array<std::uint32_t, 4> State;
+
+		/// Initializes the state from a seed, expanded with SplitMix64.
+		void Seed(std::uint64_t seed);
+
+		inline std::uint32_t Next()
+		{
+			const std::uint32_t result = RotateLeft(State[1] * 5, 7) * 9;
+			const std::uint32_t t = State[1] << 9;
+
+			State[2] ^= State[0];
+			State[3] ^= State[1];
+			State[1] ^= State[2];
+			State[0] ^= State[3];
+			State[2] ^= t;
+			State[3] = RotateLeft(State[3], 11);
+
+			return result;
+		}
+
+	private:
+		static inline std::uint32_t RotateLeft(std::uint32_t x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+	};
+}
@@ -0,0 +1,105 @@
+#include "RegionMap.h"
+#include "Interpreter.h"
+#include <doctest/doctest.h>
+
+namespace c8
+{
+	CRegionMap::CRegionMap(const CPagedMemory& memory)
+		: mExecuted{}, mWritten{}, mGenerations{}
+	{
+		Rebase(memory);
+	}
+
+	void CRegionMap::Reset(const CPagedMemory& memory)
+	{
+		mExecuted.reset();
+		mWritten.reset();
+		Rebase(memory);
+	}
+
+	void CRegionMap::Rebase(const CPagedMemory& memory)
+	{
+		for (std::size_t page = 0; page < CPagedMemory::PageCount; page++)
+		{
+			mGenerations[page] = memory.PageGeneration(page);
+		}
+	}
+
+	ERegionKind CRegionMap::Kind(std::size_t page) const
+	{
+		const bool executed = mExecuted.test(page);
+		const bool written = mWritten.test(page);
+		if (executed && written)
+		{
+			return ERegionKind::SelfModifying;
+		}
+		else if (executed)
+		{
+			return ERegionKind::Code;
+		}
+		else if (written)
+		{
+			return ERegionKind::Data;
+		}
+		else
+		{
+			return ERegionKind::Unused;
+		}
+	}
+}
+
+TEST_CASE("Region map")
+{
+	using namespace c8;
+
+	// writes a BCD to 400 and a JP over the zeros at 310, then jumps to it
+	std::vector<std::uint8_t> program{
+		0xA4, 0x00, // 200: LD I, 400
+		0xF0, 0x33, // 202: LD B, V0
+		0xA3, 0x10, // 204: LD I, 310
+		0x60, 0x13, // 206: LD V0, 13
+		0x61, 0x10, // 208: LD V1, 10
+		0xF1, 0x55, // 20A: LD [I], V1
+		0x13, 0x10, // 20C: JP 310
+	};
+	program.resize(0x112);
+
+	CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+	interpreter.LoadProgram(program);
+	CHECK_EQ(interpreter.RegionMap(), nullptr);
+
+	interpreter.EnableRegionMap(true);
+	REQUIRE_NE(interpreter.RegionMap(), nullptr);
+	const CRegionMap& regions = *interpreter.RegionMap();
+
+	// loading the program is not a write
+	CHECK(regions.Executed().none());
+	CHECK(regions.Written().none());
+
+	interpreter.RunCycles(2);
+	CHECK_EQ(regions.Kind(2), ERegionKind::Code);
+	CHECK_EQ(regions.Kind(4), ERegionKind::Data);
+	CHECK_EQ(regions.Kind(3), ERegionKind::Unused);
+
+	interpreter.RunCycles(4);
+	CHECK_EQ(regions.Kind(3), ERegionKind::Data);
+
+	interpreter.RunCycles(10);
+	CHECK_EQ(regions.Kind(0), ERegionKind::Unused);
+	CHECK_EQ(regions.Kind(2), ERegionKind::Code);
+	CHECK_EQ(regions.KindAt(0x310), ERegionKind::SelfModifying);
+	CHECK_EQ(regions.KindAt(0x402), ERegionKind::Data);
+	CHECK_EQ(regions.Kind(5), ERegionKind::Unused);
+	CHECK_EQ(regions.Executed().count(), 2u);
+	CHECK_EQ(regions.Written().count(), 2u);
+
+	interpreter.ResetRegionMap();
+	CHECK(regions.Executed().none());
+	CHECK(regions.Written().none());
+
+	// the state is the one of the new program
+	interpreter.RunCycles(1);
+	interpreter.LoadProgram(program);
+	CHECK(regions.Executed().none());
+	CHECK(regions.Written().none());
+}
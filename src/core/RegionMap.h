@@ -0,0 +1,69 @@
+#pragma once
+#include "Constants.h"
+#include "PagedMemory.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+namespace c8
+{
+	enum class ERegionKind : std::uint8_t
+	{
+		Unused,        // Neither executed nor written, though it may be read
+		Code,          // Executed and never written
+		Data,          // Written and never executed
+		SelfModifying, // Executed and written, the code in it cannot be cached as it is
+	};
+
+	/// Which memory pages the program executes and writes, to tell which code can be decoded
+	/// once and which changes. The writes are found from the page generations, so recording an
+	/// instruction only compares them with the ones seen before.
+	class CRegionMap
+	{
+	public:
+		using SPageSet = std::bitset<CPagedMemory::PageCount>;
+
+	private:
+		SPageSet mExecuted;
+		SPageSet mWritten;
+		std::array<std::uint64_t, CPagedMemory::PageCount> mGenerations; // Last seen
+
+	public:
+		CRegionMap(const CPagedMemory& memory);
+
+		/// Records the instruction executed at the address and the writes since the last one.
+		inline void RecordExecution(std::uint16_t address, const CPagedMemory& memory)
+		{
+			// an instruction at the end of a page is also read from the next one
+			mExecuted.set(Page(address));
+			mExecuted.set(Page(address + 1));
+
+			for (std::size_t page = 0; page < CPagedMemory::PageCount; page++)
+			{
+				const std::uint64_t generation = memory.PageGeneration(page);
+				if (generation != mGenerations[page])
+				{
+					mGenerations[page] = generation;
+					mWritten.set(page);
+				}
+			}
+		}
+
+		/// Forgets what was executed and written, with the memory as it is now.
+		void Reset(const CPagedMemory& memory);
+		/// Takes the memory as it is now without counting the differences as writes, for when
+		/// the memory is replaced by a previous state of itself.
+		void Rebase(const CPagedMemory& memory);
+
+		inline const SPageSet& Executed() const { return mExecuted; }
+		inline const SPageSet& Written() const { return mWritten; }
+		ERegionKind Kind(std::size_t page) const;
+		inline ERegionKind KindAt(std::uint16_t address) const { return Kind(Page(address)); }
+
+	private:
+		static inline std::size_t Page(std::size_t address)
+		{
+			return (address % constants::MemorySize) / CPagedMemory::PageSize;
+		}
+	};
+}
@@ -0,0 +1,232 @@
+#include "Trace.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <thread>
+
+namespace c8
+{
+	namespace
+	{
+		void WriteJsonString(std::ostream& output, const std::string& str)
+		{
+			output << '"';
+			for (const char c : str)
+			{
+				if (c == '"' || c == '\\')
+				{
+					output << '\\' << c;
+				}
+				else if (static_cast<unsigned char>(c) < 0x20)
+				{
+					output << ' ';
+				}
+				else
+				{
+					output << c;
+				}
+			}
+			output << '"';
+		}
+	}
+
+	CTracer::CTracer()
+		: mEnabled{ false }, mEpoch{ std::chrono::steady_clock::now() }, mThreadsMutex{}, mThreads{}
+	{
+	}
+
+	CTracer& CTracer::Instance()
+	{
+		static CTracer instance{};
+		return instance;
+	}
+
+	void CTracer::SetThreadName(const std::string& name)
+	{
+		SThreadBuffer& buffer = ThreadBuffer();
+		std::lock_guard lock{ buffer.Mutex };
+		buffer.Name = name;
+	}
+
+	void CTracer::Record(const STraceEvent& event)
+	{
+		SThreadBuffer& buffer = ThreadBuffer();
+		std::lock_guard lock{ buffer.Mutex };
+		if (buffer.Events.size() < ThreadCapacity)
+		{
+			buffer.Events.push_back(event);
+		}
+		else
+		{
+			buffer.Events[buffer.Next] = event;
+			buffer.Next = (buffer.Next + 1) % ThreadCapacity;
+			buffer.Dropped++;
+		}
+	}
+
+	void CTracer::Clear()
+	{
+		std::lock_guard threadsLock{ mThreadsMutex };
+		for (auto& buffer : mThreads)
+		{
+			std::lock_guard lock{ buffer->Mutex };
+			buffer->Events.clear();
+			buffer->Next = 0;
+			buffer->Dropped = 0;
+		}
+	}
+
+	std::vector<STraceEvent> CTracer::Events() const
+	{
+		std::vector<STraceEvent> events{};
+		std::lock_guard threadsLock{ mThreadsMutex };
+		for (const auto& buffer : mThreads)
+		{
+			std::lock_guard lock{ buffer->Mutex };
+			std::rotate_copy(buffer->Events.begin(),
+							 buffer->Events.begin() + buffer->Next,
+							 buffer->Events.end(),
+							 std::back_inserter(events));
+		}
+		return events;
+	}
+
+	void CTracer::WriteChromeJson(std::ostream& output) const
+	{
+		using Microseconds = std::chrono::duration<double, std::micro>;
+
+		std::uint64_t dropped = 0;
+		bool first = true;
+		auto separator = [&output, &first]() {
+			output << (first ? "\n" : ",\n");
+			first = false;
+		};
+
+		// timestamps in microseconds with nanosecond precision, even after hours of tracing
+		const std::ios_base::fmtflags flags = output.flags();
+		const std::streamsize precision = output.precision();
+		output << std::fixed << std::setprecision(3);
+
+		output << "{\n";
+		output << "  \"displayTimeUnit\": \"ms\",\n";
+		output << "  \"traceEvents\": [";
+		std::lock_guard threadsLock{ mThreadsMutex };
+		for (const auto& buffer : mThreads)
+		{
+			std::lock_guard lock{ buffer->Mutex };
+			dropped += buffer->Dropped;
+
+			if (!buffer->Name.empty())
+			{
+				separator();
+				output << "    { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+					   << buffer->Id << ", \"args\": { \"name\": ";
+				WriteJsonString(output, buffer->Name);
+				output << " } }";
+			}
+
+			const std::size_t count = buffer->Events.size();
+			for (std::size_t i = 0; i < count; i++)
+			{
+				const STraceEvent& event = buffer->Events[(buffer->Next + i) % count];
+				separator();
+				output << "    { \"name\": ";
+				WriteJsonString(output, event.Name);
+				output << ", \"cat\": \"c8\", \"ph\": \"X\", \"ts\": "
+					   << Microseconds(event.Start - mEpoch).count()
+					   << ", \"dur\": " << Microseconds(event.Duration).count()
+					   << ", \"pid\": 1, \"tid\": " << buffer->Id << " }";
+			}
+		}
+		output << "\n  ],\n";
+		output << "  \"otherData\": { \"droppedEvents\": " << dropped << " }\n";
+		output << "}\n";
+
+		output.flags(flags);
+		output.precision(precision);
+	}
+
+	CTracer::SThreadBuffer& CTracer::ThreadBuffer()
+	{
+		// the tracer is a singleton and never removes a buffer, so the pointer stays valid and the
+		// events of threads that already finished are still written
+		thread_local SThreadBuffer* threadBuffer = nullptr;
+		if (!threadBuffer)
+		{
+			std::lock_guard lock{ mThreadsMutex };
+			auto& buffer = mThreads.emplace_back(std::make_unique<SThreadBuffer>());
+			buffer->Id = static_cast<std::uint32_t>(mThreads.size());
+			buffer->Next = 0;
+			buffer->Dropped = 0;
+			buffer->Events.reserve(ThreadCapacity);
+			threadBuffer = buffer.get();
+		}
+		return *threadBuffer;
+	}
+}
+
+TEST_CASE("Tracer")
+{
+	using namespace c8;
+
+	CTracer& tracer = CTracer::Instance();
+	tracer.Clear();
+	CHECK_FALSE(tracer.IsEnabled());
+
+	{
+		CTraceScope scope{ "Disabled" };
+	}
+	CHECK(tracer.Events().empty());
+
+	tracer.Enable(true);
+	tracer.SetThreadName("Test \"main\"");
+	{
+		CTraceScope outer{ "Outer" };
+		CTraceScope inner{ "Inner" };
+		CTraceScope ended{ "Ended" };
+		ended.End();
+	}
+
+	// overflow the ring of another thread, its oldest events are overwritten
+	std::thread worker([&tracer]() {
+		tracer.SetThreadName("Worker");
+		for (std::size_t i = 0; i < CTracer::ThreadCapacity + 10; i++)
+		{
+			const auto now = std::chrono::steady_clock::now();
+			tracer.Record({ "Work", now, std::chrono::nanoseconds(i) });
+		}
+	});
+	worker.join();
+	tracer.Enable(false);
+
+	const std::vector<STraceEvent> events = tracer.Events();
+	std::size_t workEvents = 0;
+	std::vector<std::string> mainEvents{};
+	for (const STraceEvent& event : events)
+	{
+		if (std::string{ event.Name } == "Work")
+		{
+			CHECK_EQ(event.Duration, std::chrono::nanoseconds(10 + workEvents));
+			workEvents++;
+		}
+		else
+		{
+			mainEvents.push_back(event.Name);
+		}
+	}
+	CHECK_EQ(workEvents, CTracer::ThreadCapacity);
+	// the inner scope is destroyed, and recorded, first
+	CHECK_EQ(mainEvents, std::vector<std::string>{ "Ended", "Inner", "Outer" });
+
+	std::ostringstream json{};
+	tracer.WriteChromeJson(json);
+	CHECK_NE(json.str().find("\"args\": { \"name\": \"Test \\\"main\\\"\" }"), std::string::npos);
+	CHECK_NE(json.str().find("{ \"name\": \"Inner\", \"cat\": \"c8\", \"ph\": \"X\", \"ts\": "),
+			 std::string::npos);
+	CHECK_NE(json.str().find("\"droppedEvents\": 10 }"), std::string::npos);
+
+	tracer.Clear();
+	CHECK(tracer.Events().empty());
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace c8
+{
+	/// A span of time spent by a thread in a named piece of code.
+	struct STraceEvent
+	{
+		const char* Name; // Must outlive the tracer, usually a string literal
+		std::chrono::steady_clock::time_point Start;
+		std::chrono::steady_clock::duration Duration;
+	};
+
+	/// Records spans from any thread into fixed-size ring buffers, one per thread so recording only
+	/// takes a lock that is contended while dumping. It can be written in the Chrome trace event
+	/// format, viewable in chrome://tracing or Perfetto. Disabled by default.
+	class CTracer
+	{
+	public:
+		static constexpr std::size_t ThreadCapacity{ 16384 }; // Events kept per thread
+
+	private:
+		struct SThreadBuffer
+		{
+			std::mutex Mutex;
+			std::uint32_t Id;
+			std::string Name;
+			std::vector<STraceEvent> Events;
+			std::size_t Next;      // Index of the oldest event once the buffer is full
+			std::uint64_t Dropped; // Events overwritten since the last clear
+		};
+
+		std::atomic<bool> mEnabled;
+		std::chrono::steady_clock::time_point mEpoch;
+		mutable std::mutex mThreadsMutex;
+		std::vector<std::unique_ptr<SThreadBuffer>> mThreads;
+
+		CTracer();
+
+	public:
+		CTracer(const CTracer&) = delete;
+		CTracer& operator=(const CTracer&) = delete;
+
+		static CTracer& Instance();
+
+		inline bool IsEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+		inline void Enable(bool enable) { mEnabled.store(enable, std::memory_order_relaxed); }
+
+		/// Names the calling thread in the trace.
+		void SetThreadName(const std::string& name);
+		void Record(const STraceEvent& event);
+		/// Discards the events of every thread, keeping their names.
+		void Clear();
+
+		/// Copies the events of every thread, oldest first per thread, ordered by thread.
+		std::vector<STraceEvent> Events() const;
+		void WriteChromeJson(std::ostream& output) const;
+
+	private:
+		SThreadBuffer& ThreadBuffer();
+	};
+
+	/// Records a span from its construction to its destruction, if the tracer is enabled.
+	class CTraceScope
+	{
+	private:
+		const char* mName;
+		std::chrono::steady_clock::time_point mStart;
+		bool mActive;
+
+	public:
+		inline explicit CTraceScope(const char* name)
+			: mName{ name }, mStart{}, mActive{ CTracer::Instance().IsEnabled() }
+		{
+			if (mActive)
+			{
+				mStart = std::chrono::steady_clock::now();
+			}
+		}
+
+		inline ~CTraceScope() { End(); }
+
+		/// Records the span now instead of when destroyed.
+		inline void End()
+		{
+			if (mActive)
+			{
+				CTracer::Instance().Record(
+					{ mName, mStart, std::chrono::steady_clock::now() - mStart });
+				mActive = false;
+			}
+		}
+
+		CTraceScope(const CTraceScope&) = delete;
+		CTraceScope& operator=(const CTraceScope&) = delete;
+	};
+}
@@ -0,0 +1,147 @@
+#include "Watchpoints.h"
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <gsl/gsl_assert>
+
+namespace c8
+{
+	using namespace constants;
+
+	static bool Covers(const SWatchpoint& watchpoint, std::size_t address)
+	{
+		return address >= watchpoint.Address && address < (watchpoint.Address + watchpoint.Size);
+	}
+
+	static bool HasAccess(EWatchAccess access, EWatchAccess flag)
+	{
+		return (static_cast<std::uint8_t>(access) & static_cast<std::uint8_t>(flag)) != 0;
+	}
+
+	CWatchpoints::CWatchpoints() : mWatchpoints{}, mReadPages{ 0 }, mWritePages{ 0 }, mHit{} {}
+
+	bool CWatchpoints::IsWatched(std::uint16_t address) const
+	{
+		return std::any_of(mWatchpoints.begin(),
+						   mWatchpoints.end(),
+						   [address](const SWatchpoint& w) { return Covers(w, address); });
+	}
+
+	void CWatchpoints::Add(std::uint16_t address, std::uint16_t size, EWatchAccess access)
+	{
+		Expects(size != 0 && (address + size) <= MemorySize);
+
+		mWatchpoints.push_back({ address, size, access });
+		UpdatePages();
+	}
+
+	void CWatchpoints::Remove(std::uint16_t address)
+	{
+		auto covers = [address](const SWatchpoint& w) { return Covers(w, address); };
+		mWatchpoints.erase(std::remove_if(mWatchpoints.begin(), mWatchpoints.end(), covers),
+						   mWatchpoints.end());
+		UpdatePages();
+	}
+
+	void CWatchpoints::Clear()
+	{
+		mWatchpoints.clear();
+		mHit.reset();
+		UpdatePages();
+	}
+
+	void CWatchpoints::FindHit(std::uint16_t address, std::size_t size, EWatchAccess access)
+	{
+		if (mHit.has_value())
+		{
+			return;
+		}
+
+		// the lowest watched address in the access, over all the watchpoints
+		std::optional<std::size_t> hitAddress{};
+		for (const SWatchpoint& w : mWatchpoints)
+		{
+			const std::size_t start = std::max<std::size_t>(address, w.Address);
+			if (HasAccess(w.Access, access) && start < (address + size) && Covers(w, start) &&
+				(!hitAddress.has_value() || start < hitAddress.value()))
+			{
+				hitAddress = start;
+			}
+		}
+
+		if (hitAddress.has_value())
+		{
+			mHit = SWatchpointHit{ 0, static_cast<std::uint16_t>(hitAddress.value()), access, 0 };
+		}
+	}
+
+	void CWatchpoints::UpdatePages()
+	{
+		mReadPages = 0;
+		mWritePages = 0;
+		for (const SWatchpoint& w : mWatchpoints)
+		{
+			SPageMask pages = 0;
+			for (std::size_t page = Page(w.Address); page <= Page(w.Address + w.Size - 1); page++)
+			{
+				pages |= SPageMask{ 1 } << page;
+			}
+
+			if (HasAccess(w.Access, EWatchAccess::Read))
+			{
+				mReadPages |= pages;
+			}
+			if (HasAccess(w.Access, EWatchAccess::Write))
+			{
+				mWritePages |= pages;
+			}
+		}
+	}
+}
+
+TEST_CASE("Watchpoints")
+{
+	using namespace c8;
+
+	CWatchpoints watchpoints{};
+	CHECK(watchpoints.IsEmpty());
+
+	watchpoints.Add(0x3FE, 4, EWatchAccess::Write); // Crosses a page
+	watchpoints.Add(0x500, 1, EWatchAccess::Read);
+	CHECK(watchpoints.IsWatched(0x401));
+	CHECK_FALSE(watchpoints.IsWatched(0x402));
+
+	SUBCASE("Accesses")
+	{
+		watchpoints.RecordRead(0x3FE, 4);
+		watchpoints.RecordWrite(0x500, 1);
+		watchpoints.RecordWrite(0x3F0, 14);
+		CHECK_FALSE(watchpoints.TakeHit().has_value());
+
+		// the first access is kept until taken
+		watchpoints.RecordWrite(0x400, 16);
+		watchpoints.RecordRead(0x4F8, 16);
+		std::optional<SWatchpointHit> hit = watchpoints.TakeHit();
+		REQUIRE(hit.has_value());
+		CHECK_EQ(hit->Address, 0x400);
+		CHECK(hit->Access == EWatchAccess::Write);
+		CHECK_FALSE(watchpoints.TakeHit().has_value());
+
+		watchpoints.RecordRead(0x4F8, 16);
+		hit = watchpoints.TakeHit();
+		REQUIRE(hit.has_value());
+		CHECK_EQ(hit->Address, 0x500);
+		CHECK(hit->Access == EWatchAccess::Read);
+	}
+
+	SUBCASE("Remove")
+	{
+		watchpoints.Remove(0x3FF);
+		watchpoints.RecordWrite(0x3FE, 4);
+		CHECK_FALSE(watchpoints.TakeHit().has_value());
+		CHECK_FALSE(watchpoints.IsEmpty());
+
+		watchpoints.Clear();
+		CHECK(watchpoints.IsEmpty());
+		CHECK_FALSE(watchpoints.IsWatched(0x500));
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "Constants.h"
+#include "PagedMemory.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace c8
+{
+	enum class EWatchAccess : std::uint8_t
+	{
+		Read = 1 << 0,
+		Write = 1 << 1,
+		ReadWrite = Read | Write,
+	};
+
+	struct SWatchpoint
+	{
+		std::uint16_t Address;
+		std::uint16_t Size;
+		EWatchAccess Access;
+	};
+
+	struct SWatchpointHit
+	{
+		std::uint16_t PC; // Address of the instruction that accessed the memory
+		std::uint16_t Address;
+		EWatchAccess Access;
+		std::uint8_t Value; // The byte read or written
+	};
+
+	/// Memory ranges whose reads or writes stop the interpreter. The instructions that access the
+	/// memory report it through SContext::Watchpoints, and the pages with watched bytes are kept
+	/// in a bitmap per access so accesses to other pages only test a bit.
+	class CWatchpoints
+	{
+	private:
+		using SPageMask = std::uint32_t;
+		static_assert(CPagedMemory::PageCount <= sizeof(SPageMask) * 8);
+
+		std::vector<SWatchpoint> mWatchpoints;
+		SPageMask mReadPages;
+		SPageMask mWritePages;
+		std::optional<SWatchpointHit> mHit; // First access since the last TakeHit
+
+	public:
+		CWatchpoints();
+
+		inline bool IsEmpty() const { return mWatchpoints.empty(); }
+		inline const std::vector<SWatchpoint>& Watchpoints() const { return mWatchpoints; }
+		/// Whether any watchpoint covers the address, for any access.
+		bool IsWatched(std::uint16_t address) const;
+
+		void Add(std::uint16_t address, std::uint16_t size, EWatchAccess access);
+		/// Removes the watchpoints that cover the address.
+		void Remove(std::uint16_t address);
+		void Clear();
+
+		/// Called by the instructions with the bytes they access, starting at the address.
+		inline void RecordRead(std::uint16_t address, std::size_t size)
+		{
+			if (AnyPage(mReadPages, address, size))
+			{
+				FindHit(address, size, EWatchAccess::Read);
+			}
+		}
+		inline void RecordWrite(std::uint16_t address, std::size_t size)
+		{
+			if (AnyPage(mWritePages, address, size))
+			{
+				FindHit(address, size, EWatchAccess::Write);
+			}
+		}
+
+		/// Returns the first access recorded since the previous call, if any.
+		inline std::optional<SWatchpointHit> TakeHit()
+		{
+			std::optional<SWatchpointHit> hit = mHit;
+			mHit.reset();
+			return hit;
+		}
+
+	private:
+		static inline std::size_t Page(std::size_t address)
+		{
+			return (address / CPagedMemory::PageSize) % CPagedMemory::PageCount;
+		}
+		/// The instructions access up to 32 bytes, so at most the first and last pages.
+		static inline bool AnyPage(SPageMask pages, std::uint16_t address, std::size_t size)
+		{
+			return ((pages >> Page(address)) | (pages >> Page(address + size - 1))) & 1;
+		}
+		void FindHit(std::uint16_t address, std::size_t size, EWatchAccess access);
+		void UpdatePages();
+	};
+}
@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <chrono>
+#include <core/Interpreter.h>
+#include <core/Lockstep.h>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tclap/CmdLine.h>
+#include <vector>
+
+using namespace c8;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	/// Results are folded into it so the work of a benchmark cannot be optimized away.
+	volatile std::uint64_t Sink{ 0 };
+
+	struct SBenchmark
+	{
+		std::string Name;
+		std::uint64_t OpsPerIteration;
+		std::function<void(std::uint64_t iterations)> Run;
+	};
+
+	struct SBenchmarkResult
+	{
+		std::string Name;
+		double NanosecondsPerOp;
+
+		inline double OpsPerSecond() const { return 1e9 / NanosecondsPerOp; }
+	};
+
+	// programs that loop forever, to measure the whole fetch, decode and execute path
+	const std::vector<std::uint8_t> AluProgram{
+		0x60, 0x01, // 200: LD V0, 01
+		0x61, 0x03, // 202: LD V1, 03
+		0x80, 0x14, // 204: ADD V0, V1
+		0x82, 0x05, // 206: SUB V2, V0
+		0x83, 0x21, // 208: OR V3, V2
+		0x84, 0x33, // 20A: XOR V4, V3
+		0x85, 0x46, // 20C: SHR V5, V4
+		0x70, 0x07, // 20E: ADD V0, 07
+		0x30, 0x00, // 210: SE V0, 00
+		0x12, 0x04, // 212: JP 204
+		0x12, 0x00, // 214: JP 200
+	};
+
+	const std::vector<std::uint8_t> SpriteProgram{
+		0xC0, 0x3F, // 200: RND V0, 3F
+		0xC1, 0x1F, // 202: RND V1, 1F
+		0xC2, 0x0F, // 204: RND V2, 0F
+		0xF2, 0x29, // 206: LD F, V2
+		0xD0, 0x15, // 208: DRW V0, V1, 5
+		0x12, 0x00, // 20A: JP 200
+	};
+
+	const std::vector<std::uint8_t> MemoryProgram{
+		0xA3, 0x00, // 200: LD I, 300
+		0xFF, 0x65, // 202: LD VF, [I]
+		0x70, 0x01, // 204: ADD V0, 01
+		0xFF, 0x55, // 206: LD [I], VF
+		0xF0, 0x33, // 208: LD B, V0
+		0x12, 0x02, // 20A: JP 202
+	};
+
+	const std::vector<std::uint8_t> ScrollProgram{
+		0x00, 0xFF, // 200: HIGH
+		0xA0, 0x00, // 202: LD I, 000
+		0xC0, 0x7F, // 204: RND V0, 7F
+		0xC1, 0x3F, // 206: RND V1, 3F
+		0xD0, 0x10, // 208: DRW V0, V1, 0
+		0x00, 0xFB, // 20A: SCR
+		0x00, 0xC2, // 20C: SCD 2
+		0x00, 0xFC, // 20E: SCL
+		0x12, 0x04, // 210: JP 204
+	};
+
+	// every instruction that sets VF, then the same with instructions that do not
+	const std::vector<std::uint8_t> FlagProgram{
+		0x81, 0x24, // 200: ADD V1, V2
+		0x82, 0x15, // 202: SUB V2, V1
+		0x83, 0x06, // 204: SHR V3
+		0x84, 0x37, // 206: SUBN V4, V3
+		0x85, 0x0E, // 208: SHL V5
+		0xF1, 0x1E, // 20A: ADD I, V1
+		0x12, 0x00, // 20C: JP 200
+	};
+
+	const std::vector<std::uint8_t> NoFlagProgram{
+		0x81, 0x21, // 200: OR V1, V2
+		0x82, 0x11, // 202: OR V2, V1
+		0x83, 0x02, // 204: AND V3, V0
+		0x84, 0x33, // 206: XOR V4, V3
+		0x85, 0x01, // 208: OR V5, V0
+		0x71, 0x1E, // 20A: ADD V1, 1E
+		0x12, 0x00, // 20C: JP 200
+	};
+
+	SBenchmark ProgramBenchmark(const std::string& name,
+								const std::vector<std::uint8_t>& program,
+								bool executionTrace = false)
+	{
+		return { "program/" + name, constants::CyclesPerFrame, [=](std::uint64_t iterations) {
+					CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+					interpreter.SetRandomSeed(0);
+					interpreter.LoadProgram(program);
+					interpreter.EnableExecutionTrace(executionTrace);
+
+					const SKeyboardState keyboard{};
+					for (std::uint64_t i = 0; i < iterations; i++)
+					{
+						interpreter.RunFrame(keyboard);
+					}
+					Sink = Sink ^ interpreter.Context().Hash();
+				} };
+	}
+
+	/// Measures the time of a cycle of each lane while all of them are in lockstep.
+	SBenchmark LockstepBenchmark(const std::string& name, const std::vector<std::uint8_t>& program)
+	{
+		constexpr std::size_t LaneCount{ 64 };
+		return { "lockstep/" + name, LaneCount, [=](std::uint64_t iterations) {
+					CLockstepEngine engine{ LaneCount };
+					engine.LoadProgram(program);
+					for (std::uint64_t i = 0; i < iterations; i++)
+					{
+						engine.Cycle();
+					}
+					Sink = Sink ^ engine.LaneContext(0).Hash();
+				} };
+	}
+
+	/// Executes the handler of the opcode on a context prepared by the setup function.
+	SBenchmark HandlerBenchmark(const std::string& name,
+								std::uint16_t opcode,
+								const std::function<void(SContext&)>& setup)
+	{
+		return { "handler/" + name, 1, [opcode, setup](std::uint64_t iterations) {
+					SContext c{};
+					setup(c);
+					c.IR = opcode;
+
+					const SInstruction& instruction = CInterpreter::FindInstruction(opcode);
+					const FInstructionHandler& handler = instruction.Handler;
+					for (std::uint64_t i = 0; i < iterations; i++)
+					{
+						handler(c);
+					}
+					Sink = Sink ^ c.Hash();
+				} };
+	}
+
+	void FillDisplay(SContext& c)
+	{
+		std::mt19937 random{ 0 };
+		for (std::size_t i = 0; i < c.Display.PixelBuffer.size(); i++)
+		{
+			c.Display.PixelBuffer.Set(i, random() & 1);
+		}
+	}
+
+	std::vector<SBenchmark> CreateBenchmarks()
+	{
+		std::vector<SBenchmark> benchmarks{};
+
+		// opcodes of every instruction with random operands
+		std::vector<std::uint16_t> opcodes{};
+		std::mt19937 random{ 0 };
+		for (std::size_t i = 0; i < 4096; i++)
+		{
+			const SInstruction& instruction =
+				SInstruction::InstructionSet[i % SInstruction::InstructionSet.size()];
+			opcodes.push_back(instruction.Opcode | (random() & ~instruction.OpcodeMask));
+		}
+		benchmarks.push_back({ "decode", 1, [opcodes](std::uint64_t iterations) {
+								  std::uint64_t found = 0;
+								  for (std::uint64_t i = 0; i < iterations; i++)
+								  {
+									  found += CInterpreter::TryFindInstruction(
+												   opcodes[i % opcodes.size()])
+												   .has_value();
+								  }
+								  Sink = Sink ^ found;
+							  } });
+
+		auto noSetup = [](SContext&) {};
+		auto extended = [](SContext& c) {
+			c.Display.ExtendedMode = true;
+			FillDisplay(c);
+		};
+		auto memory = [](SContext& c) { c.I = 0x300; };
+		benchmarks.push_back(HandlerBenchmark("alu/ADD Vx, Vy", 0x8124, noSetup));
+		benchmarks.push_back(HandlerBenchmark("alu/SUB Vx, Vy", 0x8125, noSetup));
+		benchmarks.push_back(HandlerBenchmark("alu/SHR Vx", 0x8126, noSetup));
+		benchmarks.push_back(HandlerBenchmark("alu/SUBN Vx, Vy", 0x8127, noSetup));
+		benchmarks.push_back(HandlerBenchmark("alu/SHL Vx", 0x812E, noSetup));
+		benchmarks.push_back(HandlerBenchmark("alu/ADD I, Vx", 0xF11E, noSetup));
+		// sets no flag, to compare the ones above with
+		benchmarks.push_back(HandlerBenchmark("alu/OR Vx, Vy", 0x8121, noSetup));
+		benchmarks.push_back(HandlerBenchmark("alu/SE Vx, kk", 0x3100, noSetup));
+		benchmarks.push_back(HandlerBenchmark("DRW 8x5", 0xD015, noSetup));
+		benchmarks.push_back(HandlerBenchmark("DRW 8x15", 0xD01F, memory));
+		benchmarks.push_back(HandlerBenchmark("DRW 16x16", 0xD010, [](SContext& c) {
+			c.Display.ExtendedMode = true;
+			c.I = 0x300;
+		}));
+		benchmarks.push_back(HandlerBenchmark("SCR", 0x00FB, extended));
+		benchmarks.push_back(HandlerBenchmark("SCL", 0x00FC, extended));
+		benchmarks.push_back(HandlerBenchmark("SCD 4", 0x00C4, extended));
+		benchmarks.push_back(HandlerBenchmark("LD [I], VF", 0xFF55, memory));
+		benchmarks.push_back(HandlerBenchmark("LD VF, [I]", 0xFF65, memory));
+
+		benchmarks.push_back({ "context/Reset", 1, [](std::uint64_t iterations) {
+								  SContext c{};
+								  for (std::uint64_t i = 0; i < iterations; i++)
+								  {
+									  c.Reset();
+								  }
+								  Sink = Sink ^ c.Hash();
+							  } });
+
+		benchmarks.push_back({ "state/Save", 1, [](std::uint64_t iterations) {
+								  CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+								  interpreter.LoadProgram(SpriteProgram);
+								  std::stringstream stream{};
+								  for (std::uint64_t i = 0; i < iterations; i++)
+								  {
+									  stream.seekp(0);
+									  interpreter.SaveState(stream);
+								  }
+								  Sink = Sink ^ static_cast<std::uint64_t>(stream.tellp());
+							  } });
+
+		benchmarks.push_back({ "state/Load", 1, [](std::uint64_t iterations) {
+								  CInterpreter interpreter{ std::make_shared<CNullPlatform>() };
+								  interpreter.LoadProgram(SpriteProgram);
+								  std::stringstream stream{};
+								  interpreter.SaveState(stream);
+								  for (std::uint64_t i = 0; i < iterations; i++)
+								  {
+									  stream.seekg(0);
+									  interpreter.LoadState(stream);
+								  }
+								  Sink = Sink ^ interpreter.Context().Hash();
+							  } });
+
+		benchmarks.push_back(ProgramBenchmark("alu", AluProgram));
+		benchmarks.push_back(ProgramBenchmark("sprite", SpriteProgram));
+		benchmarks.push_back(ProgramBenchmark("memory", MemoryProgram));
+		benchmarks.push_back(ProgramBenchmark("scroll", ScrollProgram));
+		benchmarks.push_back(ProgramBenchmark("alu+exec-trace", AluProgram, true));
+		benchmarks.push_back(LockstepBenchmark("flags", FlagProgram));
+		benchmarks.push_back(LockstepBenchmark("no flags", NoFlagProgram));
+
+		return benchmarks;
+	}
+
+	/// Runs the benchmark for about the minimum time, several times, and keeps the fastest run.
+	SBenchmarkResult Measure(const SBenchmark& benchmark, std::chrono::duration<double> minTime)
+	{
+		constexpr std::size_t Repetitions{ 5 };
+
+		// find how many iterations take about the minimum time
+		std::uint64_t iterations = 1;
+		std::chrono::duration<double> elapsed{};
+		while (true)
+		{
+			const auto start = Clock::now();
+			benchmark.Run(iterations);
+			elapsed = Clock::now() - start;
+			if (elapsed >= minTime / 10)
+			{
+				break;
+			}
+			iterations *= 2;
+		}
+		iterations = std::max<std::uint64_t>(1, iterations * (minTime / elapsed));
+
+		double best = std::numeric_limits<double>::max();
+		for (std::size_t i = 0; i < Repetitions; i++)
+		{
+			const auto start = Clock::now();
+			benchmark.Run(iterations);
+			const std::chrono::duration<double, std::nano> runTime = Clock::now() - start;
+			best = std::min(best, runTime.count() / (iterations * benchmark.OpsPerIteration));
+		}
+
+		return { benchmark.Name, best };
+	}
+
+	void WriteJson(std::ostream& output, const std::vector<SBenchmarkResult>& results)
+	{
+		output << "{\n  \"benchmarks\": [";
+		for (std::size_t i = 0; i < results.size(); i++)
+		{
+			output << (i == 0 ? "\n" : ",\n");
+			output << "    { \"name\": \"" << results[i].Name
+				   << "\", \"nsPerOp\": " << results[i].NanosecondsPerOp
+				   << ", \"opsPerSecond\": " << results[i].OpsPerSecond() << " }";
+		}
+		output << "\n  ]\n}\n";
+	}
+
+	/// Reads the ns/op of each benchmark from a file written by WriteJson.
+	std::map<std::string, double> ReadBaseline(const std::string& filePath)
+	{
+		std::ifstream file(filePath);
+		if (!file)
+		{
+			throw std::invalid_argument("Baseline file '" + filePath + "' could not be opened");
+		}
+
+		const std::string NameKey{ "\"name\": \"" };
+		const std::string TimeKey{ "\"nsPerOp\": " };
+
+		std::map<std::string, double> baseline{};
+		std::string line;
+		while (std::getline(file, line))
+		{
+			const std::size_t name = line.find(NameKey);
+			const std::size_t time = line.find(TimeKey);
+			if (name == std::string::npos || time == std::string::npos)
+			{
+				continue;
+			}
+
+			const std::size_t nameStart = name + NameKey.size();
+			const std::size_t nameEnd = line.find('"', nameStart);
+			const double nanosecondsPerOp = std::stod(line.substr(time + TimeKey.size()));
+			baseline[line.substr(nameStart, nameEnd - nameStart)] = nanosecondsPerOp;
+		}
+		return baseline;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	TCLAP::CmdLine cmd("Chip-8 core microbenchmarks", ' ', "WIP");
+	TCLAP::ValueArg<std::string> filterArg(
+		"", "filter", "Only runs the benchmarks whose name contains it.", false, "", "text");
+	TCLAP::ValueArg<double> minTimeArg(
+		"", "min-time", "Specifies the time of each run, in seconds.", false, 0.1, "seconds");
+	TCLAP::ValueArg<std::string> jsonArg(
+		"", "json", "Specifies the file where to write the results.", false, "", "json_file");
+	TCLAP::ValueArg<std::string> baselineArg(
+		"",
+		"baseline",
+		"Specifies results to compare with, as written by --json. Exits with an error if any "
+		"benchmark is slower than the threshold.",
+		false,
+		"",
+		"json_file");
+	TCLAP::ValueArg<double> thresholdArg(
+		"",
+		"threshold",
+		"Specifies the slowdown allowed by --baseline, in percent.",
+		false,
+		10.0,
+		"percent");
+
+	cmd.add(filterArg);
+	cmd.add(minTimeArg);
+	cmd.add(jsonArg);
+	cmd.add(baselineArg);
+	cmd.add(thresholdArg);
+
+	cmd.parse(argc, argv);
+
+	try
+	{
+		std::map<std::string, double> baseline{};
+		if (baselineArg.isSet())
+		{
+			baseline = ReadBaseline(baselineArg.getValue());
+		}
+
+		const std::chrono::duration<double> minTime{ minTimeArg.getValue() };
+		std::vector<SBenchmarkResult> results{};
+		bool regressed = false;
+		for (const SBenchmark& benchmark : CreateBenchmarks())
+		{
+			if (benchmark.Name.find(filterArg.getValue()) == std::string::npos)
+			{
+				continue;
+			}
+
+			const SBenchmarkResult& result = results.emplace_back(Measure(benchmark, minTime));
+			std::cout << std::left << std::setw(24) << result.Name << std::right << std::fixed
+					  << std::setprecision(2) << std::setw(12) << result.NanosecondsPerOp
+					  << " ns/op" << std::setw(16) << std::setprecision(0)
+					  << result.OpsPerSecond() << " op/s";
+
+			auto it = baseline.find(result.Name);
+			if (it != baseline.end())
+			{
+				const double change = 100.0 * (result.NanosecondsPerOp / it->second - 1.0);
+				const bool slower = change > thresholdArg.getValue();
+				regressed |= slower;
+				std::cout << std::showpos << std::setw(10) << std::setprecision(1) << change
+						  << std::noshowpos << "%" << (slower ? "  REGRESSION" : "");
+			}
+			std::cout << std::endl;
+		}
+
+		if (jsonArg.isSet())
+		{
+			std::ofstream file(jsonArg.getValue());
+			WriteJson(file, results);
+		}
+
+		if (regressed)
+		{
+			std::cerr << "Some benchmarks are more than " << thresholdArg.getValue()
+					  << "% slower than the baseline" << std::endl;
+			return 1;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,19 @@
+#include "HeadlessPlatform.h"
+#include <algorithm>
+
+CHeadlessPlatform::CHeadlessPlatform() : mDisplayUpdateCount{ 0 }, mBeepCount{ 0 } {}
+
+void CHeadlessPlatform::GetKeyboardState(c8::SKeyboardState& dest)
+{
+	std::fill(dest.begin(), dest.end(), false);
+}
+
+void CHeadlessPlatform::UpdateDisplay(const c8::SDisplay&)
+{
+	mDisplayUpdateCount++;
+}
+
+void CHeadlessPlatform::Beep(double, std::chrono::milliseconds)
+{
+	mBeepCount++;
+}
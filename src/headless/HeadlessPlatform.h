@@ -0,0 +1,21 @@
+#pragma once
+#include <core/Platform.h>
+#include <cstdint>
+
+/// Platform without any window, audio or input, used to run programs as fast as possible.
+class CHeadlessPlatform : public c8::IPlatform
+{
+private:
+	std::size_t mDisplayUpdateCount;
+	std::size_t mBeepCount;
+
+public:
+	CHeadlessPlatform();
+
+	inline std::size_t DisplayUpdateCount() const { return mDisplayUpdateCount; }
+	inline std::size_t BeepCount() const { return mBeepCount; }
+
+	void GetKeyboardState(c8::SKeyboardState& dest) override;
+	void UpdateDisplay(const c8::SDisplay& display) override;
+	void Beep(double frequency, std::chrono::milliseconds duration) override;
+};
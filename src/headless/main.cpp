@@ -0,0 +1,210 @@
+#include "HeadlessPlatform.h"
+#include <chrono>
+#include <core/Interpreter.h>
+#include <core/Movie.h>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <tclap/CmdLine.h>
+
+int main(int argc, char* argv[])
+{
+	TCLAP::CmdLine cmd("Chip-8 headless interpreter", ' ', "WIP");
+	TCLAP::UnlabeledValueArg<std::string> inputArg("input_file",
+												   "Specifies the filename of the program ROM.",
+												   true,
+												   "",
+												   "input_file");
+	TCLAP::ValueArg<std::uint32_t> framesArg(
+		"f",
+		"frames",
+		"Specifies the number of frames to run. Defaults to the length of the played movie.",
+		false,
+		0,
+		"frames");
+	TCLAP::ValueArg<std::string> playArg("p",
+										 "play",
+										 "Specifies the movie to play back.",
+										 false,
+										 "",
+										 "movie_file");
+	TCLAP::ValueArg<std::string> recordArg("r",
+										   "record",
+										   "Specifies the file where to record a movie of the run.",
+										   false,
+										   "",
+										   "movie_file");
+	TCLAP::ValueArg<std::uint32_t> seedArg(
+		"s",
+		"seed",
+		"Specifies the seed of the random number generator. Ignored when playing a movie.",
+		false,
+		0,
+		"seed");
+	TCLAP::ValueArg<std::string> saveStateArg("",
+											  "save-state",
+											  "Specifies the file where to save the final state.",
+											  false,
+											  "",
+											  "state_file");
+	TCLAP::ValueArg<std::string> profileArg(
+		"",
+		"profile",
+		"Specifies the file where to write the profile of the run, as JSON. Requires a core built "
+		"with C8_PROFILER.",
+		false,
+		"",
+		"json_file");
+	TCLAP::ValueArg<std::string> execTraceArg(
+		"",
+		"exec-trace",
+		"Specifies the file where to write a binary trace of the last instructions executed, "
+		"readable with --decode-trace. Idle loops are not skipped while tracing.",
+		false,
+		"",
+		"trace_file");
+	TCLAP::SwitchArg decodeTraceArg(
+		"",
+		"decode-trace",
+		"Specifies that the input file is a trace written with --exec-trace, to print its "
+		"disassembly instead of running a program.",
+		false);
+	TCLAP::SwitchArg noIdleSkipArg(
+		"",
+		"no-idle-skip",
+		"Specifies whether to execute every cycle of the loops that wait for a timer tick or key "
+		"press, instead of skipping them. The results are the same.",
+		false);
+
+	cmd.add(inputArg);
+	cmd.add(framesArg);
+	cmd.add(playArg);
+	cmd.add(recordArg);
+	cmd.add(seedArg);
+	cmd.add(saveStateArg);
+	cmd.add(profileArg);
+	cmd.add(execTraceArg);
+	cmd.add(decodeTraceArg);
+	cmd.add(noIdleSkipArg);
+
+	cmd.parse(argc, argv);
+
+	try
+	{
+		if (decodeTraceArg.getValue())
+		{
+			std::ifstream traceFile(inputArg.getValue(), std::ios::in | std::ios::binary);
+			if (!traceFile)
+			{
+				throw std::invalid_argument("Path '" + inputArg.getValue() +
+											"' is an invalid file");
+			}
+
+			c8::CExecutionTrace::WriteText(c8::CExecutionTrace::Read(traceFile), std::cout);
+			return 0;
+		}
+
+		if (!framesArg.isSet() && !playArg.isSet())
+		{
+			throw std::invalid_argument("Either a number of frames or a movie to play is required");
+		}
+
+		std::shared_ptr<CHeadlessPlatform> platform = std::make_shared<CHeadlessPlatform>();
+		c8::CInterpreter interpreter(platform);
+		interpreter.LoadProgram(inputArg.getValue());
+
+		std::uint32_t seed = seedArg.isSet() ? seedArg.getValue() : std::random_device{}();
+		std::uint32_t frameCount = framesArg.getValue();
+
+		std::optional<c8::CMovie> playback{ std::nullopt };
+		if (playArg.isSet())
+		{
+			playback.emplace(c8::CMovie::Load(playArg.getValue()));
+			if (playback->ProgramHash() != interpreter.ProgramHash())
+			{
+				throw std::runtime_error("Movie '" + playArg.getValue() +
+										 "' was recorded with a different program");
+			}
+
+			seed = playback->RandomSeed();
+			if (!framesArg.isSet() || frameCount > playback->FrameCount())
+			{
+				frameCount = playback->FrameCount();
+			}
+		}
+
+		interpreter.SetRandomSeed(seed);
+		interpreter.EnableIdleSkip(!noIdleSkipArg.getValue());
+		interpreter.EnableExecutionTrace(execTraceArg.isSet());
+
+		std::optional<c8::CMovie> recording{ std::nullopt };
+		if (recordArg.isSet())
+		{
+			recording.emplace(interpreter.ProgramHash(), seed);
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+
+		c8::SKeyboardState keyboard{};
+		std::uint32_t frame = 0;
+		for (; frame < frameCount && !interpreter.Context().Exited; frame++)
+		{
+			if (playback.has_value())
+			{
+				playback->GetFrame(frame, keyboard);
+			}
+			else
+			{
+				platform->GetKeyboardState(keyboard);
+			}
+
+			if (recording.has_value())
+			{
+				recording->RecordFrame(keyboard);
+			}
+
+			interpreter.RunFrame(keyboard);
+		}
+
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Ran " << frame << " frames (seed " << seed << ") in " << elapsed.count()
+				  << " s, skipped " << interpreter.IdleSkippedCycles() << " idle cycles"
+				  << std::endl;
+
+		if (recording.has_value())
+		{
+			recording->Save(recordArg.getValue());
+		}
+
+		if (saveStateArg.isSet())
+		{
+			interpreter.SaveState(saveStateArg.getValue());
+		}
+
+		if (execTraceArg.isSet())
+		{
+			std::ofstream traceFile(execTraceArg.getValue(), std::ios::out | std::ios::binary);
+			interpreter.ExecutionTrace()->Write(traceFile);
+		}
+
+		if (profileArg.isSet())
+		{
+			if (!c8::CProfiler::Enabled)
+			{
+				std::cerr << "The core was built without C8_PROFILER, the profile is empty"
+						  << std::endl;
+			}
+
+			std::ofstream profileFile(profileArg.getValue());
+			interpreter.Profiler().WriteJson(profileFile);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}